@@ -287,6 +287,14 @@ bool IOFile::IsOpen() const {
     return file != nullptr;
 }
 
+int IOFile::GetNativeHandle() const {
+    if (!IsOpen()) {
+        return -1;
+    }
+
+    return fileno(file);
+}
+
 std::string IOFile::ReadString(size_t length) const {
     std::vector<char> string_buffer(length);
 
@@ -300,6 +308,54 @@ size_t IOFile::WriteString(std::span<const char> string) const {
     return WriteSpan(string);
 }
 
+size_t IOFile::ReadBytesAt(void* data, size_t size, u64 offset) const {
+    if (!IsOpen()) {
+        return 0;
+    }
+
+    const int fd = fileno(file);
+    size_t bytes_read = 0;
+    while (bytes_read < size) {
+        const auto result = ::pread(fd, static_cast<u8*>(data) + bytes_read, size - bytes_read,
+                                    static_cast<off_t>(offset + bytes_read));
+        if (result == -1 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            break;
+        }
+        bytes_read += static_cast<size_t>(result);
+    }
+
+    return bytes_read;
+}
+
+size_t IOFile::WriteBytesAt(const void* data, size_t size, u64 offset) const {
+    if (!IsOpen()) {
+        return 0;
+    }
+
+    const int fd = fileno(file);
+    size_t bytes_written = 0;
+    while (bytes_written < size) {
+        const auto result =
+            ::pwrite(fd, static_cast<const u8*>(data) + bytes_written, size - bytes_written,
+                     static_cast<off_t>(offset + bytes_written));
+        if (result == -1 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            const auto ec = std::error_code{errno, std::generic_category()};
+            LOG_ERROR(Common_Filesystem, "Failed to write to the file at path={}, ec_message={}",
+                      PathToUTF8String(file_path), ec.message());
+            break;
+        }
+        bytes_written += static_cast<size_t>(result);
+    }
+
+    return bytes_written;
+}
+
 bool IOFile::Flush() const {
     if (!IsOpen()) {
         return false;
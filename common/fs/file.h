@@ -213,6 +213,14 @@ public:
      */
     [[nodiscard]] bool IsOpen() const;
 
+    /**
+     * Gets the descriptor of the opened file, for reading it with system calls directly.
+     * The same rules as for ReadAt apply.
+     *
+     * @returns The file descriptor, or -1 if the file is not open.
+     */
+    [[nodiscard]] int GetNativeHandle() const;
+
 #ifdef VIDEO_CORE_COMPAT
     template <typename T>
     std::size_t ReadArray(T* data, std::size_t length) const {
@@ -356,6 +364,55 @@ public:
         return std::fwrite(data.data(), sizeof(T), data.size(), file);
     }
 
+    /**
+     * Reads a span of T data from a file at the given offset.
+     * Unlike ReadSpan, this neither uses nor moves the file pointer, so it may be called from
+     * several threads at once. Data written with the sequential functions and not yet flushed
+     * is not seen.
+     *
+     * Failures occur when:
+     * - The file is not open
+     * - The opened file lacks read permissions
+     * - Attempting to read beyond the end-of-file
+     *
+     * @tparam T Data type
+     *
+     * @param data Span of T data
+     * @param offset Offset in bytes from the start of the file
+     *
+     * @returns Count of T data successfully read.
+     */
+    template <typename T>
+    [[nodiscard]] size_t ReadAt(std::span<T> data, u64 offset) const {
+        static_assert(std::is_trivially_copyable_v<T>, "Data type must be trivially copyable.");
+
+        return ReadBytesAt(data.data(), data.size_bytes(), offset) / sizeof(T);
+    }
+
+    /**
+     * Writes a span of T data to a file at the given offset.
+     * Unlike WriteSpan, this neither uses nor moves the file pointer, so it may be called from
+     * several threads at once. It bypasses the stream buffer, so it must not be mixed with the
+     * sequential functions without flushing in between.
+     *
+     * Failures occur when:
+     * - The file is not open
+     * - The opened file lacks write permissions
+     *
+     * @tparam T Data type
+     *
+     * @param data Span of T data
+     * @param offset Offset in bytes from the start of the file
+     *
+     * @returns Count of T data successfully written.
+     */
+    template <typename T>
+    [[nodiscard]] size_t WriteAt(std::span<const T> data, u64 offset) const {
+        static_assert(std::is_trivially_copyable_v<T>, "Data type must be trivially copyable.");
+
+        return WriteBytesAt(data.data(), data.size_bytes(), offset) / sizeof(T);
+    }
+
     /**
      * Reads a T object from a file sequentially.
      * This function reads from the current position of the file pointer and
@@ -492,6 +549,9 @@ public:
     [[nodiscard]] s64 Tell() const;
 
 private:
+    size_t ReadBytesAt(void* data, size_t size, u64 offset) const;
+    size_t WriteBytesAt(const void* data, size_t size, u64 offset) const;
+
     std::filesystem::path file_path;
     FileAccessMode file_access_mode{};
     FileType file_type{};
@@ -4,19 +4,28 @@
 //
 // Adapted by Kent Hall for mizu on Horizon Linux.
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
-#include <climits>
+#include <condition_variable>
+#include <cstring>
 #include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <thread>
+#include <utility>
 #include <vector>
 
+#include <fmt/args.h>
 #include <fmt/format.h>
 
 #ifdef _WIN32
 #include <windows.h> // For OutputDebugStringW
 #endif
 
+#include "common/bit_cast.h"
 #include "common/fs/file.h"
 #include "common/fs/fs.h"
 #include "common/fs/fs_paths.h"
@@ -47,6 +56,12 @@ public:
 
     virtual void Write(const Entry& entry) = 0;
 
+    virtual void WriteBatch(std::span<const Entry> entries) {
+        for (const Entry& entry : entries) {
+            Write(entry);
+        }
+    }
+
     virtual void EnableForStacktrace() = 0;
 
     virtual void Flush() = 0;
@@ -104,17 +119,28 @@ public:
     ~FileBackend() override = default;
 
     void Write(const Entry& entry) override {
+        WriteBatch({&entry, 1});
+    }
+
+    void WriteBatch(std::span<const Entry> entries) override {
         if (!enabled) {
             return;
         }
 
-        bytes_written += file->WriteString(FormatLogMessage(entry).append(1, '\n'));
+        // Write the whole batch at once instead of line by line
+        bool has_error = false;
+        batch_text.clear();
+        for (const Entry& entry : entries) {
+            batch_text.append(FormatLogMessage(entry)).push_back('\n');
+            has_error |= entry.log_level >= Level::Error;
+        }
+        bytes_written += file->WriteString(batch_text);
 
         using namespace Common::Literals;
         // Prevent logs from exceeding a set maximum size in the event that log entries are spammed.
         const auto write_limit = Settings::values.extended_logging ? 1_GiB : 100_MiB;
         const bool write_limit_exceeded = bytes_written > write_limit;
-        if (entry.log_level >= Level::Error || write_limit_exceeded) {
+        if (has_error || write_limit_exceeded) {
             if (write_limit_exceeded) {
                 // Stop writing after the write limit is exceeded.
                 // Don't close the file so we can print a stacktrace if necessary
@@ -137,6 +163,7 @@ private:
     std::unique_ptr<FS::IOFile> file;
     bool enabled = true;
     std::size_t bytes_written = 0;
+    std::string batch_text;
 };
 
 /**
@@ -159,7 +186,158 @@ public:
     void EnableForStacktrace() override {}
 };
 
-bool initialization_in_progress_suppress_logging = true;
+/// Header of a record in a thread's log buffer, followed by the stored arguments
+struct RecordHeader {
+    u32 size; ///< Size of the record including this header
+    u32 num_args;
+    Class log_class;
+    Level log_level; ///< Level::Count marks padding up to the end of the buffer
+    unsigned int line_num;
+    std::chrono::microseconds timestamp;
+    const char* filename;
+    const char* function;
+    const char* format; ///< nullptr when the only argument is the formatted message
+};
+static_assert(sizeof(RecordHeader) % 8 == 0);
+
+/**
+ * Single producer, single consumer byte ring owned by one logging thread and drained by the log
+ * thread. Records are contiguous, a record that would wrap is moved to the start of the buffer.
+ */
+class ThreadBuffer {
+public:
+    static constexpr std::size_t SIZE = 0x10000;
+    /// Records larger than this are queued as formatted entries instead
+    static constexpr std::size_t MAX_RECORD_SIZE = SIZE / 4;
+
+    /// Reserves size bytes, returns nullptr when the log thread has not freed enough space yet
+    u8* TryReserve(std::size_t size) {
+        const u64 pos = head.load(std::memory_order_relaxed);
+        const std::size_t offset = pos % SIZE;
+        const std::size_t padding = offset + size > SIZE ? SIZE - offset : 0;
+        if (pos + padding + size - tail.load(std::memory_order_acquire) > SIZE) {
+            return nullptr;
+        }
+        if (padding >= sizeof(RecordHeader)) {
+            RecordHeader header{};
+            header.size = static_cast<u32>(padding);
+            header.log_level = Level::Count;
+            std::memcpy(&data[offset], &header, sizeof(header));
+        }
+        reserved_head = pos + padding + size;
+        return &data[(pos + padding) % SIZE];
+    }
+
+    /// Publishes the last reservation
+    void Commit() {
+        head.store(reserved_head, std::memory_order_release);
+    }
+
+    [[nodiscard]] bool Empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);
+    }
+
+    /// Calls func for every published record and releases their space, log thread only
+    template <typename Func>
+    void Consume(Func&& func) {
+        const u64 end = head.load(std::memory_order_acquire);
+        u64 pos = tail.load(std::memory_order_relaxed);
+        while (pos != end) {
+            const std::size_t offset = pos % SIZE;
+            if (SIZE - offset < sizeof(RecordHeader)) {
+                pos += SIZE - offset;
+                continue;
+            }
+            RecordHeader header;
+            std::memcpy(&header, &data[offset], sizeof(header));
+            if (header.log_level != Level::Count) {
+                func(header, &data[offset + sizeof(header)]);
+            }
+            pos += header.size;
+        }
+        tail.store(pos, std::memory_order_release);
+    }
+
+    /// Set when the owning thread exits, the buffer is dropped once drained
+    std::atomic_bool orphaned{false};
+
+private:
+    alignas(64) std::atomic<u64> head{};
+    u64 reserved_head{};
+    alignas(64) std::atomic<u64> tail{};
+    alignas(8) std::array<u8, SIZE> data;
+};
+
+struct ThreadBufferHandle {
+    ~ThreadBufferHandle() {
+        if (buffer) {
+            buffer->orphaned.store(true, std::memory_order_release);
+        }
+    }
+
+    std::shared_ptr<ThreadBuffer> buffer;
+};
+
+thread_local ThreadBufferHandle local_buffer;
+/// Set on the log thread, the only one that drains the buffers
+thread_local bool is_log_thread = false;
+
+/// Formats a record with the arguments stored by Detail::StoreArg
+std::string FormatRecord(const RecordHeader& header, const u8* args) {
+    using Detail::ArgHeader;
+    using Detail::ArgType;
+
+    const auto read_string = [](const ArgHeader& arg, const u8* payload) {
+        return std::string_view{reinterpret_cast<const char*>(payload), arg.size};
+    };
+    if (!header.format) {
+        ArgHeader arg;
+        std::memcpy(&arg, args, sizeof(arg));
+        return std::string{read_string(arg, args + sizeof(arg))};
+    }
+
+    fmt::dynamic_format_arg_store<fmt::format_context> store;
+    store.reserve(header.num_args, 0);
+    for (u32 i = 0; i < header.num_args; ++i) {
+        ArgHeader arg;
+        std::memcpy(&arg, args, sizeof(arg));
+        const u8* const payload = args + sizeof(arg);
+        u64 value{};
+        std::memcpy(&value, payload, std::min<std::size_t>(arg.size, sizeof(value)));
+        switch (arg.type) {
+        case ArgType::Bool:
+            store.push_back(value != 0);
+            break;
+        case ArgType::Char:
+            store.push_back(static_cast<char>(value));
+            break;
+        case ArgType::Signed:
+            store.push_back(static_cast<long long>(value));
+            break;
+        case ArgType::Unsigned:
+            store.push_back(static_cast<unsigned long long>(value));
+            break;
+        case ArgType::Float:
+            store.push_back(Common::BitCast<float>(static_cast<u32>(value)));
+            break;
+        case ArgType::Double:
+            store.push_back(Common::BitCast<double>(value));
+            break;
+        case ArgType::Pointer:
+            store.push_back(reinterpret_cast<const void*>(value));
+            break;
+        case ArgType::String:
+            store.push_back(read_string(arg, payload));
+            break;
+        }
+        args = payload + Detail::AlignArg(arg.size);
+    }
+    try {
+        return fmt::vformat(header.format, store);
+    } catch (const fmt::format_error& e) {
+        return fmt::format("{} (format error: {})", header.format, e.what());
+    }
+}
 
 /**
  * Static state as a singleton.
@@ -185,7 +363,7 @@ public:
         filter.ParseFilterString(Settings::values.log_filter.GetValue());
         instance = std::unique_ptr<Impl, decltype(&Deleter)>(new Impl(log_dir / LOG_FILE, filter),
                                                              Deleter);
-        initialization_in_progress_suppress_logging = false;
+        instance->SetGlobalFilter(filter);
     }
 
     Impl(const Impl&) = delete;
@@ -196,70 +374,226 @@ public:
 
     void SetGlobalFilter(const Filter& f) {
         filter = f;
+        for (std::size_t i = 0; i < Detail::min_levels.size(); ++i) {
+            const Class log_class = static_cast<Class>(i);
+            u8 level = 0;
+            while (level < static_cast<u8>(Level::Count) &&
+                   !filter.CheckMessage(log_class, static_cast<Level>(level))) {
+                ++level;
+            }
+            Detail::min_levels[i].store(static_cast<Level>(level), std::memory_order_relaxed);
+        }
     }
 
     void SetColorConsoleBackendEnabled(bool enabled) {
         color_console_backend.SetEnabled(enabled);
     }
 
+    u8* BeginRecord(Class log_class, Level log_level, const char* filename,
+                    unsigned int line_num, const char* function, const char* format,
+                    std::size_t num_args, std::size_t args_size) {
+        const std::size_t size = sizeof(RecordHeader) + args_size;
+        if (size > ThreadBuffer::MAX_RECORD_SIZE) {
+            return nullptr;
+        }
+        ThreadBuffer& buffer = LocalBuffer();
+        u8* record = buffer.TryReserve(size);
+        if (!record && is_log_thread) {
+            // Logging from the log thread, e.g. a file backend error, nobody else would make room,
+            // so the message goes through the queue instead
+            return nullptr;
+        }
+        while (!record) {
+            // The log thread is behind, let it catch up instead of dropping messages
+            Wake(true);
+            std::this_thread::yield();
+            record = buffer.TryReserve(size);
+        }
+        const RecordHeader header{
+            .size = static_cast<u32>(size),
+            .num_args = static_cast<u32>(num_args),
+            .log_class = log_class,
+            .log_level = log_level,
+            .line_num = line_num,
+            .timestamp = Timestamp(),
+            .filename = filename,
+            .function = function,
+            .format = format,
+        };
+        std::memcpy(record, &header, sizeof(header));
+        return record + sizeof(header);
+    }
+
+    void EndRecord(Level log_level) {
+        local_buffer.buffer->Commit();
+        // Pairs with the fence in the log thread before it checks the buffers and goes to sleep
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Wake(log_level >= Level::Error);
+    }
+
     void PushEntry(Class log_class, Level log_level, const char* filename, unsigned int line_num,
                    const char* function, std::string message) {
-        if (!filter.CheckMessage(log_class, log_level))
+        u8* const args = BeginRecord(log_class, log_level, filename, line_num, function, nullptr,
+                                     1, Detail::StoredArgSize(message));
+        if (args) {
+            Detail::StoreArg(args, message);
+            EndRecord(log_level);
             return;
-        const Entry& entry =
-            CreateEntry(log_class, log_level, filename, line_num, function, std::move(message));
-        message_queue.Push(entry);
+        }
+        message_queue.Push(
+            CreateEntry(log_class, log_level, filename, line_num, function, std::move(message)));
+        Wake(true);
     }
 
 private:
     Impl(const std::filesystem::path& file_backend_filename, const Filter& filter_)
         : filter{filter_}, file_backend{file_backend_filename}, backend_thread{std::thread([this] {
               Common::SetCurrentThreadName("mizu:Log");
-              Entry entry;
-              const auto write_logs = [this, &entry]() {
-                  ForEachBackend([&entry](Backend& backend) { backend.Write(entry); });
-              };
-              while (true) {
-                  entry = message_queue.PopWait();
-                  if (entry.final_entry) {
-                      break;
-                  }
-                  write_logs();
-              }
-              // Drain the logging queue. Only writes out up to MAX_LOGS_TO_WRITE to prevent a
-              // case where a system is repeatedly spamming logs even on close.
-              int max_logs_to_write = filter.IsDebug() ? INT_MAX : 100;
-              while (max_logs_to_write-- && message_queue.Pop(entry)) {
-                  write_logs();
-              }
+              is_log_thread = true;
+              RunBackendThread();
           })} {}
 
     ~Impl() {
+        DisableLoggingInTests();
         StopBackendThread();
     }
 
+    void RunBackendThread() {
+        std::vector<Entry> batch;
+        bool paused = false;
+        while (true) {
+            const bool stopping = stop_requested.load(std::memory_order_acquire);
+            CollectEntries(batch);
+            if (stopping) {
+                WriteBatch(batch);
+                // Drain the logs written since. Only writes out up to 100 logs to prevent a case
+                // where a system is repeatedly spamming logs even on close.
+                batch.clear();
+                CollectEntries(batch);
+                if (!filter.IsDebug() && batch.size() > 100) {
+                    batch.resize(100);
+                }
+                WriteBatch(batch);
+                break;
+            }
+            if (!batch.empty()) {
+                WriteBatch(batch);
+                batch.clear();
+                paused = false;
+                continue;
+            }
+            std::unique_lock lock{wake_mutex};
+            if (!paused) {
+                // Let a batch build up before going to sleep, producers only wake a sleeping
+                // log thread
+                wake_cv.wait_for(lock, std::chrono::milliseconds{1}, [this] {
+                    return stop_requested.load() || urgent.exchange(false);
+                });
+                paused = true;
+                continue;
+            }
+            sleeping.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (HasPendingEntries()) {
+                sleeping.store(false);
+                continue;
+            }
+            wake_cv.wait(lock, [this] { return !sleeping.load() || stop_requested.load(); });
+            sleeping.store(false);
+            urgent.store(false);
+        }
+    }
+
     void StopBackendThread() {
-        Entry stop_entry{};
-        stop_entry.final_entry = true;
-        message_queue.Push(stop_entry);
+        {
+            std::lock_guard lock{wake_mutex};
+            stop_requested.store(true);
+        }
+        wake_cv.notify_one();
         backend_thread.join();
     }
 
+    /// Wakes the log thread if it went to sleep, or in any case when urgent
+    void Wake(bool is_urgent) {
+        if (is_urgent) {
+            urgent.store(true);
+        } else if (!sleeping.load(std::memory_order_relaxed)) {
+            return;
+        }
+        if (sleeping.exchange(false) || is_urgent) {
+            std::lock_guard lock{wake_mutex};
+            wake_cv.notify_one();
+        }
+    }
+
+    ThreadBuffer& LocalBuffer() {
+        if (!local_buffer.buffer) [[unlikely]] {
+            local_buffer.buffer = std::make_shared<ThreadBuffer>();
+            std::lock_guard lock{buffers_mutex};
+            buffers.push_back(local_buffer.buffer);
+        }
+        return *local_buffer.buffer;
+    }
+
+    bool HasPendingEntries() {
+        std::lock_guard lock{buffers_mutex};
+        return !message_queue.Empty() ||
+               std::any_of(buffers.begin(), buffers.end(),
+                           [](const auto& buffer) { return !buffer->Empty(); });
+    }
+
+    /// Decodes the published records of every thread, ordered by time
+    void CollectEntries(std::vector<Entry>& batch) {
+        {
+            std::lock_guard lock{buffers_mutex};
+            collect_buffers = buffers;
+            std::erase_if(buffers, [](const auto& buffer) {
+                return buffer->orphaned.load(std::memory_order_acquire) && buffer->Empty();
+            });
+        }
+        for (const auto& buffer : collect_buffers) {
+            buffer->Consume([&batch](const RecordHeader& header, const u8* args) {
+                batch.push_back({
+                    .timestamp = header.timestamp,
+                    .log_class = header.log_class,
+                    .log_level = header.log_level,
+                    .filename = header.filename,
+                    .line_num = header.line_num,
+                    .function = header.function,
+                    .message = FormatRecord(header, args),
+                });
+            });
+        }
+        collect_buffers.clear();
+
+        Entry entry;
+        while (message_queue.Pop(entry)) {
+            batch.push_back(std::move(entry));
+        }
+        std::stable_sort(batch.begin(), batch.end(), [](const Entry& lhs, const Entry& rhs) {
+            return lhs.timestamp < rhs.timestamp;
+        });
+    }
+
+    void WriteBatch(std::span<const Entry> batch) {
+        ForEachBackend([batch](Backend& backend) { backend.WriteBatch(batch); });
+    }
+
+    std::chrono::microseconds Timestamp() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - time_origin);
+    }
+
     Entry CreateEntry(Class log_class, Level log_level, const char* filename, unsigned int line_nr,
                       const char* function, std::string message) const {
-        using std::chrono::duration_cast;
-        using std::chrono::microseconds;
-        using std::chrono::steady_clock;
-
         return {
-            .timestamp = duration_cast<microseconds>(steady_clock::now() - time_origin),
+            .timestamp = Timestamp(),
             .log_class = log_class,
             .log_level = log_level,
             .filename = filename,
             .line_num = line_nr,
             .function = function,
             .message = std::move(message),
-            .final_entry = false,
         };
     }
 
@@ -280,18 +614,51 @@ private:
     ColorConsoleBackend color_console_backend{};
     FileBackend file_backend;
 
+    std::mutex buffers_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::vector<std::shared_ptr<ThreadBuffer>> collect_buffers;
+
+    /// Records too large for a thread buffer
     MPSCQueue<Entry> message_queue{};
+
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+    std::atomic_bool sleeping{false};
+    std::atomic_bool urgent{false};
+    std::atomic_bool stop_requested{false};
+
     std::chrono::steady_clock::time_point time_origin{std::chrono::steady_clock::now()};
     std::thread backend_thread;
 };
 } // namespace
 
+namespace Detail {
+std::array<std::atomic<Level>, static_cast<std::size_t>(Class::Count)> min_levels =
+    []<std::size_t... I>(std::index_sequence<I...>) {
+        // Everything is filtered out until the backend is initialized
+        return std::array<std::atomic<Level>, sizeof...(I)>{((void)I, Level::Count)...};
+    }(std::make_index_sequence<static_cast<std::size_t>(Class::Count)>{});
+
+u8* BeginRecord(Class log_class, Level log_level, const char* filename, unsigned int line_num,
+                const char* function, const char* format, std::size_t num_args,
+                std::size_t args_size) {
+    return Impl::Instance().BeginRecord(log_class, log_level, filename, line_num, function,
+                                        format, num_args, args_size);
+}
+
+void EndRecord(Level log_level) {
+    Impl::Instance().EndRecord(log_level);
+}
+} // namespace Detail
+
 void Initialize() {
     Impl::Initialize();
 }
 
 void DisableLoggingInTests() {
-    initialization_in_progress_suppress_logging = true;
+    for (auto& min_level : Detail::min_levels) {
+        min_level.store(Level::Count, std::memory_order_relaxed);
+    }
 }
 
 void SetGlobalFilter(const Filter& filter) {
@@ -305,7 +672,7 @@ void SetColorConsoleBackendEnabled(bool enabled) {
 void FmtLogMessageImpl(Class log_class, Level log_level, const char* filename,
                        unsigned int line_num, const char* function, const char* format,
                        const fmt::format_args& args) {
-    if (!initialization_in_progress_suppress_logging) {
+    if (IsEnabled(log_class, log_level)) {
         Impl::Instance().PushEntry(log_class, log_level, filename, line_num, function,
                                    fmt::vformat(format, args));
     }
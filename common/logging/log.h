@@ -7,7 +7,14 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <string>
 #include <string_view>
+#include <type_traits>
+#include <utility>
 
 #include <fmt/core.h>
 
@@ -15,8 +22,142 @@
 
 namespace Common::Log {
 
-// trims up to and including the last of ../, ..\, src/, src\ in a string
-constexpr const char* TrimSourcePath(std::string_view source) {
+namespace Detail {
+
+/// Minimum level of every class that passes the global filter, Level::Count while disabled
+extern std::array<std::atomic<Level>, static_cast<std::size_t>(Class::Count)> min_levels;
+
+/// Type tags of arguments stored for deferred formatting
+enum class ArgType : u8 {
+    Bool,
+    Char,
+    Signed,
+    Unsigned,
+    Float,
+    Double,
+    Pointer,
+    String,
+};
+
+/// Header preceding every stored argument, followed by its payload padded to 8 bytes
+struct ArgHeader {
+    ArgType type;
+    u32 size;
+};
+static_assert(sizeof(ArgHeader) == 8);
+
+constexpr std::size_t AlignArg(std::size_t size) {
+    return (size + 7) & ~std::size_t{7};
+}
+
+template <typename T>
+constexpr bool IsStringArg = std::is_same_v<T, const char*> || std::is_same_v<T, char*> ||
+                             std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>;
+
+/**
+ * Arguments that can be stored by value and formatted on the log thread with the same result.
+ * Anything else, e.g. types with custom formatters, is formatted on the calling thread.
+ */
+template <typename T>
+constexpr bool IsDeferrableArg =
+    std::is_same_v<T, bool> || std::is_same_v<T, char> ||
+    (std::is_integral_v<T> && sizeof(T) <= sizeof(u64) && !std::is_same_v<T, wchar_t> &&
+     !std::is_same_v<T, char8_t> && !std::is_same_v<T, char16_t> &&
+     !std::is_same_v<T, char32_t>) ||
+    std::is_same_v<T, float> || std::is_same_v<T, double> || std::is_same_v<T, const void*> ||
+    std::is_same_v<T, void*> || IsStringArg<T>;
+
+/// Decays character arrays to pointers and passes everything else by reference
+template <typename T>
+decltype(auto) ArgValue(const T& arg) {
+    if constexpr (std::is_array_v<T>) {
+        return static_cast<const std::remove_extent_t<T>*>(arg);
+    } else {
+        return (arg);
+    }
+}
+
+template <typename T>
+using StoredType = std::remove_cvref_t<decltype(ArgValue(std::declval<const T&>()))>;
+
+template <typename T>
+std::string_view ToStringView(const T& arg) {
+    if constexpr (std::is_pointer_v<T>) {
+        return arg ? std::string_view{arg} : std::string_view{};
+    } else {
+        return std::string_view{arg};
+    }
+}
+
+template <typename T>
+std::size_t StoredArgSize(const T& arg) {
+    if constexpr (IsStringArg<T>) {
+        return sizeof(ArgHeader) + AlignArg(ToStringView(arg).size());
+    } else {
+        return sizeof(ArgHeader) + sizeof(u64);
+    }
+}
+
+template <typename T>
+u8* StoreArg(u8* dst, const T& arg) {
+    ArgHeader header{};
+    u64 value{};
+    if constexpr (IsStringArg<T>) {
+        const std::string_view str = ToStringView(arg);
+        header = {ArgType::String, static_cast<u32>(str.size())};
+        std::memcpy(dst, &header, sizeof(header));
+        std::memcpy(dst + sizeof(header), str.data(), str.size());
+        return dst + sizeof(header) + AlignArg(str.size());
+    } else if constexpr (std::is_same_v<T, bool>) {
+        header.type = ArgType::Bool;
+        value = arg ? 1 : 0;
+    } else if constexpr (std::is_same_v<T, char>) {
+        header.type = ArgType::Char;
+        value = static_cast<u8>(arg);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        header.type = ArgType::Signed;
+        value = static_cast<u64>(static_cast<s64>(arg));
+    } else if constexpr (std::is_integral_v<T>) {
+        header.type = ArgType::Unsigned;
+        value = static_cast<u64>(arg);
+    } else if constexpr (std::is_same_v<T, float>) {
+        header.type = ArgType::Float;
+        std::memcpy(&value, &arg, sizeof(arg));
+    } else if constexpr (std::is_same_v<T, double>) {
+        header.type = ArgType::Double;
+        std::memcpy(&value, &arg, sizeof(arg));
+    } else {
+        header.type = ArgType::Pointer;
+        value = reinterpret_cast<u64>(arg);
+    }
+    header.size = sizeof(value);
+    std::memcpy(dst, &header, sizeof(header));
+    std::memcpy(dst + sizeof(header), &value, sizeof(value));
+    return dst + sizeof(header) + sizeof(value);
+}
+
+/**
+ * Reserves a record for args_size bytes of arguments in the calling thread's log buffer and
+ * returns where the arguments go, or nullptr when the record does not fit in a buffer.
+ * The format string must have static storage duration.
+ */
+u8* BeginRecord(Class log_class, Level log_level, const char* filename, unsigned int line_num,
+                const char* function, const char* format, std::size_t num_args,
+                std::size_t args_size);
+
+/// Publishes the record reserved last by the calling thread to the log thread
+void EndRecord(Level log_level);
+
+} // namespace Detail
+
+/// Returns true when messages of log_class at log_level pass the global filter
+[[nodiscard]] inline bool IsEnabled(Class log_class, Level log_level) {
+    return log_level >=
+           Detail::min_levels[static_cast<std::size_t>(log_class)].load(std::memory_order_relaxed);
+}
+
+// trims up to and including the last of ../, ..\, src/, src\ in a string, at compile time
+consteval const char* TrimSourcePath(std::string_view source) {
     const auto rfind = [source](const std::string_view match) {
         return source.rfind(match) == source.npos ? 0 : (source.rfind(match) + match.size());
     };
@@ -29,9 +170,27 @@ void FmtLogMessageImpl(Class log_class, Level log_level, const char* filename,
                        unsigned int line_num, const char* function, const char* format,
                        const fmt::format_args& args);
 
+/**
+ * Logs a message to the global logger. Arguments of simple types are stored in the calling
+ * thread's log buffer and formatted on the log thread, the format string must be a literal.
+ */
 template <typename... Args>
 void FmtLogMessage(Class log_class, Level log_level, const char* filename, unsigned int line_num,
                    const char* function, const char* format, const Args&... args) {
+    if (!IsEnabled(log_class, log_level)) {
+        return;
+    }
+    if constexpr ((Detail::IsDeferrableArg<Detail::StoredType<Args>> && ...)) {
+        const std::size_t args_size =
+            (std::size_t{0} + ... + Detail::StoredArgSize(Detail::ArgValue(args)));
+        u8* dst = Detail::BeginRecord(log_class, log_level, filename, line_num, function, format,
+                                      sizeof...(Args), args_size);
+        if (dst) {
+            ((dst = Detail::StoreArg(dst, Detail::ArgValue(args))), ...);
+            Detail::EndRecord(log_level);
+            return;
+        }
+    }
     FmtLogMessageImpl(log_class, log_level, filename, line_num, function, format,
                       fmt::make_format_args(args...));
 }
@@ -0,0 +1,88 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+#include "common/common_types.h"
+#include "common/div_ceil.h"
+
+namespace Common {
+
+/**
+ * Sequence lock publishing a small trivially copyable value from one writer to any number of
+ * readers. Readers never block the writer and never take a lock, they retry when they raced with
+ * a write. Writers must be serialized by the caller.
+ *
+ * The value is stored as relaxed atomic words so concurrent reads are well defined.
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    static constexpr size_t NUM_WORDS = DivCeil(sizeof(T), sizeof(u64));
+
+    using Words = std::array<u64, NUM_WORDS>;
+
+public:
+    SeqLock() : SeqLock(T{}) {}
+
+    explicit SeqLock(const T& value) {
+        Store(value);
+    }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    /// Publishes a new value
+    void Write(const T& value) noexcept {
+        const u64 begin{sequence.load(std::memory_order_relaxed)};
+        sequence.store(begin + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        Store(value);
+        sequence.store(begin + 2, std::memory_order_release);
+    }
+
+    /// Returns the last published value, optionally along with the sequence it was published at
+    [[nodiscard]] T Read(u64* out_sequence = nullptr) const noexcept {
+        Words copy;
+        u64 begin;
+        do {
+            begin = sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < NUM_WORDS; ++i) {
+                copy[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((begin & 1) != 0 || sequence.load(std::memory_order_relaxed) != begin);
+
+        if (out_sequence) {
+            *out_sequence = begin;
+        }
+        T value;
+        std::memcpy(&value, copy.data(), sizeof(T));
+        return value;
+    }
+
+    /// Returns the sequence of the last published value, it increases with every write
+    [[nodiscard]] u64 Sequence() const noexcept {
+        return sequence.load(std::memory_order_acquire) & ~u64{1};
+    }
+
+private:
+    void Store(const T& value) noexcept {
+        Words copy{};
+        std::memcpy(copy.data(), &value, sizeof(T));
+        for (size_t i = 0; i < NUM_WORDS; ++i) {
+            words[i].store(copy[i], std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<u64> sequence{};
+    std::array<std::atomic<u64>, NUM_WORDS> words{};
+};
+
+} // namespace Common
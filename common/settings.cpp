@@ -74,6 +74,7 @@ void LogSettings() {
     log_setting("Input_EnableMotion", values.motion_enabled.GetValue());
     log_setting("Input_EnableVibration", values.vibration_enabled.GetValue());
     log_setting("Input_EnableRawInput", values.enable_raw_input.GetValue());
+    log_setting("Input_SdlEventDriven", values.sdl_event_driven.GetValue());
 }
 
 bool IsConfiguringGlobal() {
@@ -472,6 +472,7 @@ struct Values {
     Setting<bool> use_vsync{true, "use_vsync"};
     BasicRangedSetting<u16> fps_cap{1000, 1, 1000, "fps_cap"};
     BasicSetting<bool> disable_fps_limit{false, "disable_fps_limit"};
+    BasicSetting<bool> align_vsync_to_host{false, "align_vsync_to_host"};
     RangedSetting<ShaderBackend> shader_backend{ShaderBackend::GLASM, ShaderBackend::GLSL,
                                                 ShaderBackend::SPIRV, "shader_backend"};
     Setting<bool> use_asynchronous_shaders{false, "use_asynchronous_shaders"};
@@ -500,6 +501,7 @@ struct Values {
     Setting<bool> use_docked_mode{true, "use_docked_mode"};
 
     BasicSetting<bool> enable_raw_input{false, "enable_raw_input"};
+    BasicSetting<bool> sdl_event_driven{true, "sdl_event_driven"};
 
     Setting<bool> vibration_enabled{true, "vibration_enabled"};
     Setting<bool> enable_accurate_vibrations{false, "enable_accurate_vibrations"};
@@ -544,6 +546,8 @@ struct Values {
     BasicSetting<bool> gamecard_inserted{false, "gamecard_inserted"};
     BasicSetting<bool> gamecard_current_game{false, "gamecard_current_game"};
     BasicSetting<std::string> gamecard_path{std::string(), "gamecard_path"};
+    BasicSetting<bool> use_async_fs_io{false, "use_async_fs_io"};
+    BasicSetting<bool> use_save_data_journal{false, "use_save_data_journal"};
 
     // Debugging
     bool record_frame_times;
@@ -553,6 +557,7 @@ struct Values {
     BasicSetting<bool> dump_exefs{false, "dump_exefs"};
     BasicSetting<bool> dump_nso{false, "dump_nso"};
     BasicSetting<bool> enable_fs_access_log{false, "enable_fs_access_log"};
+    BasicSetting<bool> enable_ipc_trace{false, "enable_ipc_trace"};
     BasicSetting<bool> reporting_services{false, "reporting_services"};
     BasicSetting<bool> quest_flag{false, "quest_flag"};
     BasicSetting<bool> disable_macro_jit{false, "disable_macro_jit"};
@@ -0,0 +1,93 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "common/common_types.h"
+#include "common/div_ceil.h"
+
+namespace Common {
+
+/**
+ * Two level table over a fixed number of entries, meant to replace flat per page arrays that
+ * cover the whole address space. Leaves are allocated the first time one of their entries is
+ * written; entries in leaves that were never written read as a value initialized T.
+ *
+ * Leaf allocation is lock-free, entries of atomic types can be updated from several threads.
+ * Leaves are only released when the table is destroyed.
+ */
+template <typename T, u64 NUM_ENTRIES, u32 LEAF_BITS = 12>
+class SparsePageTable {
+    static constexpr u64 LEAF_SIZE = u64{1} << LEAF_BITS;
+    static constexpr u64 LEAF_MASK = LEAF_SIZE - 1;
+    static constexpr u64 NUM_LEAVES = DivCeil(NUM_ENTRIES, LEAF_SIZE);
+
+    using Leaf = std::array<T, LEAF_SIZE>;
+
+public:
+    SparsePageTable() = default;
+
+    ~SparsePageTable() {
+        for (std::atomic<Leaf*>& leaf : leaves) {
+            delete leaf.load(std::memory_order_relaxed);
+        }
+    }
+
+    SparsePageTable(const SparsePageTable&) = delete;
+    SparsePageTable& operator=(const SparsePageTable&) = delete;
+
+    /// Returns the entry at index, without allocating its leaf
+    [[nodiscard]] T Get(u64 index) const noexcept {
+        const Leaf* const leaf{leaves[index >> LEAF_BITS].load(std::memory_order_acquire)};
+        return leaf ? (*leaf)[index & LEAF_MASK] : T{};
+    }
+
+    /// Returns a pointer to the entry at index, or nullptr when its leaf was never written
+    [[nodiscard]] const T* Find(u64 index) const noexcept {
+        const Leaf* const leaf{leaves[index >> LEAF_BITS].load(std::memory_order_acquire)};
+        return leaf ? &(*leaf)[index & LEAF_MASK] : nullptr;
+    }
+
+    /// Returns a reference to the entry at index, allocating its leaf on first touch
+    [[nodiscard]] T& operator[](u64 index) {
+        std::atomic<Leaf*>& slot{leaves[index >> LEAF_BITS]};
+        Leaf* leaf{slot.load(std::memory_order_acquire)};
+        if (!leaf) [[unlikely]] {
+            leaf = AllocateLeaf(slot);
+        }
+        return (*leaf)[index & LEAF_MASK];
+    }
+
+    /// Returns the number of bytes of host memory used by the table
+    [[nodiscard]] size_t MemoryUsage() const noexcept {
+        return sizeof(*this) + num_allocated_leaves.load(std::memory_order_relaxed) * sizeof(Leaf);
+    }
+
+    /// Returns the number of bytes a flat table with the same entries would use
+    [[nodiscard]] static constexpr size_t FlatMemoryUsage() noexcept {
+        return NUM_ENTRIES * sizeof(T);
+    }
+
+private:
+    Leaf* AllocateLeaf(std::atomic<Leaf*>& slot) {
+        auto new_leaf{std::make_unique<Leaf>()};
+        Leaf* expected{nullptr};
+        if (slot.compare_exchange_strong(expected, new_leaf.get(), std::memory_order_acq_rel,
+                                         std::memory_order_acquire)) {
+            num_allocated_leaves.fetch_add(1, std::memory_order_relaxed);
+            return new_leaf.release();
+        }
+        // Another thread allocated the leaf first
+        return expected;
+    }
+
+    std::array<std::atomic<Leaf*>, NUM_LEAVES> leaves{};
+    std::atomic<size_t> num_allocated_leaves{};
+};
+
+} // namespace Common
@@ -250,6 +250,13 @@ void GPU::IncrementSyncPoint(const u32 syncpoint_id) {
     }
 }
 
+bool GPU::IsFenceSignalled(const u32 syncpoint_id, const u32 value) const {
+    if (!is_async || syncpoint_id == UINT32_MAX) {
+        return true;
+    }
+    return syncpoints[syncpoint_id].load() >= value;
+}
+
 u32 GPU::GetSyncpointValue(const u32 syncpoint_id) const {
     return syncpoints[syncpoint_id].load();
 }
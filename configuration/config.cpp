@@ -544,6 +544,7 @@ void Config::ReadControlValues() {
 #else
     Settings::values.enable_raw_input = false;
 #endif
+    ReadBasicSetting(Settings::values.sdl_event_driven);
     ReadBasicSetting(Settings::values.emulate_analog_keyboard);
     Settings::values.mouse_panning = false;
     ReadBasicSetting(Settings::values.mouse_panning_sensitivity);
@@ -660,6 +661,8 @@ void Config::ReadDataStorageValues() {
     ReadBasicSetting(Settings::values.gamecard_inserted);
     ReadBasicSetting(Settings::values.gamecard_current_game);
     ReadBasicSetting(Settings::values.gamecard_path);
+    ReadBasicSetting(Settings::values.use_async_fs_io);
+    ReadBasicSetting(Settings::values.use_save_data_journal);
 
     qt_config->endGroup();
 }
@@ -674,6 +677,7 @@ void Config::ReadDebuggingValues() {
     ReadBasicSetting(Settings::values.dump_exefs);
     ReadBasicSetting(Settings::values.dump_nso);
     ReadBasicSetting(Settings::values.enable_fs_access_log);
+    ReadBasicSetting(Settings::values.enable_ipc_trace);
     ReadBasicSetting(Settings::values.reporting_services);
     ReadBasicSetting(Settings::values.quest_flag);
     ReadBasicSetting(Settings::values.disable_macro_jit);
@@ -776,6 +780,7 @@ void Config::ReadRendererValues() {
 
     if (global) {
         ReadBasicSetting(Settings::values.fps_cap);
+        ReadBasicSetting(Settings::values.align_vsync_to_host);
         ReadBasicSetting(Settings::values.renderer_debug);
         ReadBasicSetting(Settings::values.renderer_shader_feedback);
         ReadBasicSetting(Settings::values.enable_nsight_aftermath);
@@ -1030,6 +1035,7 @@ void Config::SaveControlValues() {
     WriteGlobalSetting(Settings::values.enable_accurate_vibrations);
     WriteGlobalSetting(Settings::values.motion_enabled);
     WriteBasicSetting(Settings::values.enable_raw_input);
+    WriteBasicSetting(Settings::values.sdl_event_driven);
     WriteBasicSetting(Settings::values.keyboard_enabled);
     WriteBasicSetting(Settings::values.emulate_analog_keyboard);
     WriteBasicSetting(Settings::values.mouse_panning_sensitivity);
@@ -1073,6 +1079,8 @@ void Config::SaveDataStorageValues() {
     WriteBasicSetting(Settings::values.gamecard_inserted);
     WriteBasicSetting(Settings::values.gamecard_current_game);
     WriteBasicSetting(Settings::values.gamecard_path);
+    WriteBasicSetting(Settings::values.use_async_fs_io);
+    WriteBasicSetting(Settings::values.use_save_data_journal);
 
     qt_config->endGroup();
 }
@@ -1086,6 +1094,7 @@ void Config::SaveDebuggingValues() {
     WriteBasicSetting(Settings::values.dump_exefs);
     WriteBasicSetting(Settings::values.dump_nso);
     WriteBasicSetting(Settings::values.enable_fs_access_log);
+    WriteBasicSetting(Settings::values.enable_ipc_trace);
     WriteBasicSetting(Settings::values.quest_flag);
     WriteBasicSetting(Settings::values.use_debug_asserts);
     WriteBasicSetting(Settings::values.disable_macro_jit);
@@ -1200,6 +1209,7 @@ void Config::SaveRendererValues() {
 
     if (global) {
         WriteBasicSetting(Settings::values.fps_cap);
+        WriteBasicSetting(Settings::values.align_vsync_to_host);
         WriteBasicSetting(Settings::values.renderer_debug);
         WriteBasicSetting(Settings::values.renderer_shader_feedback);
         WriteBasicSetting(Settings::values.enable_nsight_aftermath);
@@ -0,0 +1,243 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "common/cityhash.h"
+#include "common/fs/fs.h"
+#include "common/fs/path_util.h"
+#include "common/logging/log.h"
+#include "core/file_sys/content_meta_index.h"
+#include "core/file_sys/vfs_real.h"
+
+namespace FileSys {
+
+namespace {
+constexpr std::array<char, 8> MAGIC_NUMBER{'m', 'i', 'z', 'u', 'c', 'm', 'i', 'x'};
+constexpr u32 FORMAT_VERSION = 1;
+
+struct IndexHeader {
+    std::array<char, 8> magic;
+    u32 format_version;
+    u32 num_entries;
+};
+static_assert(sizeof(IndexHeader) == 16);
+} // Anonymous namespace
+
+/// Entries are sorted by id and followed by the CNMT files they point to
+struct ContentMetaIndex::Entry {
+    NcaID id;
+    u64 size;
+    s64 mtime_ns;
+    u64 inode;
+    u64 title_id;
+    u64 cnmt_offset;
+    u32 cnmt_size;
+    u32 reserved;
+    /// Over the rest of the entry and its CNMT, checked when the entry is used
+    u64 checksum;
+
+    u64 ComputeChecksum(std::span<const u8> cnmt) const {
+        const u64 entry_hash =
+            Common::CityHash64(reinterpret_cast<const char*>(this), offsetof(Entry, checksum));
+        return Common::CityHash64WithSeed(reinterpret_cast<const char*>(cnmt.data()), cnmt.size(),
+                                          entry_hash);
+    }
+};
+
+/// Read-only mapping of the whole index file
+struct ContentMetaIndex::Mapping {
+    explicit Mapping(const std::filesystem::path& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return;
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* const addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                data = std::span(static_cast<const u8*>(addr),
+                                 static_cast<std::size_t>(st.st_size));
+            }
+        }
+        ::close(fd);
+    }
+
+    ~Mapping() {
+        if (!data.empty()) {
+            ::munmap(const_cast<u8*>(data.data()), data.size());
+        }
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    std::span<const u8> data;
+    std::span<const Entry> entries;
+};
+
+ContentMetaIndex::ContentMetaIndex(const VirtualDir& dir)
+    : filename{Common::FS::GetMizuPath(Common::FS::MizuPath::CacheDir) / "content_meta" /
+               fmt::format("{:016X}.bin", [&dir] {
+                   const auto path = dir->GetFullPath();
+                   return Common::CityHash64(path.data(), path.size());
+               }())},
+      mapping{std::make_unique<Mapping>(filename)} {
+    static_assert(sizeof(Entry) == 72);
+
+    const auto data = mapping->data;
+    IndexHeader header;
+    if (data.size() < sizeof(header)) {
+        return;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != MAGIC_NUMBER || header.format_version != FORMAT_VERSION ||
+        (data.size() - sizeof(header)) / sizeof(Entry) < header.num_entries) {
+        LOG_WARNING(Service_FS, "Ignoring invalid content meta index {}",
+                    Common::FS::PathToUTF8String(filename));
+        return;
+    }
+    mapping->entries = std::span(reinterpret_cast<const Entry*>(data.data() + sizeof(header)),
+                                 header.num_entries);
+}
+
+ContentMetaIndex::~ContentMetaIndex() = default;
+
+std::optional<ContentMetaIndex::FileStamp> ContentMetaIndex::Stamp(const VirtualFile& file) {
+    const auto* const real_file = dynamic_cast<const RealVfsFile*>(file.get());
+    if (real_file == nullptr) {
+        return std::nullopt;
+    }
+    struct stat st {};
+    if (::fstat(real_file->GetNativeHandle(), &st) != 0) {
+        return std::nullopt;
+    }
+    return FileStamp{
+        .size = static_cast<u64>(st.st_size),
+        .mtime_ns = static_cast<s64>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec,
+        .inode = static_cast<u64>(st.st_ino),
+    };
+}
+
+std::optional<ContentMetaIndex::ParsedNca> ContentMetaIndex::Find(const NcaID& id,
+                                                                  const FileStamp& stamp) {
+    const auto& entries = mapping->entries;
+    const auto it = std::ranges::lower_bound(entries, id, {}, &Entry::id);
+    if (it == entries.end() || it->id != id || it->size != stamp.size ||
+        it->mtime_ns != stamp.mtime_ns || it->inode != stamp.inode) {
+        return std::nullopt;
+    }
+    const auto& data = mapping->data;
+    if (it->cnmt_offset > data.size() || data.size() - it->cnmt_offset < it->cnmt_size) {
+        return std::nullopt;
+    }
+    const auto cnmt = data.subspan(it->cnmt_offset, it->cnmt_size);
+    if (it->ComputeChecksum(cnmt) != it->checksum) {
+        LOG_WARNING(Service_FS, "Corrupted entry in content meta index {}",
+                    Common::FS::PathToUTF8String(filename));
+        return std::nullopt;
+    }
+    found.push_back(&*it);
+    return ParsedNca{
+        .title_id = it->title_id,
+        .cnmt = cnmt,
+    };
+}
+
+void ContentMetaIndex::Add(const NcaID& id, const FileStamp& stamp, u64 title_id,
+                           std::span<const u8> cnmt) {
+    added.push_back({
+        .id = id,
+        .stamp = stamp,
+        .title_id = title_id,
+        .cnmt = std::vector<u8>(cnmt.begin(), cnmt.end()),
+    });
+}
+
+void ContentMetaIndex::Save() {
+    // Every entry was used, and there is nothing new
+    if (added.empty() && found.size() == mapping->entries.size()) {
+        return;
+    }
+
+    struct PendingEntry {
+        Entry entry;
+        std::span<const u8> cnmt;
+    };
+    std::vector<PendingEntry> pending;
+    pending.reserve(found.size() + added.size());
+    for (const AddedNca& nca : added) {
+        pending.push_back({
+            .entry{
+                .id = nca.id,
+                .size = nca.stamp.size,
+                .mtime_ns = nca.stamp.mtime_ns,
+                .inode = nca.stamp.inode,
+                .title_id = nca.title_id,
+            },
+            .cnmt = nca.cnmt,
+        });
+    }
+    for (const Entry* const entry : found) {
+        pending.push_back({
+            .entry = *entry,
+            .cnmt = mapping->data.subspan(entry->cnmt_offset, entry->cnmt_size),
+        });
+    }
+    // An id found twice, e.g. both as a file and as a directory, only needs one entry
+    std::ranges::stable_sort(pending, {}, [](const PendingEntry& pending_entry) {
+        return pending_entry.entry.id;
+    });
+    const auto duplicates = std::ranges::unique(pending, {}, [](const PendingEntry& pending_entry) {
+        return pending_entry.entry.id;
+    });
+    pending.erase(duplicates.begin(), duplicates.end());
+
+    u64 cnmt_offset = sizeof(IndexHeader) + pending.size() * sizeof(Entry);
+    for (auto& [entry, cnmt] : pending) {
+        entry.cnmt_offset = cnmt_offset;
+        entry.cnmt_size = static_cast<u32>(cnmt.size());
+        entry.reserved = 0;
+        entry.checksum = entry.ComputeChecksum(cnmt);
+        cnmt_offset += cnmt.size();
+    }
+
+    if (!Common::FS::CreateDirs(filename.parent_path())) {
+        return;
+    }
+    auto temp_filename{filename};
+    temp_filename += ".tmp";
+    try {
+        std::ofstream file(temp_filename, std::ios::binary | std::ios::trunc);
+        file.exceptions(std::ofstream::failbit);
+        const IndexHeader header{MAGIC_NUMBER, FORMAT_VERSION, static_cast<u32>(pending.size())};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& [entry, cnmt] : pending) {
+            file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        }
+        for (const auto& [entry, cnmt] : pending) {
+            file.write(reinterpret_cast<const char*>(cnmt.data()), cnmt.size());
+        }
+    } catch (const std::ios_base::failure& e) {
+        LOG_ERROR(Service_FS, "Unable to write content meta index: {}", e.what());
+        Common::FS::RemoveFile(temp_filename);
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_filename, filename, ec);
+    if (ec) {
+        Common::FS::RemoveFile(temp_filename);
+    }
+}
+
+} // namespace FileSys
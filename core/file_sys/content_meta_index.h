@@ -0,0 +1,75 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+#include "common/common_types.h"
+#include "core/file_sys/registered_cache.h"
+
+namespace FileSys {
+
+/**
+ * Persistent index of what parsing the NCAs of a registered cache found, so that a refresh does
+ * not derive keys and decrypt headers again for content that did not change. The index is mapped
+ * and each entry is only validated when it is looked up, against the size, modification time and
+ * inode of the file it was parsed from. Content that is decrypted before it is parsed, like NAX
+ * content on the SD card, is not indexed, as the result also depends on the keys.
+ */
+class ContentMetaIndex {
+public:
+    /// Identifies the version of a content file that was parsed
+    struct FileStamp {
+        u64 size;
+        s64 mtime_ns;
+        u64 inode;
+    };
+
+    /// What parsing an NCA found, cnmt is the raw CNMT file of meta NCAs and empty otherwise
+    struct ParsedNca {
+        u64 title_id;
+        std::span<const u8> cnmt;
+    };
+
+    /// Maps the index stored for the cache in dir, starts empty if there is no valid one
+    explicit ContentMetaIndex(const VirtualDir& dir);
+    ~ContentMetaIndex();
+
+    ContentMetaIndex(const ContentMetaIndex&) = delete;
+    ContentMetaIndex& operator=(const ContentMetaIndex&) = delete;
+
+    /// Stamps a content file, nullopt if it is not a real file whose changes could be detected
+    static std::optional<FileStamp> Stamp(const VirtualFile& file);
+
+    /// Looks up the NCA with id, nullopt if it was not parsed from a file with this stamp
+    std::optional<ParsedNca> Find(const NcaID& id, const FileStamp& stamp);
+
+    /// Adds what parsing the NCA with id found, only NCAs that parsed successfully belong here
+    void Add(const NcaID& id, const FileStamp& stamp, u64 title_id, std::span<const u8> cnmt);
+
+    /// Replaces the stored index with the NCAs found or added since it was mapped, if they differ
+    void Save();
+
+private:
+    struct Entry;
+    struct Mapping;
+
+    struct AddedNca {
+        NcaID id;
+        FileStamp stamp;
+        u64 title_id;
+        std::vector<u8> cnmt;
+    };
+
+    std::filesystem::path filename;
+    std::unique_ptr<Mapping> mapping;
+    /// Entries of the mapping that were found still valid
+    std::vector<const Entry*> found;
+    std::vector<AddedNca> added;
+};
+
+} // namespace FileSys
@@ -5,21 +5,27 @@
 // Adapted by Kent Hall for mizu on Horizon Linux.
 
 #include <algorithm>
+#include <latch>
 #include <random>
+#include <ranges>
 #include <regex>
+#include <thread>
 #include <mbedtls/sha256.h>
 #include "common/assert.h"
 #include "common/fs/path_util.h"
 #include "common/hex_util.h"
 #include "common/logging/log.h"
+#include "common/thread_worker.h"
 #include "core/crypto/key_manager.h"
 #include "core/file_sys/card_image.h"
 #include "core/file_sys/common_funcs.h"
 #include "core/file_sys/content_archive.h"
+#include "core/file_sys/content_meta_index.h"
 #include "core/file_sys/nca_metadata.h"
 #include "core/file_sys/registered_cache.h"
 #include "core/file_sys/submission_package.h"
 #include "core/file_sys/vfs_concat.h"
+#include "core/file_sys/vfs_vector.h"
 #include "core/loader/loader.h"
 
 namespace FileSys {
@@ -411,29 +417,128 @@ std::vector<NcaID> RegisteredCache::AccumulateFiles() const {
     return ids;
 }
 
+static std::size_t GetNumScanWorkers() {
+    return std::max(std::thread::hardware_concurrency(), 1U);
+}
+
+static Common::ThreadWorker& GetScanWorkers() {
+    static Common::ThreadWorker workers(GetNumScanWorkers(), "mizu:ContentScan");
+    return workers;
+}
+
 void RegisteredCache::ProcessFiles(const std::vector<NcaID>& ids) {
-    for (const auto& id : ids) {
-        const auto file = GetFileAtID(id);
+    struct ScannedNca {
+        NcaID id;
+        std::optional<ContentMetaIndex::FileStamp> stamp;
+        bool in_index;
+        /// What parser made of the file, until it is parsed as an NCA
+        VirtualFile parsed_file;
+        bool success;
+        u64 title_id;
+        /// Raw CNMT file of meta NCAs, empty otherwise
+        std::vector<u8> cnmt;
+    };
 
-        if (file == nullptr)
-            continue;
-        const auto nca = std::make_shared<NCA>(parser(file, id), nullptr, 0);
-        if (nca->GetStatus() != Loader::ResultStatus::Success ||
-            nca->GetType() != NCAContentType::Meta) {
-            continue;
-        }
+    // Content that was parsed before is looked up instead, without decrypting it again
+    ContentMetaIndex index{dir};
 
-        const auto section0 = nca->GetSubdirectories()[0];
+    const auto parse = [](ScannedNca& scanned_nca) {
+        const NCA nca(std::move(scanned_nca.parsed_file), nullptr, 0);
+        if (nca.GetStatus() != Loader::ResultStatus::Success) {
+            return;
+        }
+        scanned_nca.success = true;
+        scanned_nca.title_id = nca.GetTitleId();
+        if (nca.GetType() != NCAContentType::Meta) {
+            return;
+        }
+        for (const auto& section0_file : nca.GetSubdirectories()[0]->GetFiles()) {
+            if (section0_file->GetExtension() == "cnmt") {
+                scanned_nca.cnmt = section0_file->ReadAllBytes();
+                break;
+            }
+        }
+    };
 
-        for (const auto& section0_file : section0->GetFiles()) {
-            if (section0_file->GetExtension() != "cnmt")
+    // Every file waiting to be parsed is open, so they are scanned a few per worker at a time,
+    // rather than running out of file descriptors on a large library
+    const std::size_t batch_size = 2 * GetNumScanWorkers();
+    std::vector<ScannedNca> scanned;
+    scanned.reserve(batch_size);
+    for (auto batch_begin = ids.begin(); batch_begin != ids.end();) {
+        const auto batch_end =
+            batch_begin + std::min<std::ptrdiff_t>(ids.end() - batch_begin, batch_size);
+
+        // Opening files and the parser (which may derive keys) are not thread safe, so only the
+        // NCAs themselves are parsed on the workers
+        scanned.clear();
+        std::size_t num_to_parse = 0;
+        for (const auto& id : std::ranges::subrange(batch_begin, batch_end)) {
+            const auto file = GetFileAtID(id);
+
+            if (file == nullptr)
                 continue;
 
-            meta.insert_or_assign(nca->GetTitleId(), CNMT(section0_file));
-            meta_id.insert_or_assign(nca->GetTitleId(), id);
-            break;
+            auto& nca = scanned.emplace_back(ScannedNca{.id = id});
+            nca.parsed_file = parser(file, id);
+            // What parsing finds in a file the parser changes, e.g. by NAX decryption, also
+            // depends on its keys, so only files the parser passes through as they are get indexed
+            if (nca.parsed_file == file) {
+                nca.stamp = ContentMetaIndex::Stamp(file);
+            }
+            if (nca.stamp) {
+                if (const auto parsed = index.Find(id, *nca.stamp)) {
+                    nca.in_index = true;
+                    nca.parsed_file = nullptr;
+                    nca.success = true;
+                    nca.title_id = parsed->title_id;
+                    nca.cnmt.assign(parsed->cnmt.begin(), parsed->cnmt.end());
+                    continue;
+                }
+            }
+            ++num_to_parse;
+        }
+        batch_begin = batch_end;
+
+        if (num_to_parse > 1) {
+            // Decrypting headers dominates, so whichever worker is free takes the next NCA
+            Common::ThreadWorker& workers = GetScanWorkers();
+            std::latch done{static_cast<std::ptrdiff_t>(num_to_parse)};
+            for (auto& scanned_nca : scanned) {
+                if (scanned_nca.in_index) {
+                    continue;
+                }
+                workers.QueueWork([&parse, &scanned_nca, &done] {
+                    parse(scanned_nca);
+                    done.count_down();
+                });
+            }
+            done.wait();
+        } else {
+            for (auto& scanned_nca : scanned) {
+                if (!scanned_nca.in_index) {
+                    parse(scanned_nca);
+                }
+            }
+        }
+
+        // Merged in the order of ids, so that the same meta wins as when parsing one by one
+        for (const auto& [id, stamp, in_index, parsed_file, success, title_id, cnmt] : scanned) {
+            if (!success) {
+                // Not remembered, it may parse once the missing keys are there
+                continue;
+            }
+            if (stamp && !in_index) {
+                index.Add(id, *stamp, title_id, cnmt);
+            }
+            if (!cnmt.empty()) {
+                meta.insert_or_assign(title_id, CNMT(std::make_shared<VectorVfsFile>(cnmt)));
+                meta_id.insert_or_assign(title_id, id);
+            }
         }
     }
+
+    index.Save();
 }
 
 void RegisteredCache::AccumulateMizuMeta() {
@@ -794,6 +899,8 @@ void ContentProviderUnion::ClearSlot(ContentProviderUnionSlot slot) {
 }
 
 void ContentProviderUnion::Refresh() {
+    // The providers share the open file cache of the real filesystem, so they refresh one after
+    // the other and each one spreads its own parsing over the scan workers
     for (auto& provider : providers) {
         if (provider.second == nullptr)
             continue;
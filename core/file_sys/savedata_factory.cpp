@@ -8,8 +8,11 @@
 #include "common/assert.h"
 #include "common/common_types.h"
 #include "common/logging/log.h"
+#include "common/settings.h"
 #include "core/core.h"
+#include "core/file_sys/errors.h"
 #include "core/file_sys/savedata_factory.h"
+#include "core/file_sys/savedata_journal.h"
 #include "core/file_sys/vfs.h"
 #include "core/hle/service/service.h"
 
@@ -108,7 +111,11 @@ ResultVal<VirtualDir> SaveDataFactory::Open(SaveDataSpaceId space,
     auto out = dir->GetDirectoryRelative(save_directory);
 
     if (out == nullptr && (ShouldSaveDataBeAutomaticallyCreated(space, meta) && auto_create)) {
-        return Create(space, meta);
+        auto created = Create(space, meta);
+        if (created.Failed()) {
+            return created;
+        }
+        out = *created;
     }
 
     // Return an error if the save data doesn't actually exist.
@@ -117,9 +124,33 @@ ResultVal<VirtualDir> SaveDataFactory::Open(SaveDataSpaceId space,
         return ResultUnknown;
     }
 
+    // Opening the journal finishes a commit interrupted by a crash, also with the setting off, as
+    // turning it back on later would apply the old journal over what was written since
+    auto journal = GetJournal(save_directory, out);
+    if (journal == nullptr) {
+        LOG_ERROR(Service_FS, "Unable to open the journal of save data {}", save_directory);
+        return ERROR_FAILED_MOUNT_ARCHIVE;
+    }
+    if (Settings::values.use_save_data_journal.GetValue()) {
+        out = std::make_shared<JournaledVfsDirectory>(std::move(journal), std::move(out));
+    }
+
     return MakeResult<VirtualDir>(std::move(out));
 }
 
+std::shared_ptr<SaveDataJournal> SaveDataFactory::GetJournal(const std::string& save_directory,
+                                                             const VirtualDir& save) const {
+    std::scoped_lock lock{journal_mutex};
+    std::erase_if(journals, [](const auto& entry) { return entry.second.expired(); });
+    auto& cached = journals[save_directory];
+    auto journal = cached.lock();
+    if (journal == nullptr) {
+        journal = OpenSaveDataJournal(save);
+        cached = journal;
+    }
+    return journal;
+}
+
 VirtualDir SaveDataFactory::GetSaveDataSpaceDirectory(SaveDataSpaceId space) const {
     return dir->GetDirectoryRelative(GetSaveDataSpaceIdPath(space));
 }
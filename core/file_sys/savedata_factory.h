@@ -6,7 +6,9 @@
 
 #pragma once
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include "common/common_funcs.h"
 #include "common/common_types.h"
@@ -16,6 +18,8 @@
 
 namespace FileSys {
 
+class SaveDataJournal;
+
 enum class SaveDataSpaceId : u8 {
     NandSystem = 0,
     NandUser = 1,
@@ -105,8 +109,16 @@ public:
     void SetAutoCreate(bool state);
 
 private:
+    /// Returns the journal that stages the writes to the save data until they are committed
+    std::shared_ptr<SaveDataJournal> GetJournal(const std::string& save_directory,
+                                                const VirtualDir& save) const;
+
     VirtualDir dir;
     bool auto_create{true};
+
+    /// Journals of the open save data, shared by every file system opened for it
+    mutable std::mutex journal_mutex;
+    mutable std::map<std::string, std::weak_ptr<SaveDataJournal>> journals;
 };
 
 } // namespace FileSys
@@ -0,0 +1,863 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common/cityhash.h"
+#include "common/common_funcs.h"
+#include "common/fs/path_util.h"
+#include "common/literals.h"
+#include "common/logging/log.h"
+#include "core/file_sys/savedata_journal.h"
+#include "core/file_sys/vfs_real.h"
+
+namespace FileSys {
+
+using namespace Common::Literals;
+
+namespace {
+constexpr u32 JOURNAL_MAGIC = Common::MakeMagic('M', 'J', 'N', 'L');
+constexpr u32 JOURNAL_VERSION = 1;
+constexpr char JOURNAL_SUFFIX[] = ".mizu_journal";
+
+/// Staged data beyond this is written back early, without waiting for the commit
+constexpr std::size_t MAX_STAGED_SIZE = 64_MiB;
+
+/// Commits of more files than this sync the whole host file system at once instead
+constexpr std::size_t SYNCFS_THRESHOLD = 16;
+
+// The journal only lives on the host that wrote it, so it is kept in host byte order
+struct JournalHeader {
+    u32 magic;
+    u32 version;
+    u32 num_files;
+    u32 reserved;
+    u64 payload_size;
+    /// CityHash64 of the payload, a journal torn by a crash does not match it
+    u64 checksum;
+};
+
+/// Followed by the path, relative to the save data root, then by the extents
+struct JournalFileHeader {
+    u64 size;
+    u64 truncated_size;
+    u32 num_extents;
+    u32 path_length;
+};
+
+/// Followed by length bytes of data
+struct JournalExtentHeader {
+    u64 offset;
+    u64 length;
+};
+
+/// Writes of one file that have not been applied to it yet
+struct StagedFile {
+    VirtualFile backing;
+    /// Size of the file once the writes are applied
+    std::size_t size = 0;
+    /// Data of the backing file past this was cut off by a resize and reads as zeros
+    std::size_t truncated_size = 0;
+    /// Disjoint, non-adjacent ranges of written data by their offset
+    std::map<std::size_t, std::vector<u8>> extents;
+};
+
+std::string JoinPath(std::string_view base, std::string_view relative_path) {
+    std::string path{base};
+    for (const auto& component : Common::FS::SplitPathComponents(relative_path)) {
+        if (component.empty() || component == ".") {
+            continue;
+        }
+        if (!path.empty()) {
+            path += '/';
+        }
+        path += component;
+    }
+    return path;
+}
+
+std::string_view GetParentPath(std::string_view path) {
+    const auto separator = path.rfind('/');
+    return separator == std::string_view::npos ? std::string_view{} : path.substr(0, separator);
+}
+
+/// Whether path is prefix itself or lies below it, everything lies below the empty root path
+bool IsWithin(std::string_view path, std::string_view prefix) {
+    return prefix.empty() || (path.starts_with(prefix) &&
+                              (path.size() == prefix.size() || path[prefix.size()] == '/'));
+}
+
+int GetNativeHandle(const VirtualFile& file) {
+    const auto* const real_file = dynamic_cast<const RealVfsFile*>(file.get());
+    return real_file ? real_file->GetNativeHandle() : -1;
+}
+
+/// Syncs the entries of a real directory, so that files created in it or removed from it persist
+bool SyncDirectory(const std::string& host_path) {
+    const int fd = ::open(host_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        LOG_ERROR(Service_FS, "Unable to open {} for syncing: {}", host_path, ::strerror(errno));
+        return false;
+    }
+    const bool synced = ::fsync(fd) == 0;
+    if (!synced) {
+        LOG_ERROR(Service_FS, "Unable to sync {}: {}", host_path, ::strerror(errno));
+    }
+    ::close(fd);
+    return synced;
+}
+
+template <typename T>
+void Append(std::vector<u8>& out, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const auto* const bytes = reinterpret_cast<const u8*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+/// Reads the records of a journal, fails if it is incomplete or not a journal at all
+std::optional<std::vector<std::pair<std::string, StagedFile>>> ParseJournal(
+    const std::vector<u8>& data) {
+    std::size_t offset = 0;
+    const auto read = [&](void* dest, std::size_t length) {
+        if (data.size() - offset < length) {
+            return false;
+        }
+        std::memcpy(dest, data.data() + offset, length);
+        offset += length;
+        return true;
+    };
+
+    JournalHeader header;
+    if (!read(&header, sizeof(header)) || header.magic != JOURNAL_MAGIC ||
+        header.version != JOURNAL_VERSION || header.payload_size != data.size() - offset ||
+        Common::CityHash64(reinterpret_cast<const char*>(data.data() + offset),
+                           header.payload_size) != header.checksum) {
+        return std::nullopt;
+    }
+
+    std::vector<std::pair<std::string, StagedFile>> files;
+    for (u32 i = 0; i < header.num_files; ++i) {
+        JournalFileHeader file_header;
+        if (!read(&file_header, sizeof(file_header))) {
+            return std::nullopt;
+        }
+        std::string path(file_header.path_length, '\0');
+        if (!read(path.data(), path.size())) {
+            return std::nullopt;
+        }
+        StagedFile file{
+            .size = file_header.size,
+            .truncated_size = file_header.truncated_size,
+        };
+        for (u32 j = 0; j < file_header.num_extents; ++j) {
+            JournalExtentHeader extent_header;
+            if (!read(&extent_header, sizeof(extent_header)) ||
+                data.size() - offset < extent_header.length) {
+                return std::nullopt;
+            }
+            std::vector<u8> extent(extent_header.length);
+            read(extent.data(), extent.size());
+            file.extents.emplace(extent_header.offset, std::move(extent));
+        }
+        files.emplace_back(std::move(path), std::move(file));
+    }
+    return files;
+}
+
+/// Writes the staged data to the backing file, without syncing it
+bool Apply(const StagedFile& file) {
+    if (file.truncated_size < file.backing->GetSize() &&
+        !file.backing->Resize(file.truncated_size)) {
+        return false;
+    }
+    if (file.size != file.backing->GetSize() && !file.backing->Resize(file.size)) {
+        return false;
+    }
+    return std::ranges::all_of(file.extents, [&file](const auto& extent) {
+        const auto& [offset, data] = extent;
+        return file.backing->Write(data.data(), data.size(), offset) == data.size();
+    });
+}
+
+/**
+ * Syncs the data of the files, also the size and other metadata needed to read it back. Writeback
+ * is started for all of them before waiting on any, so that the disk sees them as one batch.
+ */
+bool SyncFiles(const std::vector<VirtualFile>& files) {
+    std::vector<int> fds;
+    for (const auto& file : files) {
+        const int fd = GetNativeHandle(file);
+        if (fd != -1) {
+            fds.push_back(fd);
+        }
+    }
+    std::ranges::sort(fds);
+    fds.erase(std::unique(fds.begin(), fds.end()), fds.end());
+
+    if (fds.size() > SYNCFS_THRESHOLD) {
+        if (::syncfs(fds.front()) == 0) {
+            return true;
+        }
+        LOG_WARNING(Service_FS, "Unable to sync the file system: {}", ::strerror(errno));
+    }
+    for (const int fd : fds) {
+        ::sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+    }
+    bool synced = true;
+    for (const int fd : fds) {
+        if (::fdatasync(fd) != 0) {
+            LOG_ERROR(Service_FS, "Unable to sync save data: {}", ::strerror(errno));
+            synced = false;
+        }
+    }
+    return synced;
+}
+} // Anonymous namespace
+
+class SaveDataJournal {
+public:
+    SaveDataJournal(VirtualDir root_, VirtualDir journal_dir_, std::string journal_name_)
+        : root{std::move(root_)}, journal_dir{std::move(journal_dir_)},
+          journal_name{std::move(journal_name_)} {}
+
+    ~SaveDataJournal() {
+        // Nothing is lost when the title forgets to commit, it is just not synced
+        std::scoped_lock lock{mutex};
+        if (!files.empty()) {
+            LOG_DEBUG(Service_FS, "Writing back {} bytes of {} that were not committed",
+                      staged_size, root->GetFullPath());
+            WriteBack({});
+        }
+    }
+
+    std::size_t GetSize(const std::string& path, const VirtualFile& backing) {
+        std::unique_lock lock{mutex};
+        const auto it = files.find(path);
+        if (it == files.end()) {
+            lock.unlock();
+            return backing->GetSize();
+        }
+        return it->second.size;
+    }
+
+    bool Resize(const std::string& path, const VirtualFile& backing, std::size_t new_size) {
+        if (!backing->IsWritable()) {
+            return false;
+        }
+        std::scoped_lock lock{mutex};
+        StagedFile& file = Stage(path, backing);
+        if (new_size < file.size) {
+            file.truncated_size = std::min(file.truncated_size, new_size);
+            auto it = file.extents.lower_bound(new_size);
+            for (auto erased = it; erased != file.extents.end(); ++erased) {
+                staged_size -= erased->second.size();
+            }
+            file.extents.erase(it, file.extents.end());
+            if (!file.extents.empty()) {
+                auto& [offset, data] = *file.extents.rbegin();
+                if (offset + data.size() > new_size) {
+                    staged_size -= offset + data.size() - new_size;
+                    data.resize(new_size - offset);
+                }
+            }
+        }
+        file.size = new_size;
+        return true;
+    }
+
+    std::size_t Read(const std::string& path, const VirtualFile& backing, u8* data,
+                     std::size_t length, std::size_t offset) {
+        std::unique_lock lock{mutex};
+        const auto it = files.find(path);
+        if (it == files.end()) {
+            lock.unlock();
+            return backing->Read(data, length, offset);
+        }
+
+        const StagedFile& file = it->second;
+        if (offset >= file.size) {
+            return 0;
+        }
+        length = std::min(length, file.size - offset);
+        const std::size_t end = offset + length;
+
+        std::size_t backing_read = 0;
+        if (offset < file.truncated_size) {
+            backing_read = file.backing->Read(data, std::min(end, file.truncated_size) - offset,
+                                              offset);
+        }
+        std::fill(data + backing_read, data + length, u8{0});
+
+        auto extent = file.extents.upper_bound(offset);
+        if (extent != file.extents.begin()) {
+            --extent;
+        }
+        for (; extent != file.extents.end() && extent->first < end; ++extent) {
+            const std::size_t extent_end = extent->first + extent->second.size();
+            const std::size_t copy_begin = std::max(offset, extent->first);
+            const std::size_t copy_end = std::min(end, extent_end);
+            if (copy_begin < copy_end) {
+                std::memcpy(data + (copy_begin - offset),
+                            extent->second.data() + (copy_begin - extent->first),
+                            copy_end - copy_begin);
+            }
+        }
+        return length;
+    }
+
+    std::size_t Write(const std::string& path, const VirtualFile& backing, const u8* data,
+                      std::size_t length, std::size_t offset) {
+        if (!backing->IsWritable()) {
+            return 0;
+        }
+        if (length == 0) {
+            return 0;
+        }
+        std::scoped_lock lock{mutex};
+        StagedFile& file = Stage(path, backing);
+        StageWrite(file, data, length, offset);
+        file.size = std::max(file.size, offset + length);
+
+        if (staged_size > MAX_STAGED_SIZE) {
+            LOG_WARNING(Service_FS, "Over {} MiB of save data staged, writing it back early",
+                        MAX_STAGED_SIZE / 1_MiB);
+            WriteBack({});
+        }
+        return length;
+    }
+
+    /// Drops the staged writes to path and everything below it, when it is deleted or truncated
+    void Discard(std::string_view path) {
+        std::scoped_lock lock{mutex};
+        std::erase_if(files, [this, path](auto& entry) {
+            if (!IsWithin(entry.first, path)) {
+                return false;
+            }
+            for (const auto& extent : entry.second.extents) {
+                staged_size -= extent.second.size();
+            }
+            return true;
+        });
+        std::erase_if(unsynced_files, [path](const auto& entry) {
+            return IsWithin(entry.first, path);
+        });
+    }
+
+    /// Applies the staged writes to path and everything below it, before it is renamed
+    void Flush(std::string_view path) {
+        std::scoped_lock lock{mutex};
+        WriteBack(path);
+    }
+
+    /// Notes that the entries of a directory changed, so that the commit syncs it
+    void MarkDirectoryChanged(const VirtualDir& dir) {
+        if (dir == nullptr) {
+            return;
+        }
+        std::scoped_lock lock{mutex};
+        changed_directories.insert(dir->GetFullPath());
+    }
+
+    /**
+     * Writing the journal and applying it hold the lock, so other requests on the save data wait
+     * for one sync of the journal. Syncing the files only holds commit_mutex, which a write back
+     * waits on, and so does the next commit.
+     */
+    bool Commit() {
+        std::unique_lock lock{mutex};
+        std::unique_lock commit_lock{commit_mutex};
+        if (files.empty() && unsynced_files.empty() && changed_directories.empty()) {
+            return true;
+        }
+        const auto start_time = std::chrono::steady_clock::now();
+        const std::size_t committed_size = staged_size;
+        const std::size_t num_files = files.size() + unsynced_files.size();
+
+        // Once the journal is on the disk, the commit is finished by Recover even after a crash
+        if (!files.empty() && !WriteJournal()) {
+            return false;
+        }
+
+        bool success = true;
+        std::vector<VirtualFile> touched_files;
+        touched_files.reserve(num_files);
+        for (const auto& [path, file] : files) {
+            if (!Apply(file)) {
+                LOG_ERROR(Service_FS, "Unable to apply the staged writes to {}", path);
+                success = false;
+            }
+            touched_files.push_back(file.backing);
+        }
+        for (const auto& [path, file] : unsynced_files) {
+            touched_files.push_back(file);
+        }
+        files.clear();
+        unsynced_files.clear();
+        staged_size = 0;
+        const auto directories = std::exchange(changed_directories, {});
+        lock.unlock();
+
+        success &= SyncFiles(touched_files);
+        for (const auto& dir : directories) {
+            success &= SyncDirectory(dir);
+        }
+
+        // The journal is kept for Recover to apply it again if anything went wrong
+        if (journal_on_disk && success) {
+            journal_dir->DeleteFile(journal_name);
+            journal_on_disk = false;
+            is_journal_removal_synced = false;
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time);
+        LOG_DEBUG(Service_FS, "Committed {} bytes to {} files of {} in {} us", committed_size,
+                  num_files, root->GetFullPath(), elapsed.count());
+        return success;
+    }
+
+    /**
+     * Finishes the commit the last journal was written for. Fails if a file could not be
+     * recovered, the journal is then kept so that the next open tries again.
+     */
+    bool Recover() {
+        const VirtualFile journal_file = journal_dir->GetFile(journal_name);
+        if (journal_file == nullptr) {
+            return true;
+        }
+        auto recovered_files = ParseJournal(journal_file->ReadAllBytes());
+        if (!recovered_files) {
+            // It was torn while being written, so none of its commit was applied
+            LOG_WARNING(Service_FS, "Discarding the incomplete save data journal of {}",
+                        root->GetFullPath());
+        } else {
+            std::vector<VirtualFile> touched_files;
+            for (auto& [path, file] : *recovered_files) {
+                file.backing = root->GetFileRelative(path);
+                if (file.backing == nullptr) {
+                    file.backing = root->CreateFileRelative(path);
+                }
+                if (file.backing == nullptr || !Apply(file)) {
+                    LOG_ERROR(Service_FS, "Unable to recover the save data file {}", path);
+                    return false;
+                }
+                touched_files.push_back(file.backing);
+            }
+            if (!SyncFiles(touched_files)) {
+                return false;
+            }
+            LOG_INFO(Service_FS, "Recovered {} files of {} from its journal",
+                     touched_files.size(), root->GetFullPath());
+        }
+        journal_dir->DeleteFile(journal_name);
+        SyncDirectory(journal_dir->GetFullPath());
+        return true;
+    }
+
+private:
+    StagedFile& Stage(const std::string& path, const VirtualFile& backing) {
+        const auto [it, inserted] = files.try_emplace(path);
+        if (inserted) {
+            it->second.backing = backing;
+            it->second.size = backing->GetSize();
+            it->second.truncated_size = it->second.size;
+        }
+        return it->second;
+    }
+
+    /// Copies the data into the extents, merging it with those it overlaps or touches
+    void StageWrite(StagedFile& file, const u8* data, std::size_t length, std::size_t offset) {
+        auto& extents = file.extents;
+        const std::size_t end = offset + length;
+
+        auto first = extents.upper_bound(offset);
+        if (first != extents.begin()) {
+            const auto previous = std::prev(first);
+            if (previous->first + previous->second.size() >= offset) {
+                first = previous;
+            }
+        }
+        if (first != extents.end() && first->first <= offset &&
+            first->first + first->second.size() >= end) {
+            // Overwrites staged data, the common case for titles rewriting the same save
+            std::memcpy(first->second.data() + (offset - first->first), data, length);
+            return;
+        }
+
+        auto last = first;
+        std::size_t merged_begin = offset;
+        std::size_t merged_end = end;
+        for (; last != extents.end() && last->first <= end; ++last) {
+            merged_begin = std::min(merged_begin, last->first);
+            merged_end = std::max(merged_end, last->first + last->second.size());
+        }
+
+        std::vector<u8> merged;
+        if (first != last && first->first == merged_begin) {
+            // Extends the first extent in place rather than copying it
+            merged = std::move(first->second);
+        }
+        staged_size -= merged.size();
+        merged.resize(merged_end - merged_begin);
+        for (auto it = first; it != last; ++it) {
+            staged_size -= it->second.size();
+            std::ranges::copy(it->second, merged.begin() + (it->first - merged_begin));
+        }
+        std::memcpy(merged.data() + (offset - merged_begin), data, length);
+        staged_size += merged.size();
+
+        extents.erase(first, last);
+        extents.emplace(merged_begin, std::move(merged));
+    }
+
+    /// Applies the staged writes below path without a journal, they are synced by the next commit
+    void WriteBack(std::string_view path) {
+        // A commit still syncing has not removed its journal yet
+        std::scoped_lock commit_lock{commit_mutex};
+        if (journal_on_disk) {
+            // Left by a failed commit, whose data is older than what is written now
+            journal_dir->DeleteFile(journal_name);
+            journal_on_disk = false;
+            is_journal_removal_synced = false;
+        }
+        if (!is_journal_removal_synced) {
+            // Otherwise a crash could bring back the last journal, and Recover would apply its
+            // older data over what is written now
+            is_journal_removal_synced = SyncDirectory(journal_dir->GetFullPath());
+        }
+        std::erase_if(files, [this, path](auto& entry) {
+            auto& [file_path, file] = entry;
+            if (!IsWithin(file_path, path)) {
+                return false;
+            }
+            if (!Apply(file)) {
+                LOG_ERROR(Service_FS, "Unable to write back the staged writes to {}", file_path);
+            }
+            for (const auto& extent : file.extents) {
+                staged_size -= extent.second.size();
+            }
+            unsynced_files.insert_or_assign(file_path, file.backing);
+            return true;
+        });
+    }
+
+    bool WriteJournal() {
+        std::vector<u8> journal(sizeof(JournalHeader));
+        journal.reserve(sizeof(JournalHeader) + staged_size);
+        for (const auto& [path, file] : files) {
+            Append(journal, JournalFileHeader{
+                                .size = file.size,
+                                .truncated_size = file.truncated_size,
+                                .num_extents = static_cast<u32>(file.extents.size()),
+                                .path_length = static_cast<u32>(path.size()),
+                            });
+            journal.insert(journal.end(), path.begin(), path.end());
+            for (const auto& [offset, data] : file.extents) {
+                Append(journal, JournalExtentHeader{.offset = offset, .length = data.size()});
+                journal.insert(journal.end(), data.begin(), data.end());
+            }
+        }
+        const std::size_t payload_size = journal.size() - sizeof(JournalHeader);
+        const JournalHeader header{
+            .magic = JOURNAL_MAGIC,
+            .version = JOURNAL_VERSION,
+            .num_files = static_cast<u32>(files.size()),
+            .payload_size = payload_size,
+            .checksum = Common::CityHash64(
+                reinterpret_cast<const char*>(journal.data() + sizeof(JournalHeader)),
+                payload_size),
+        };
+        std::memcpy(journal.data(), &header, sizeof(header));
+
+        const VirtualFile journal_file = journal_dir->CreateFile(journal_name);
+        if (journal_file == nullptr || !journal_file->Resize(journal.size()) ||
+            journal_file->WriteBytes(journal) != journal.size() || !SyncFiles({journal_file}) ||
+            !SyncDirectory(journal_dir->GetFullPath())) {
+            LOG_ERROR(Service_FS, "Unable to write the save data journal of {}",
+                      root->GetFullPath());
+            journal_dir->DeleteFile(journal_name);
+            return false;
+        }
+        journal_on_disk = true;
+        is_journal_removal_synced = true;
+        return true;
+    }
+
+
+    VirtualDir root;
+    VirtualDir journal_dir;
+    std::string journal_name;
+
+    std::mutex mutex;
+    /// Held by a commit until its journal is removed, taken after mutex
+    std::mutex commit_mutex;
+    std::map<std::string, StagedFile, std::less<>> files;
+    /// Total size of the staged extents
+    std::size_t staged_size = 0;
+    /// Files written back before the commit, which still have to be synced by it
+    std::map<std::string, VirtualFile, std::less<>> unsynced_files;
+    /// Host paths of the directories whose entries changed since the last commit
+    std::set<std::string> changed_directories;
+    /// Whether a journal written by this instance is still on the disk, guarded by commit_mutex
+    bool journal_on_disk = false;
+    /// Whether the deletion of the last journal has reached the disk, guarded by commit_mutex
+    bool is_journal_removal_synced = true;
+};
+
+namespace {
+// File of save data whose writes go to the journal
+class JournaledVfsFile : public VfsFile {
+public:
+    JournaledVfsFile(std::shared_ptr<SaveDataJournal> journal_, VirtualFile backing_,
+                     std::string path_)
+        : journal{std::move(journal_)}, backing{std::move(backing_)}, path{std::move(path_)} {}
+
+    std::string GetName() const override {
+        return backing->GetName();
+    }
+
+    std::size_t GetSize() const override {
+        return journal->GetSize(path, backing);
+    }
+
+    bool Resize(std::size_t new_size) override {
+        return journal->Resize(path, backing, new_size);
+    }
+
+    VirtualDir GetContainingDirectory() const override {
+        auto dir = backing->GetContainingDirectory();
+        if (dir == nullptr) {
+            return nullptr;
+        }
+        return std::make_shared<JournaledVfsDirectory>(journal, std::move(dir),
+                                                       std::string(GetParentPath(path)));
+    }
+
+    bool IsWritable() const override {
+        return backing->IsWritable();
+    }
+
+    bool IsReadable() const override {
+        return backing->IsReadable();
+    }
+
+    std::size_t Read(u8* data, std::size_t length, std::size_t offset) const override {
+        return journal->Read(path, backing, data, length, offset);
+    }
+
+    std::size_t Write(const u8* data, std::size_t length, std::size_t offset) override {
+        return journal->Write(path, backing, data, length, offset);
+    }
+
+    bool Rename(std::string_view name) override {
+        journal->Flush(path);
+        if (!backing->Rename(name)) {
+            return false;
+        }
+        journal->MarkDirectoryChanged(backing->GetContainingDirectory());
+        path = JoinPath(GetParentPath(path), name);
+        return true;
+    }
+
+    std::string GetFullPath() const override {
+        return backing->GetFullPath();
+    }
+
+private:
+    std::shared_ptr<SaveDataJournal> journal;
+    VirtualFile backing;
+    std::string path;
+};
+} // Anonymous namespace
+
+std::shared_ptr<SaveDataJournal> OpenSaveDataJournal(VirtualDir root) {
+    auto journal_dir = root->GetParentDirectory();
+    if (journal_dir == nullptr) {
+        return nullptr;
+    }
+    std::string journal_name = root->GetName() + JOURNAL_SUFFIX;
+    auto journal = std::make_shared<SaveDataJournal>(std::move(root), std::move(journal_dir),
+                                                     std::move(journal_name));
+    if (!journal->Recover()) {
+        return nullptr;
+    }
+    return journal;
+}
+
+JournaledVfsDirectory::JournaledVfsDirectory(std::shared_ptr<SaveDataJournal> journal_,
+                                             VirtualDir backing_, std::string path_)
+    : journal{std::move(journal_)}, backing{std::move(backing_)}, path{std::move(path_)} {}
+
+JournaledVfsDirectory::~JournaledVfsDirectory() = default;
+
+VirtualFile JournaledVfsDirectory::WrapFile(VirtualFile file,
+                                            std::string_view relative_path) const {
+    if (file == nullptr) {
+        return nullptr;
+    }
+    return std::make_shared<JournaledVfsFile>(journal, std::move(file),
+                                              JoinPath(path, relative_path));
+}
+
+VirtualDir JournaledVfsDirectory::WrapDirectory(VirtualDir dir,
+                                                std::string_view relative_path) const {
+    if (dir == nullptr) {
+        return nullptr;
+    }
+    return std::make_shared<JournaledVfsDirectory>(journal, std::move(dir),
+                                                   JoinPath(path, relative_path));
+}
+
+VirtualFile JournaledVfsDirectory::GetFileRelative(std::string_view relative_path) const {
+    return WrapFile(backing->GetFileRelative(relative_path), relative_path);
+}
+
+VirtualDir JournaledVfsDirectory::GetDirectoryRelative(std::string_view relative_path) const {
+    return WrapDirectory(backing->GetDirectoryRelative(relative_path), relative_path);
+}
+
+VirtualFile JournaledVfsDirectory::GetFile(std::string_view name) const {
+    return WrapFile(backing->GetFile(name), name);
+}
+
+VirtualDir JournaledVfsDirectory::GetSubdirectory(std::string_view name) const {
+    return WrapDirectory(backing->GetSubdirectory(name), name);
+}
+
+FileTimeStampRaw JournaledVfsDirectory::GetFileTimeStamp(std::string_view relative_path) const {
+    return backing->GetFileTimeStamp(relative_path);
+}
+
+std::vector<VirtualFile> JournaledVfsDirectory::GetFiles() const {
+    auto files = backing->GetFiles();
+    for (auto& file : files) {
+        const auto name = file->GetName();
+        file = WrapFile(std::move(file), name);
+    }
+    return files;
+}
+
+std::vector<VirtualDir> JournaledVfsDirectory::GetSubdirectories() const {
+    auto dirs = backing->GetSubdirectories();
+    for (auto& dir : dirs) {
+        const auto name = dir->GetName();
+        dir = WrapDirectory(std::move(dir), name);
+    }
+    return dirs;
+}
+
+bool JournaledVfsDirectory::IsWritable() const {
+    return backing->IsWritable();
+}
+
+bool JournaledVfsDirectory::IsReadable() const {
+    return backing->IsReadable();
+}
+
+std::string JournaledVfsDirectory::GetName() const {
+    return backing->GetName();
+}
+
+VirtualDir JournaledVfsDirectory::GetParentDirectory() const {
+    // The save data root is the root of the file system titles see
+    if (path.empty()) {
+        return nullptr;
+    }
+    auto parent = backing->GetParentDirectory();
+    if (parent == nullptr) {
+        return nullptr;
+    }
+    return std::make_shared<JournaledVfsDirectory>(journal, std::move(parent),
+                                                   std::string(GetParentPath(path)));
+}
+
+VirtualDir JournaledVfsDirectory::CreateSubdirectory(std::string_view name) {
+    journal->MarkDirectoryChanged(backing);
+    return WrapDirectory(backing->CreateSubdirectory(name), name);
+}
+
+VirtualFile JournaledVfsDirectory::CreateFile(std::string_view name) {
+    // Creating a file that exists empties it
+    journal->Discard(JoinPath(path, name));
+    journal->MarkDirectoryChanged(backing);
+    return WrapFile(backing->CreateFile(name), name);
+}
+
+VirtualFile JournaledVfsDirectory::CreateFileRelative(std::string_view relative_path) {
+    journal->Discard(JoinPath(path, relative_path));
+    auto file = backing->CreateFileRelative(relative_path);
+    if (file != nullptr) {
+        journal->MarkDirectoryChanged(file->GetContainingDirectory());
+    }
+    return WrapFile(std::move(file), relative_path);
+}
+
+VirtualDir JournaledVfsDirectory::CreateDirectoryRelative(std::string_view relative_path) {
+    auto dir = backing->CreateDirectoryRelative(relative_path);
+    if (dir != nullptr) {
+        journal->MarkDirectoryChanged(dir->GetParentDirectory());
+    }
+    return WrapDirectory(std::move(dir), relative_path);
+}
+
+bool JournaledVfsDirectory::DeleteSubdirectory(std::string_view name) {
+    journal->Discard(JoinPath(path, name));
+    journal->MarkDirectoryChanged(backing);
+    return backing->DeleteSubdirectory(name);
+}
+
+bool JournaledVfsDirectory::DeleteSubdirectoryRecursive(std::string_view name) {
+    journal->Discard(JoinPath(path, name));
+    journal->MarkDirectoryChanged(backing);
+    return backing->DeleteSubdirectoryRecursive(name);
+}
+
+bool JournaledVfsDirectory::CleanSubdirectoryRecursive(std::string_view name) {
+    journal->Discard(JoinPath(path, name));
+    journal->MarkDirectoryChanged(backing->GetSubdirectory(name));
+    return backing->CleanSubdirectoryRecursive(name);
+}
+
+bool JournaledVfsDirectory::DeleteFile(std::string_view name) {
+    journal->Discard(JoinPath(path, name));
+    journal->MarkDirectoryChanged(backing);
+    return backing->DeleteFile(name);
+}
+
+bool JournaledVfsDirectory::Rename(std::string_view name) {
+    journal->Flush(path);
+    if (!backing->Rename(name)) {
+        return false;
+    }
+    journal->MarkDirectoryChanged(backing->GetParentDirectory());
+    if (!path.empty()) {
+        path = JoinPath(GetParentPath(path), name);
+    }
+    return true;
+}
+
+std::string JournaledVfsDirectory::GetFullPath() const {
+    return backing->GetFullPath();
+}
+
+std::map<std::string, VfsEntryType, std::less<>> JournaledVfsDirectory::GetEntries() const {
+    return backing->GetEntries();
+}
+
+bool JournaledVfsDirectory::Commit() {
+    return journal->Commit();
+}
+
+} // namespace FileSys
@@ -0,0 +1,70 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "core/file_sys/vfs.h"
+
+namespace FileSys {
+
+class SaveDataJournal;
+
+/**
+ * Opens the journal of the save data in root. Writes to the files of the save data are staged in
+ * it until they are committed, and a commit interrupted by a crash is finished here.
+ *
+ * While a commit is being applied, its redo log is kept in a file next to root, so that nothing
+ * inside the save data directory changes its layout. Returns nullptr if root has no parent for it,
+ * or if a commit interrupted by a crash could not be finished, its redo log is then kept for the
+ * next open to try again.
+ */
+std::shared_ptr<SaveDataJournal> OpenSaveDataJournal(VirtualDir root);
+
+// Directory of save data whose file writes are staged in a journal until Commit is called, so that
+// they reach the disk all at once and a crash never leaves half of them applied. Creating, deleting
+// and renaming entries still happens right away, as it does on the real directory.
+class JournaledVfsDirectory : public VfsDirectory {
+public:
+    JournaledVfsDirectory(std::shared_ptr<SaveDataJournal> journal_, VirtualDir backing_,
+                          std::string path_ = "");
+    ~JournaledVfsDirectory() override;
+
+    VirtualFile GetFileRelative(std::string_view relative_path) const override;
+    VirtualDir GetDirectoryRelative(std::string_view relative_path) const override;
+    VirtualFile GetFile(std::string_view name) const override;
+    VirtualDir GetSubdirectory(std::string_view name) const override;
+    FileTimeStampRaw GetFileTimeStamp(std::string_view relative_path) const override;
+    std::vector<VirtualFile> GetFiles() const override;
+    std::vector<VirtualDir> GetSubdirectories() const override;
+    bool IsWritable() const override;
+    bool IsReadable() const override;
+    std::string GetName() const override;
+    VirtualDir GetParentDirectory() const override;
+    VirtualDir CreateSubdirectory(std::string_view name) override;
+    VirtualFile CreateFile(std::string_view name) override;
+    VirtualFile CreateFileRelative(std::string_view relative_path) override;
+    VirtualDir CreateDirectoryRelative(std::string_view relative_path) override;
+    bool DeleteSubdirectory(std::string_view name) override;
+    bool DeleteSubdirectoryRecursive(std::string_view name) override;
+    bool CleanSubdirectoryRecursive(std::string_view name) override;
+    bool DeleteFile(std::string_view name) override;
+    bool Rename(std::string_view name) override;
+    std::string GetFullPath() const override;
+    std::map<std::string, VfsEntryType, std::less<>> GetEntries() const override;
+
+    /// Applies the writes staged in the whole save data and syncs them to the disk
+    bool Commit();
+
+private:
+    VirtualFile WrapFile(VirtualFile file, std::string_view relative_path) const;
+    VirtualDir WrapDirectory(VirtualDir dir, std::string_view relative_path) const;
+
+    std::shared_ptr<SaveDataJournal> journal;
+    VirtualDir backing;
+    /// Path relative to the root of the save data, empty for the root itself
+    std::string path;
+};
+
+} // namespace FileSys
@@ -0,0 +1,382 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "common/logging/log.h"
+#include "common/thread.h"
+#include "core/file_sys/vfs_async.h"
+#include "core/file_sys/vfs_offset.h"
+#include "core/file_sys/vfs_real.h"
+
+namespace FileSys {
+
+namespace {
+/// Entries of the submission queue, also the most io_uring reads in flight at once
+constexpr u32 RING_ENTRIES = 256;
+
+/// Most reads merged into one, each one takes an iovec
+constexpr std::size_t MAX_MERGED_READS = 64;
+
+/// Threads reading the files io_uring can't be used for
+constexpr std::size_t NUM_POOL_THREADS = 4;
+
+struct Request {
+    /// Keeps the file open until the read is done
+    VirtualFile file;
+    std::size_t file_offset;
+    std::span<u8> dest;
+    AsyncReadCallback done;
+
+    /// Descriptor of the real file underneath and the offset in it, for io_uring
+    int fd = -1;
+    u64 host_offset = 0;
+};
+
+/// Adjacent reads submitted as one io_uring operation
+struct Batch {
+    std::vector<Request> requests;
+    std::vector<iovec> iovecs;
+};
+
+/**
+ * Follows offset files down to a real file, trimming the read to each of them like
+ * OffsetVfsFile::Read does. Returns false if there is no real file underneath.
+ */
+bool ResolveRealFile(Request& request) {
+    const VfsFile* current = request.file.get();
+    u64 offset = request.file_offset;
+    while (const auto* offset_file = dynamic_cast<const OffsetVfsFile*>(current)) {
+        const std::size_t size = offset_file->GetSize();
+        request.dest = request.dest.first(
+            offset < size ? std::min<std::size_t>(request.dest.size(), size - offset) : 0);
+        offset += offset_file->GetOffset();
+        current = offset_file->GetBaseFile().get();
+    }
+    const auto* real_file = dynamic_cast<const RealVfsFile*>(current);
+    if (!real_file) {
+        return false;
+    }
+    request.fd = real_file->GetNativeHandle();
+    request.host_offset = offset;
+    return request.fd != -1;
+}
+
+/// Reads whatever io_uring did not, e.g. after an error, so that the result matches VfsFile::Read
+void FinishRead(Request& request, std::size_t bytes_read) {
+    if (bytes_read == request.dest.size()) {
+        request.done(request.dest.size());
+        return;
+    }
+    request.done(bytes_read + request.file->Read(request.dest.data() + bytes_read,
+                                                 request.dest.size() - bytes_read,
+                                                 request.file_offset + bytes_read));
+}
+
+/// io_uring over the raw system calls, only readv is needed so liburing is not
+class Ring {
+public:
+    bool Setup(u32 entries) {
+        io_uring_params params{};
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd == -1) {
+            LOG_INFO(Service_FS, "io_uring is not available: {}", ::strerror(errno));
+            return false;
+        }
+        std::size_t sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+        std::size_t cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+        }
+        u8* const sq_ring = Map(sq_ring_size, IORING_OFF_SQ_RING);
+        u8* const cq_ring = single_mmap ? sq_ring : Map(cq_ring_size, IORING_OFF_CQ_RING);
+        sqes = reinterpret_cast<io_uring_sqe*>(
+            Map(params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES));
+        if (!sq_ring || !cq_ring || !sqes) {
+            // Whatever was mapped is leaked, setup is only attempted once
+            LOG_ERROR(Service_FS, "Unable to map io_uring: {}", ::strerror(errno));
+            ::close(fd);
+            return false;
+        }
+
+        sq_tail = reinterpret_cast<u32*>(sq_ring + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<const u32*>(sq_ring + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<u32*>(sq_ring + params.sq_off.array);
+        cq_head = reinterpret_cast<u32*>(cq_ring + params.cq_off.head);
+        cq_tail = reinterpret_cast<u32*>(cq_ring + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<const u32*>(cq_ring + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+        return true;
+    }
+
+    /// Queues a read into iovecs at offset of file, only one thread may push
+    void PushReadv(int file, const iovec* iovecs, u32 count, u64 offset, void* user_data) {
+        const u32 tail = *sq_tail;
+        const u32 index = tail & sq_mask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = file;
+        sqe.addr = reinterpret_cast<u64>(iovecs);
+        sqe.len = count;
+        sqe.off = offset;
+        sqe.user_data = reinterpret_cast<u64>(user_data);
+        sq_array[index] = index;
+        std::atomic_ref{*sq_tail}.store(tail + 1, std::memory_order_release);
+    }
+
+    /**
+     * Submits the count reads pushed last. Returns the user data of the reads that could not be
+     * submitted, which are taken back out of the submission queue.
+     */
+    std::vector<void*> Submit(u32 count) {
+        while (count != 0) {
+            const long result = ::syscall(__NR_io_uring_enter, fd, count, 0, 0, nullptr, 0);
+            if (result == -1) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                LOG_CRITICAL(Service_FS, "io_uring submission failed: {}", ::strerror(errno));
+                return TakeBack(count);
+            }
+            count -= static_cast<u32>(result);
+        }
+        return {};
+    }
+
+    /// Waits for at least one completion and passes each to func, returns how many there were
+    template <typename Func>
+    u32 WaitCompletions(Func&& func) {
+        while (::syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) ==
+                   -1 &&
+               errno == EINTR) {
+        }
+        u32 head = *cq_head;
+        const u32 tail = std::atomic_ref{*cq_tail}.load(std::memory_order_acquire);
+        const u32 count = tail - head;
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes[head & cq_mask];
+            func(reinterpret_cast<void*>(cqe.user_data), cqe.res);
+        }
+        std::atomic_ref{*cq_head}.store(head, std::memory_order_release);
+        return count;
+    }
+
+private:
+    /// Removes the count reads pushed last, the kernel only consumes entries on submission
+    std::vector<void*> TakeBack(u32 count) {
+        const u32 tail = *sq_tail - count;
+        std::vector<void*> user_data(count);
+        for (u32 i = 0; i < count; ++i) {
+            user_data[i] = reinterpret_cast<void*>(sqes[(tail + i) & sq_mask].user_data);
+        }
+        std::atomic_ref{*sq_tail}.store(tail, std::memory_order_release);
+        return user_data;
+    }
+
+    u8* Map(std::size_t size, u64 offset) const {
+        void* const mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_POPULATE, fd, static_cast<off_t>(offset));
+        return mapping == MAP_FAILED ? nullptr : static_cast<u8*>(mapping);
+    }
+
+    int fd = -1;
+    u32* sq_tail{};
+    u32 sq_mask{};
+    u32* sq_array{};
+    io_uring_sqe* sqes{};
+    u32* cq_head{};
+    u32* cq_tail{};
+    u32 cq_mask{};
+    io_uring_cqe* cqes{};
+};
+
+class AsyncReader {
+public:
+    AsyncReader() {
+        has_ring = ring.Setup(RING_ENTRIES);
+        if (has_ring) {
+            std::thread([this] { RunSubmitter(); }).detach();
+            std::thread([this] { RunCompleter(); }).detach();
+        }
+        for (std::size_t i = 0; i < NUM_POOL_THREADS; ++i) {
+            std::thread([this] { RunPoolWorker(); }).detach();
+        }
+    }
+
+    void Read(Request request) {
+        if (has_ring && ResolveRealFile(request)) {
+            {
+                std::scoped_lock lock{ring_mutex};
+                pending.push_back(std::move(request));
+            }
+            submit_condition.notify_one();
+            return;
+        }
+        QueuePoolTask(std::move(request));
+    }
+
+private:
+    void QueuePoolTask(Request request) {
+        {
+            std::scoped_lock lock{pool_mutex};
+            pool_tasks.push_back(std::move(request));
+        }
+        pool_condition.notify_one();
+    }
+
+    void RunSubmitter() {
+        Common::SetCurrentThreadName("mizu:AsyncIO");
+        std::vector<Request> requests;
+        while (true) {
+            {
+                std::unique_lock lock{ring_mutex};
+                submit_condition.wait(lock, [this] { return !pending.empty(); });
+                requests.swap(pending);
+            }
+            Submit(requests);
+            requests.clear();
+        }
+    }
+
+    /// Merges the requests into as few reads as possible and submits them
+    void Submit(std::vector<Request>& requests) {
+        std::ranges::sort(requests, {}, [](const Request& request) {
+            return std::pair{request.fd, request.host_offset};
+        });
+        u32 num_pushed = 0;
+        for (auto it = requests.begin(); it != requests.end();) {
+            auto batch = std::make_unique<Batch>();
+            const int fd = it->fd;
+            const u64 offset = it->host_offset;
+            u64 end = offset;
+            do {
+                batch->iovecs.push_back({it->dest.data(), it->dest.size()});
+                end += it->dest.size();
+                batch->requests.push_back(std::move(*it));
+                ++it;
+            } while (it != requests.end() && it->fd == fd && it->host_offset == end &&
+                     batch->requests.size() < MAX_MERGED_READS);
+
+            {
+                std::unique_lock lock{ring_mutex};
+                if (num_in_flight == RING_ENTRIES) {
+                    // The reads waited on have to be submitted first
+                    lock.unlock();
+                    SubmitPushed(num_pushed);
+                    num_pushed = 0;
+                    lock.lock();
+                    slot_condition.wait(lock, [this] { return num_in_flight < RING_ENTRIES; });
+                }
+                ++num_in_flight;
+            }
+            ring.PushReadv(fd, batch->iovecs.data(), static_cast<u32>(batch->iovecs.size()),
+                           offset, batch.get());
+            batch.release();
+            ++num_pushed;
+        }
+        SubmitPushed(num_pushed);
+    }
+
+    /// Submits the count batches pushed last, the ones io_uring refuses are read by the pool
+    void SubmitPushed(u32 count) {
+        const std::vector<void*> unsubmitted = ring.Submit(count);
+        if (unsubmitted.empty()) {
+            return;
+        }
+        {
+            std::scoped_lock lock{ring_mutex};
+            num_in_flight -= static_cast<u32>(unsubmitted.size());
+        }
+        for (void* const user_data : unsubmitted) {
+            const std::unique_ptr<Batch> batch{static_cast<Batch*>(user_data)};
+            for (Request& request : batch->requests) {
+                QueuePoolTask(std::move(request));
+            }
+        }
+    }
+
+    void RunCompleter() {
+        Common::SetCurrentThreadName("mizu:AsyncIOCompletion");
+        while (true) {
+            const u32 num_completed = ring.WaitCompletions([](void* user_data, s32 result) {
+                const std::unique_ptr<Batch> batch{static_cast<Batch*>(user_data)};
+                if (result < 0) {
+                    LOG_WARNING(Service_FS, "io_uring read failed: {}", ::strerror(-result));
+                }
+                std::size_t remaining = result > 0 ? static_cast<std::size_t>(result) : 0;
+                for (Request& request : batch->requests) {
+                    const std::size_t bytes_read = std::min(remaining, request.dest.size());
+                    remaining -= bytes_read;
+                    FinishRead(request, bytes_read);
+                }
+            });
+            {
+                std::scoped_lock lock{ring_mutex};
+                num_in_flight -= num_completed;
+            }
+            slot_condition.notify_one();
+        }
+    }
+
+    void RunPoolWorker() {
+        Common::SetCurrentThreadName("mizu:AsyncIOWorker");
+        std::unique_lock lock{pool_mutex};
+        while (true) {
+            pool_condition.wait(lock, [this] { return !pool_tasks.empty(); });
+            Request request = std::move(pool_tasks.front());
+            pool_tasks.pop_front();
+            lock.unlock();
+            FinishRead(request, 0);
+            lock.lock();
+        }
+    }
+
+    bool has_ring = false;
+    Ring ring;
+
+    std::mutex ring_mutex;
+    std::condition_variable submit_condition;
+    std::condition_variable slot_condition;
+    std::vector<Request> pending;
+    u32 num_in_flight = 0;
+
+    std::mutex pool_mutex;
+    std::condition_variable pool_condition;
+    std::deque<Request> pool_tasks;
+};
+
+AsyncReader& GetReader() {
+    // Never destroyed, its threads run until the process exits
+    static AsyncReader* const reader = new AsyncReader;
+    return *reader;
+}
+} // Anonymous namespace
+
+void ReadAsync(VirtualFile file, std::span<u8> dest, std::size_t offset, AsyncReadCallback done) {
+    GetReader().Read({
+        .file = std::move(file),
+        .file_offset = offset,
+        .dest = dest,
+        .done = std::move(done),
+    });
+}
+
+} // namespace FileSys
@@ -0,0 +1,29 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include "common/common_types.h"
+#include "common/unique_function.h"
+#include "core/file_sys/vfs_types.h"
+
+namespace FileSys {
+
+/// Called with the number of bytes read, on a thread of the asynchronous reader
+using AsyncReadCallback = Common::UniqueFunction<void, std::size_t>;
+
+/**
+ * Reads up to dest.size() bytes at offset of file into dest without blocking the caller, then
+ * calls done with the number of bytes read, as VfsFile::Read would return it. dest must stay
+ * valid until done is called.
+ *
+ * Reads of real files, also through offset files, are submitted to io_uring when the host supports
+ * it, and reads of adjacent ranges of the same file that are waiting at the same time are merged
+ * into one. Reads of all other files run on a small thread pool.
+ */
+void ReadAsync(VirtualFile file, std::span<u8> dest, std::size_t offset, AsyncReadCallback done);
+
+} // namespace FileSys
@@ -5,9 +5,18 @@
 // Adapted by Kent Hall for mizu on Horizon Linux.
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <cstddef>
+#include <cstring>
 #include <iterator>
+#include <mutex>
 #include <utility>
+#include <csetjmp>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "common/assert.h"
 #include "common/fs/file.h"
 #include "common/fs/fs.h"
@@ -44,8 +53,102 @@ constexpr FS::FileAccessMode ModeFlagsToFileAccessMode(Mode mode) {
     }
 }
 
+/// Smaller files are read with pread, mapping them is not worth it and they are more likely to be
+/// truncated by a writer while mapped.
+constexpr std::size_t MIN_MAPPED_FILE_SIZE = 4 * 1024 * 1024;
+
+/// Reads at least this large ask the kernel to fetch the whole range at once, rather than
+/// faulting it in a readahead window at a time.
+constexpr std::size_t WILLNEED_READ_SIZE = 256 * 1024;
+
+/// Set while a thread copies from a mapping, where a SIGBUS means the file was truncated
+thread_local sigjmp_buf* mapped_read_guard = nullptr;
+struct sigaction previous_sigbus_action;
+
+void HandleSigbus(int signal, siginfo_t* info, void* context) {
+    if (mapped_read_guard != nullptr) {
+        siglongjmp(*mapped_read_guard, 1);
+    }
+    if ((previous_sigbus_action.sa_flags & SA_SIGINFO) != 0) {
+        previous_sigbus_action.sa_sigaction(signal, info, context);
+        return;
+    }
+    if (previous_sigbus_action.sa_handler != SIG_DFL &&
+        previous_sigbus_action.sa_handler != SIG_IGN) {
+        previous_sigbus_action.sa_handler(signal);
+        return;
+    }
+    // Not from a mapped file, the faulting access runs again and gets the default action
+    ::sigaction(SIGBUS, &previous_sigbus_action, nullptr);
+}
+
+void InstallSigbusHandler() {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        struct sigaction action {};
+        action.sa_sigaction = HandleSigbus;
+        action.sa_flags = SA_SIGINFO | SA_NODEFER;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(SIGBUS, &action, &previous_sigbus_action);
+    });
+}
+
 } // Anonymous namespace
 
+MappedFileView::~MappedFileView() {
+    ::munmap(const_cast<u8*>(data), size);
+}
+
+std::shared_ptr<const MappedFileView> MappedFileView::Map(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return nullptr;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == -1 || static_cast<std::size_t>(st.st_size) < MIN_MAPPED_FILE_SIZE) {
+        ::close(fd);
+        return nullptr;
+    }
+    InstallSigbusHandler();
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void* const mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file alive
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        LOG_WARNING(Service_FS, "Unable to map {}, reading it with pread: {}", path,
+                    std::strerror(errno));
+        return nullptr;
+    }
+    return std::shared_ptr<const MappedFileView>(
+        new MappedFileView(static_cast<const u8*>(mapping), size));
+}
+
+std::optional<std::size_t> MappedFileView::Read(u8* out, std::size_t length,
+                                                std::size_t offset) const {
+    if (truncated || offset > size || length > size - offset) {
+        return std::nullopt;
+    }
+    if (length >= WILLNEED_READ_SIZE) {
+        const auto page_mask = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)) - 1;
+        const std::size_t begin = offset & ~page_mask;
+        ::madvise(const_cast<u8*>(data) + begin, offset + length - begin, MADV_WILLNEED);
+    }
+    sigjmp_buf guard;
+    if (sigsetjmp(guard, 0) != 0) {
+        mapped_read_guard = nullptr;
+        truncated = true;
+        LOG_WARNING(Service_FS, "Mapped file was truncated, reading it with pread");
+        return std::nullopt;
+    }
+    // The fences keep the guard from being optimized away, as only the signal handler reads it
+    mapped_read_guard = &guard;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    std::memcpy(out, data + offset, length);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    mapped_read_guard = nullptr;
+    return length;
+}
+
 RealVfsFilesystem::RealVfsFilesystem() : VfsFilesystem(nullptr) {}
 RealVfsFilesystem::~RealVfsFilesystem() = default;
 
@@ -76,11 +179,16 @@ VfsEntryType RealVfsFilesystem::GetEntryType(std::string_view path_) const {
 VirtualFile RealVfsFilesystem::OpenFile(std::string_view path_, Mode perms) {
     const auto path = FS::SanitizePath(path_, FS::DirectorySeparator::PlatformDefault);
 
+    // Files which are not written to can be read from a mapping, without system calls and from
+    // several threads at once
+    auto view = perms == Mode::Read ? OpenView(path) : nullptr;
+
     if (const auto weak_iter = cache.find(path); weak_iter != cache.cend()) {
         const auto& weak = weak_iter->second;
 
         if (!weak.expired()) {
-            return std::shared_ptr<RealVfsFile>(new RealVfsFile(*this, weak.lock(), path, perms));
+            return std::shared_ptr<RealVfsFile>(
+                new RealVfsFile(*this, weak.lock(), std::move(view), path, perms));
         }
     }
 
@@ -93,13 +201,44 @@ VirtualFile RealVfsFilesystem::OpenFile(std::string_view path_, Mode perms) {
     cache.insert_or_assign(path, std::move(backing));
 
     // Cannot use make_shared as RealVfsFile constructor is private
-    return std::shared_ptr<RealVfsFile>(new RealVfsFile(*this, backing, path, perms));
+    return std::shared_ptr<RealVfsFile>(
+        new RealVfsFile(*this, backing, std::move(view), path, perms));
+}
+
+std::shared_ptr<const MappedFileView> RealVfsFilesystem::OpenView(const std::string& path) {
+    if (const auto iter = view_cache.find(path); iter != view_cache.cend()) {
+        if (auto view = iter->second.lock()) {
+            return view;
+        }
+    }
+
+    auto view = MappedFileView::Map(path);
+    if (view) {
+        view_cache.insert_or_assign(path, view);
+    }
+    return view;
+}
+
+void RealVfsFilesystem::ForgetViews(std::string_view path, bool is_directory) {
+    // Files which are open keep their mappings, new ones map whatever is at the path then
+    if (!is_directory) {
+        view_cache.erase(std::string{path});
+        return;
+    }
+    for (auto iter = view_cache.begin(); iter != view_cache.end();) {
+        if (iter->first.starts_with(path)) {
+            iter = view_cache.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
 }
 
 VirtualFile RealVfsFilesystem::CreateFile(std::string_view path_, Mode perms) {
     const auto path = FS::SanitizePath(path_, FS::DirectorySeparator::PlatformDefault);
     // Current usages of CreateFile expect to delete the contents of an existing file.
     if (FS::IsFile(path)) {
+        ForgetViews(path, false);
         FS::IOFile temp{path, FS::FileAccessMode::Write, FS::FileType::BinaryFile};
 
         if (!temp.IsOpen()) {
@@ -127,6 +266,8 @@ VirtualFile RealVfsFilesystem::MoveFile(std::string_view old_path_, std::string_
     const auto old_path = FS::SanitizePath(old_path_, FS::DirectorySeparator::PlatformDefault);
     const auto new_path = FS::SanitizePath(new_path_, FS::DirectorySeparator::PlatformDefault);
     const auto cached_file_iter = cache.find(old_path);
+    ForgetViews(old_path, false);
+    ForgetViews(new_path, false);
 
     if (cached_file_iter != cache.cend()) {
         auto file = cached_file_iter->second.lock();
@@ -157,6 +298,7 @@ VirtualFile RealVfsFilesystem::MoveFile(std::string_view old_path_, std::string_
 bool RealVfsFilesystem::DeleteFile(std::string_view path_) {
     const auto path = FS::SanitizePath(path_, FS::DirectorySeparator::PlatformDefault);
     const auto cached_iter = cache.find(path);
+    ForgetViews(path, false);
 
     if (cached_iter != cache.cend()) {
         if (!cached_iter->second.expired()) {
@@ -197,6 +339,7 @@ VirtualDir RealVfsFilesystem::MoveDirectory(std::string_view old_path_,
     if (!FS::RenameDir(old_path, new_path)) {
         return nullptr;
     }
+    ForgetViews(old_path, true);
 
     for (auto& kv : cache) {
         // If the path in the cache doesn't start with old_path, then bail on this file.
@@ -229,6 +372,7 @@ VirtualDir RealVfsFilesystem::MoveDirectory(std::string_view old_path_,
 
 bool RealVfsFilesystem::DeleteDirectory(std::string_view path_) {
     const auto path = FS::SanitizePath(path_, FS::DirectorySeparator::PlatformDefault);
+    ForgetViews(path, true);
 
     for (auto& kv : cache) {
         // If the path in the cache doesn't start with path, then bail on this file.
@@ -248,9 +392,11 @@ bool RealVfsFilesystem::DeleteDirectory(std::string_view path_) {
 }
 
 RealVfsFile::RealVfsFile(RealVfsFilesystem& base_, std::shared_ptr<FS::IOFile> backing_,
-                         const std::string& path_, Mode perms_)
-    : base(base_), backing(std::move(backing_)), path(path_), parent_path(FS::GetParentPath(path_)),
-      path_components(FS::SplitPathComponents(path_)), perms(perms_) {}
+                         std::shared_ptr<const MappedFileView> view_, const std::string& path_,
+                         Mode perms_)
+    : base(base_), backing(std::move(backing_)), view(std::move(view_)), path(path_),
+      parent_path(FS::GetParentPath(path_)), path_components(FS::SplitPathComponents(path_)),
+      perms(perms_) {}
 
 RealVfsFile::~RealVfsFile() = default;
 
@@ -259,10 +405,12 @@ std::string RealVfsFile::GetName() const {
 }
 
 std::size_t RealVfsFile::GetSize() const {
+    // Not the size of the view, the file may have changed since it was mapped
     return backing->GetSize();
 }
 
 bool RealVfsFile::Resize(std::size_t new_size) {
+    base.ForgetViews(path, false);
     return backing->SetSize(new_size);
 }
 
@@ -279,23 +427,27 @@ bool RealVfsFile::IsReadable() const {
 }
 
 std::size_t RealVfsFile::Read(u8* data, std::size_t length, std::size_t offset) const {
-    if (!backing->Seek(static_cast<s64>(offset))) {
-        return 0;
+    if (view) {
+        if (const auto read = view->Read(data, length, offset)) {
+            return *read;
+        }
+        // Past the end of the mapping, or the file was truncated while mapped
     }
-    return backing->ReadSpan(std::span{data, length});
+    return backing->ReadAt(std::span{data, length}, offset);
 }
 
 std::size_t RealVfsFile::Write(const u8* data, std::size_t length, std::size_t offset) {
-    if (!backing->Seek(static_cast<s64>(offset))) {
-        return 0;
-    }
-    return backing->WriteSpan(std::span{data, length});
+    return backing->WriteAt(std::span<const u8>{data, length}, offset);
 }
 
 bool RealVfsFile::Rename(std::string_view name) {
     return base.MoveFile(path, parent_path + '/' + std::string(name)) != nullptr;
 }
 
+int RealVfsFile::GetNativeHandle() const {
+    return backing->GetNativeHandle();
+}
+
 void RealVfsFile::Close() {
     backing->Close();
 }
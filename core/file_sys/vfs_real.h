@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <optional>
 #include <string_view>
 #include <boost/container/flat_map.hpp>
 #include "core/file_sys/mode.h"
@@ -17,6 +19,36 @@ class IOFile;
 
 namespace FileSys {
 
+/// Read-only memory mapping of a whole file, shared by the RealVfsFiles reading the same path.
+class MappedFileView {
+public:
+    ~MappedFileView();
+
+    MappedFileView(const MappedFileView&) = delete;
+    MappedFileView& operator=(const MappedFileView&) = delete;
+
+    /// Maps the file at path, returns nullptr if it is empty or cannot be mapped.
+    static std::shared_ptr<const MappedFileView> Map(const std::string& path);
+
+    std::size_t GetSize() const {
+        return size;
+    }
+
+    /**
+     * Reads from the mapping, nullopt if the range is not within it anymore. A file truncated
+     * while mapped raises SIGBUS when a page past its end is touched, which fails this read and
+     * every later one instead of killing the process.
+     */
+    std::optional<std::size_t> Read(u8* data, std::size_t length, std::size_t offset) const;
+
+private:
+    MappedFileView(const u8* data_, std::size_t size_) : data{data_}, size{size_} {}
+
+    const u8* data;
+    std::size_t size;
+    mutable std::atomic_bool truncated{};
+};
+
 class RealVfsFilesystem : public VfsFilesystem {
 public:
     RealVfsFilesystem();
@@ -38,7 +70,14 @@ public:
     bool DeleteDirectory(std::string_view path) override;
 
 private:
+    friend class RealVfsFile;
+
+    std::shared_ptr<const MappedFileView> OpenView(const std::string& path);
+    void ForgetViews(std::string_view path, bool is_directory);
+
     boost::container::flat_map<std::string, std::weak_ptr<Common::FS::IOFile>> cache;
+    /// Mappings of the files opened read-only, e.g. game images, which are read from the most
+    boost::container::flat_map<std::string, std::weak_ptr<const MappedFileView>> view_cache;
 };
 
 // An implmentation of VfsFile that represents a file on the user's computer.
@@ -59,14 +98,20 @@ public:
     std::size_t Write(const u8* data, std::size_t length, std::size_t offset) override;
     bool Rename(std::string_view name) override;
 
+    /// Gets the descriptor of the host file for reading it asynchronously, -1 if it is closed
+    int GetNativeHandle() const;
+
 private:
     RealVfsFile(RealVfsFilesystem& base, std::shared_ptr<Common::FS::IOFile> backing,
-                const std::string& path, Mode perms = Mode::Read);
+                std::shared_ptr<const MappedFileView> view, const std::string& path,
+                Mode perms = Mode::Read);
 
     void Close();
 
     RealVfsFilesystem& base;
     std::shared_ptr<Common::FS::IOFile> backing;
+    /// Reads go through the mapping when the file is only opened for reading
+    std::shared_ptr<const MappedFileView> view;
     std::string path;
     std::string parent_path;
     std::vector<std::string> path_components;
@@ -6,8 +6,10 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <unordered_map>
@@ -36,6 +38,64 @@ struct InputCallback {
     std::function<void(StatusType)> on_change;
 };
 
+/**
+ * Marks the span in which the calling thread reads input devices for one update. Backends that
+ * publish whole controller snapshots read each controller once per scope, so all devices mapped
+ * to the same controller observe the same state. Scopes are per thread, nested scopes join the
+ * outermost one.
+ */
+class SnapshotScope {
+public:
+    SnapshotScope() {
+        if (depth++ == 0) {
+            epoch = ++next_epoch;
+            oldest_event_time = 0;
+        }
+    }
+
+    ~SnapshotScope() {
+        if (--depth == 0) {
+            epoch = 0;
+        }
+    }
+
+    SnapshotScope(const SnapshotScope&) = delete;
+    SnapshotScope& operator=(const SnapshotScope&) = delete;
+
+    /// Returns the steady clock time snapshots are stamped with, in nanoseconds
+    static s64 Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    /// Returns the epoch of the scope active on this thread, or zero outside of a scope
+    static u64 CurrentEpoch() {
+        return epoch;
+    }
+
+    /// Called by backends when they read a snapshot that no earlier scope has seen
+    static void NoteEvent(s64 event_time) {
+        if (epoch != 0 && (oldest_event_time == 0 || event_time < oldest_event_time)) {
+            oldest_event_time = event_time;
+        }
+    }
+
+    /// Returns the time of the oldest new input event read in this scope, if there was one
+    std::optional<s64> OldestEventTime() const {
+        if (oldest_event_time == 0) {
+            return std::nullopt;
+        }
+        return oldest_event_time;
+    }
+
+private:
+    static inline thread_local u32 depth{};
+    static inline thread_local u64 epoch{};
+    static inline thread_local u64 next_epoch{};
+    static inline thread_local s64 oldest_event_time{};
+};
+
 /// An abstract class template for an input device (a button, an analog input, etc.).
 template <typename StatusType>
 class InputDevice {
@@ -16,6 +16,15 @@ namespace IPC {
 /// Size of the command buffer area, in 32-bit words.
 constexpr std::size_t COMMAND_BUFFER_LENGTH = 0x100 / sizeof(u32);
 
+/// Maximum number of X, A, B or W buffer descriptors in a message, their counts are 4 bits wide.
+constexpr std::size_t MAX_BUFFER_DESCRIPTORS = 15;
+
+/// Maximum number of C buffer descriptors in a message, the 4-bit flags value minus 2.
+constexpr std::size_t MAX_BUFFER_C_DESCRIPTORS = 13;
+
+/// Maximum number of copy or move handles in a message, their counts are 4 bits wide.
+constexpr std::size_t MAX_HANDLES = 15;
+
 enum class ControlCommand : u32 {
     ConvertSessionToDomain = 0,
     ConvertDomainToSession = 1,
@@ -6,22 +6,208 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <sstream>
+#include <stop_token>
+#include <thread>
 #include <utility>
 #include <cstring>
+#include <pthread.h>
+#include <signal.h>
 
 #include <boost/range/algorithm_ext/erase.hpp>
 
 #include "common/assert.h"
 #include "common/common_funcs.h"
 #include "common/common_types.h"
+#include "common/literals.h"
 #include "common/logging/log.h"
+#include "common/thread.h"
 #include "core/hle/ipc_helpers.h"
 #include "core/hle/kernel/hle_ipc.h"
 #include "core/hle/kernel/svc_results.h"
 
 namespace Kernel {
 
+namespace RequestArena {
+
+namespace {
+using namespace Common::Literals;
+
+/// Buffers grown past this size are freed on reset rather than kept for the next request
+constexpr std::size_t MAX_RETAINED_SIZE = 1_MiB;
+
+struct Arena {
+    // A deque so handing out another buffer does not move the ones already handed out
+    std::deque<std::vector<u8>> buffers;
+    std::size_t num_used = 0;
+};
+thread_local Arena arena;
+} // Anonymous namespace
+
+std::vector<u8>& Allocate(std::size_t size) {
+    if (arena.num_used == arena.buffers.size()) {
+        arena.buffers.emplace_back();
+    }
+    std::vector<u8>& buffer = arena.buffers[arena.num_used++];
+    buffer.clear();
+    buffer.resize(size);
+    return buffer;
+}
+
+void Reset() {
+    for (std::size_t i = 0; i < arena.num_used; ++i) {
+        std::vector<u8>& buffer = arena.buffers[i];
+        if (buffer.capacity() > MAX_RETAINED_SIZE) {
+            buffer = {};
+        }
+    }
+    arena.num_used = 0;
+}
+
+} // namespace RequestArena
+
+namespace DeferredReplies {
+
+struct Queue {
+    pthread_t thread;
+    std::mutex mutex;
+    /// Set while the thread waits for a request, the only time it is interrupted
+    bool receiving = false;
+    /// Replies waiting to be sent, the queue owns them until they are
+    std::vector<std::shared_ptr<HLERequestContext>> ready;
+};
+
+namespace {
+/// Interrupts HZN_SCTL_GET_CMD on a service thread, so that it sends the replies that are ready.
+/// Service threads keep it blocked outside of the wait, so that it cannot fail anything else.
+constexpr int WAKE_SIGNAL = SIGUSR1;
+/// How often a service thread with unsent replies is interrupted again, in case the signal came
+/// after the thread checked for it but before it started waiting
+constexpr auto WAKE_INTERVAL = std::chrono::milliseconds{1};
+
+thread_local volatile sig_atomic_t woken = 0;
+
+sigset_t WakeSignalSet() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, WAKE_SIGNAL);
+    return set;
+}
+
+Queue& QueueOfThisThread() {
+    static std::once_flag handler_installed;
+    std::call_once(handler_installed, [] {
+        // Without SA_RESTART, so that the signal ends the wait for a request
+        struct sigaction action {};
+        action.sa_handler = [](int) { woken = 1; };
+        sigemptyset(&action.sa_mask);
+        ::sigaction(WAKE_SIGNAL, &action, nullptr);
+    });
+    thread_local Queue queue = [] {
+        const sigset_t set = WakeSignalSet();
+        ::pthread_sigmask(SIG_BLOCK, &set, nullptr);
+        return Queue{.thread = ::pthread_self()};
+    }();
+    return queue;
+}
+
+/**
+ * Interrupts service threads again while they have unsent replies. A single thread for all of
+ * them, so that the thread completing a request does not have to wait for its reply to be sent.
+ */
+class Waker {
+public:
+    void Watch(Queue& queue) {
+        {
+            std::scoped_lock lock{mutex};
+            if (std::find(queues.begin(), queues.end(), &queue) != queues.end()) {
+                return;
+            }
+            queues.push_back(&queue);
+            if (!thread.joinable()) {
+                thread = std::jthread([this](std::stop_token stop_token) { Run(stop_token); });
+            }
+        }
+        condition.notify_one();
+    }
+
+private:
+    void Run(std::stop_token stop_token) {
+        Common::SetCurrentThreadName("mizu:DeferredReplyWaker");
+        std::unique_lock lock{mutex};
+        while (!stop_token.stop_requested()) {
+            if (queues.empty()) {
+                condition.wait(lock, stop_token, [this] { return !queues.empty(); });
+                continue;
+            }
+            condition.wait_for(lock, stop_token, WAKE_INTERVAL, [] { return false; });
+            std::erase_if(queues, [](Queue* queue) {
+                std::scoped_lock queue_lock{queue->mutex};
+                if (queue->ready.empty()) {
+                    return true;
+                }
+                if (queue->receiving) {
+                    ::pthread_kill(queue->thread, WAKE_SIGNAL);
+                }
+                return false;
+            });
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable_any condition;
+    std::vector<Queue*> queues;
+    std::jthread thread;
+};
+Waker waker;
+} // Anonymous namespace
+
+long SendReadyAndReceive(unsigned long* session_id) {
+    Queue& queue = QueueOfThisThread();
+    std::vector<std::shared_ptr<HLERequestContext>> sending;
+    {
+        std::scoped_lock lock{queue.mutex};
+        sending.swap(queue.ready);
+    }
+    for (const auto& context : sending) {
+        context->PutDeferredReply();
+    }
+    sending.clear();
+    {
+        std::scoped_lock lock{queue.mutex};
+        if (!queue.ready.empty()) {
+            errno = EINTR;
+            return -1;
+        }
+        queue.receiving = true;
+    }
+    // A signal sent while the thread was busy is delivered on unblocking and skips the wait
+    const sigset_t set = WakeSignalSet();
+    woken = 0;
+    ::pthread_sigmask(SIG_UNBLOCK, &set, nullptr);
+    long cmdptr;
+    if (woken) {
+        errno = EINTR;
+        cmdptr = -1;
+    } else {
+        cmdptr = horizon_servctl(HZN_SCTL_GET_CMD, session_id);
+    }
+    const int wait_errno = errno;
+    ::pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    {
+        std::scoped_lock lock{queue.mutex};
+        queue.receiving = false;
+    }
+    errno = wait_errno;
+    return cmdptr;
+}
+
+} // namespace DeferredReplies
+
 SessionRequestHandler::SessionRequestHandler(const char* service_name_) {}
 
 SessionRequestHandler::~SessionRequestHandler() = default;
@@ -174,6 +360,11 @@ void HLERequestContext::ParseCommandBuffer(u32_le* src_cmdbuf, bool incoming) {
 }
 
 ResultCode HLERequestContext::WriteToOutgoingCommandBuffer() {
+    // Handles are created in the context of the request the service thread is handling
+    ASSERT_MSG(!is_deferred || (outgoing_copy_fds.empty() && outgoing_move_handles.empty() &&
+                                outgoing_domain_objects.empty()),
+               "Deferred replies cannot carry handles or interfaces");
+
     auto current_offset = handles_offset;
 
     for (int fd : outgoing_copy_fds) {
@@ -204,30 +395,61 @@ ResultCode HLERequestContext::WriteToOutgoingCommandBuffer() {
     return ResultSuccess;
 }
 
-std::vector<u8> HLERequestContext::ReadBuffer(std::size_t buffer_index) const {
-    std::vector<u8> buffer{};
+void HLERequestContext::ReadBufferInto(std::vector<u8>& buffer, std::size_t buffer_index) const {
+    buffer.clear();
     const bool is_buffer_a{BufferDescriptorA().size() > buffer_index &&
                            BufferDescriptorA()[buffer_index].Size()};
 
     if (is_buffer_a) {
         ASSERT_OR_EXECUTE_MSG(
-            BufferDescriptorA().size() > buffer_index, { return buffer; },
+            BufferDescriptorA().size() > buffer_index, { return; },
             "BufferDescriptorA invalid buffer_index {}", buffer_index);
         buffer.resize(BufferDescriptorA()[buffer_index].Size());
-        horizon_servctl_read_buffer(BufferDescriptorA()[buffer_index].Address(),
-                                 buffer.data(), buffer.size());
+        ReadFromRequester(BufferDescriptorA()[buffer_index].Address(), buffer.data(),
+                          buffer.size());
     } else {
         ASSERT_OR_EXECUTE_MSG(
-            BufferDescriptorX().size() > buffer_index, { return buffer; },
+            BufferDescriptorX().size() > buffer_index, { return; },
             "BufferDescriptorX invalid buffer_index {}", buffer_index);
         buffer.resize(BufferDescriptorX()[buffer_index].Size());
-        horizon_servctl_read_buffer(BufferDescriptorX()[buffer_index].Address(),
-                                 buffer.data(), buffer.size());
+        ReadFromRequester(BufferDescriptorX()[buffer_index].Address(), buffer.data(),
+                          buffer.size());
     }
+}
 
+void HLERequestContext::ReadFromRequester(u64 address, void* buffer, std::size_t size) const {
+    if (is_deferred) {
+        // Off the service thread there is no current request to read from
+        horizon_servctl_read_buffer_from(address, buffer, size, manager->GetRequesterPid());
+    } else {
+        horizon_servctl_read_buffer(address, buffer, size);
+    }
+}
+
+void HLERequestContext::WriteToRequester(u64 address, const void* buffer, std::size_t size) const {
+    if (is_deferred) {
+        horizon_servctl_write_buffer_to(address, buffer, size, manager->GetRequesterPid());
+    } else {
+        horizon_servctl_write_buffer(address, buffer, size);
+    }
+}
+
+std::vector<u8> HLERequestContext::ReadBuffer(std::size_t buffer_index) const {
+    std::vector<u8> buffer{};
+    ReadBufferInto(buffer, buffer_index);
     return buffer;
 }
 
+const std::vector<u8>& HLERequestContext::ReadBufferInArena(std::size_t buffer_index) const {
+    std::vector<u8>& buffer = RequestArena::Allocate(0);
+    ReadBufferInto(buffer, buffer_index);
+    return buffer;
+}
+
+std::vector<u8>& HLERequestContext::AllocateInArena(std::size_t size) const {
+    return RequestArena::Allocate(size);
+}
+
 std::size_t HLERequestContext::WriteBuffer(const void* buffer, std::size_t size,
                                            std::size_t buffer_index) const {
     if (size == 0) {
@@ -249,13 +471,13 @@ std::size_t HLERequestContext::WriteBuffer(const void* buffer, std::size_t size,
             BufferDescriptorB().size() > buffer_index &&
                 BufferDescriptorB()[buffer_index].Size() >= size,
             { return 0; }, "BufferDescriptorB is invalid, index={}, size={}", buffer_index, size);
-        horizon_servctl_write_buffer(BufferDescriptorB()[buffer_index].Address(), buffer, size);
+        WriteToRequester(BufferDescriptorB()[buffer_index].Address(), buffer, size);
     } else {
         ASSERT_OR_EXECUTE_MSG(
             BufferDescriptorC().size() > buffer_index &&
                 BufferDescriptorC()[buffer_index].Size() >= size,
             { return 0; }, "BufferDescriptorC is invalid, index={}, size={}", buffer_index, size);
-        horizon_servctl_write_buffer(BufferDescriptorC()[buffer_index].Address(), buffer, size);
+        WriteToRequester(BufferDescriptorC()[buffer_index].Address(), buffer, size);
     }
 
     return size;
@@ -367,6 +589,44 @@ std::string HLERequestContext::Description() const {
     return s.str();
 }
 
+std::shared_ptr<HLERequestContext> HLERequestContext::Defer() {
+    ASSERT_MSG(!is_deferred, "Request is already deferred");
+    auto deferred = std::make_shared<HLERequestContext>(*this);
+    deferred->deferred_manager = GetSessionRequestManagerShared();
+    deferred->is_deferred = true;
+    std::memcpy(deferred->deferred_cmd_buf.data(), cmd_buf, sizeof(deferred->deferred_cmd_buf));
+    deferred->kernel_cmd_buf = cmd_buf;
+    deferred->cmd_buf = deferred->deferred_cmd_buf.data();
+    deferred->deferred_queue = &DeferredReplies::QueueOfThisThread();
+    is_deferred = true;
+    return deferred;
+}
+
+void HLERequestContext::SendDeferredReply() {
+    ASSERT(is_deferred);
+    WriteToOutgoingCommandBuffer();
+
+    DeferredReplies::Queue& queue = *deferred_queue;
+    {
+        std::scoped_lock lock{queue.mutex};
+        queue.ready.push_back(shared_from_this());
+        if (!queue.receiving) {
+            // Sent before the thread waits for its next request
+            return;
+        }
+        ::pthread_kill(queue.thread, DeferredReplies::WAKE_SIGNAL);
+    }
+    DeferredReplies::waker.Watch(queue);
+}
+
+void HLERequestContext::PutDeferredReply() {
+    std::memcpy(kernel_cmd_buf, cmd_buf, sizeof(deferred_cmd_buf));
+    if (horizon_servctl(HZN_SCTL_PUT_CMD, GetSessionId(), static_cast<long>(IsDomain())) == -1) {
+        LOG_ERROR(IPC, "HZN_SCTL_PUT_CMD failed for deferred request: {}",
+                  ResultCode(errno).description.Value());
+    }
+}
+
 void HLERequestContext::AppendDomainHandler(SessionRequestHandlerPtr handler) {
     manager->AppendDomainHandler(std::move(handler));
 }
@@ -10,12 +10,16 @@
 #include <functional>
 #include <memory>
 #include <optional>
+#include <ranges>
+#include <span>
 #include <string>
 #include <type_traits>
 #include <vector>
 #include <unordered_set>
 #include <sys/types.h>
 
+#include <boost/container/static_vector.hpp>
+
 #include "common/assert.h"
 #include "common/common_types.h"
 #include "common/concepts.h"
@@ -145,6 +149,39 @@ private:
     ::pid_t requester_pid;
 };
 
+/**
+ * Scratch storage for the buffers of the requests handled by a service thread. Buffers keep their
+ * capacity from one request to the next, so steady state requests do not allocate, and are all
+ * handed back together once the reply has been sent.
+ */
+namespace RequestArena {
+
+/// Returns zeroed storage of the given size, valid until the next Reset on this thread
+std::vector<u8>& Allocate(std::size_t size);
+
+/// Makes all storage available again, called once the reply to the current request was sent
+void Reset();
+
+} // namespace RequestArena
+
+/**
+ * Replies to deferred requests. The command buffer belongs to the service thread that received a
+ * request, so a deferred reply is built in storage of its own and only copied into the command
+ * buffer and sent by that thread, in between two requests.
+ */
+namespace DeferredReplies {
+
+struct Queue;
+
+/**
+ * Sends the deferred replies of this service thread that are ready, then receives the next request
+ * with HZN_SCTL_GET_CMD. Replies that become ready in the meantime interrupt the wait, which then
+ * fails as a cancelled wait does.
+ */
+long SendReadyAndReceive(unsigned long* session_id);
+
+} // namespace DeferredReplies
+
 /**
  * Class containing information about an in-flight IPC request being handled by an HLE service
  * implementation. Services should avoid using old global APIs (e.g. Kernel::GetCommandBuffer()) and
@@ -164,7 +201,7 @@ private:
  * ids are local to a specific context, it avoids requiring services to manage handles for objects
  * across multiple calls and ensuring that unneeded handles are cleaned up.
  */
-class HLERequestContext {
+class HLERequestContext : public std::enable_shared_from_this<HLERequestContext> {
 public:
     explicit HLERequestContext(SessionRequestManager *manager, u32_le* cmd_buf);
     ~HLERequestContext();
@@ -241,20 +278,20 @@ public:
         return data_payload_offset;
     }
 
-    const std::vector<IPC::BufferDescriptorX>& BufferDescriptorX() const {
-        return buffer_x_desciptors;
+    std::span<const IPC::BufferDescriptorX> BufferDescriptorX() const {
+        return {buffer_x_desciptors.data(), buffer_x_desciptors.size()};
     }
 
-    const std::vector<IPC::BufferDescriptorABW>& BufferDescriptorA() const {
-        return buffer_a_desciptors;
+    std::span<const IPC::BufferDescriptorABW> BufferDescriptorA() const {
+        return {buffer_a_desciptors.data(), buffer_a_desciptors.size()};
     }
 
-    const std::vector<IPC::BufferDescriptorABW>& BufferDescriptorB() const {
-        return buffer_b_desciptors;
+    std::span<const IPC::BufferDescriptorABW> BufferDescriptorB() const {
+        return {buffer_b_desciptors.data(), buffer_b_desciptors.size()};
     }
 
-    const std::vector<IPC::BufferDescriptorC>& BufferDescriptorC() const {
-        return buffer_c_desciptors;
+    std::span<const IPC::BufferDescriptorC> BufferDescriptorC() const {
+        return {buffer_c_desciptors.data(), buffer_c_desciptors.size()};
     }
 
     const IPC::DomainMessageHeader& GetDomainMessageHeader() const {
@@ -268,6 +305,18 @@ public:
     /// Helper function to read a buffer using the appropriate buffer descriptor
     std::vector<u8> ReadBuffer(std::size_t buffer_index = 0) const;
 
+    /**
+     * Reads a buffer like ReadBuffer, into storage from the request arena instead of a new vector.
+     * The storage is valid until the reply to this request has been sent.
+     */
+    const std::vector<u8>& ReadBufferInArena(std::size_t buffer_index = 0) const;
+
+    /**
+     * Returns zeroed storage of the given size from the request arena, e.g. to build an output
+     * buffer in. The storage is valid until the reply to this request has been sent.
+     */
+    std::vector<u8>& AllocateInArena(std::size_t size) const;
+
     /// Helper function to write a buffer using the appropriate buffer descriptor
     std::size_t WriteBuffer(const void* buffer, std::size_t size,
                             std::size_t buffer_index = 0) const;
@@ -275,15 +324,16 @@ public:
     /* Helper function to write a buffer using the appropriate buffer descriptor
      *
      * @tparam T an arbitrary container that satisfies the
-     *         ContiguousContainer concept in the C++ standard library or a trivially copyable type.
+     *         ContiguousContainer concept in the C++ standard library, a contiguous range such as
+     *         std::span, or a trivially copyable type.
      *
      * @param data         The container/data to write into a buffer.
      * @param buffer_index The buffer in particular to write to.
      */
     template <typename T, typename = std::enable_if_t<!std::is_pointer_v<T>>>
     std::size_t WriteBuffer(const T& data, std::size_t buffer_index = 0) const {
-        if constexpr (Common::IsSTLContainer<T>) {
-            using ContiguousType = typename T::value_type;
+        if constexpr (Common::IsSTLContainer<T> || std::ranges::contiguous_range<T>) {
+            using ContiguousType = std::ranges::range_value_t<T>;
             static_assert(std::is_trivially_copyable_v<ContiguousType>,
                           "Container to WriteBuffer must contain trivially copyable objects");
             return WriteBuffer(std::data(data), std::size(data) * sizeof(ContiguousType),
@@ -323,6 +373,8 @@ public:
     }
 
     void AddDomainObject(SessionRequestHandlerPtr object) {
+        ASSERT_MSG(outgoing_domain_objects.size() < outgoing_domain_objects.capacity(),
+                   "Too many domain objects in response");
         outgoing_domain_objects.push_back(std::move(object));
     }
 
@@ -333,8 +385,22 @@ public:
 
     std::string Description() const;
 
-    bool IsThreadWaiting() const {
-        return is_thread_waiting;
+    /**
+     * Parks the request, so that the service thread goes on to receive other requests without
+     * replying to this one. The handler builds the reply in the returned context later, from any
+     * thread, and sends it with SendDeferredReply. Buffers must be read before deferring, as data
+     * from the request arena does not outlive the handler, and deferred replies cannot carry
+     * handles or interfaces.
+     */
+    std::shared_ptr<HLERequestContext> Defer();
+
+    /// Queues the reply of a deferred request on the service thread that received it, which sends
+    /// it before it waits for its next request. Does not wait for the reply to be sent.
+    void SendDeferredReply();
+
+    /// Returns true if the reply to this request is sent later, see Defer
+    bool IsDeferred() const {
+        return is_deferred;
     }
 
     /// When set to True, converts the session to a domain at the end of the command
@@ -342,27 +408,41 @@ public:
 
 private:
     friend class IPC::ResponseBuilder;
+    friend long DeferredReplies::SendReadyAndReceive(unsigned long* session_id);
 
     void ParseCommandBuffer(u32_le* src_cmdbuf, bool incoming);
 
+    void ReadBufferInto(std::vector<u8>& buffer, std::size_t buffer_index) const;
+    void ReadFromRequester(u64 address, void* buffer, std::size_t size) const;
+    void WriteToRequester(u64 address, const void* buffer, std::size_t size) const;
+
+    /// Copies a deferred reply into the command buffer and sends it, on the service thread
+    void PutDeferredReply();
+
+    // Message contents are bounded by the IPC limits, so they are stored in place and parsing a
+    // request does not allocate.
+    template <typename T, std::size_t N>
+    using FixedVector = boost::container::static_vector<T, N>;
+
     u32 *cmd_buf = nullptr;
 
-    std::vector<Handle> incoming_move_handles;
-    std::vector<Handle> incoming_copy_handles;
+    FixedVector<Handle, IPC::MAX_HANDLES> incoming_move_handles;
+    FixedVector<Handle, IPC::MAX_HANDLES> incoming_copy_handles;
 
-    std::vector<Handle> outgoing_move_handles;
-    std::vector<int> outgoing_copy_fds;
-    std::vector<SessionRequestHandlerPtr> outgoing_domain_objects;
+    FixedVector<Handle, IPC::MAX_HANDLES> outgoing_move_handles;
+    FixedVector<int, IPC::MAX_HANDLES> outgoing_copy_fds;
+    // Domain objects are returned in place of move handles outside of domains
+    FixedVector<SessionRequestHandlerPtr, IPC::MAX_HANDLES> outgoing_domain_objects;
 
     std::optional<IPC::CommandHeader> command_header;
     std::optional<IPC::HandleDescriptorHeader> handle_descriptor_header;
     std::optional<IPC::DataPayloadHeader> data_payload_header;
     std::optional<IPC::DomainMessageHeader> domain_message_header;
-    std::vector<IPC::BufferDescriptorX> buffer_x_desciptors;
-    std::vector<IPC::BufferDescriptorABW> buffer_a_desciptors;
-    std::vector<IPC::BufferDescriptorABW> buffer_b_desciptors;
-    std::vector<IPC::BufferDescriptorABW> buffer_w_desciptors;
-    std::vector<IPC::BufferDescriptorC> buffer_c_desciptors;
+    FixedVector<IPC::BufferDescriptorX, IPC::MAX_BUFFER_DESCRIPTORS> buffer_x_desciptors;
+    FixedVector<IPC::BufferDescriptorABW, IPC::MAX_BUFFER_DESCRIPTORS> buffer_a_desciptors;
+    FixedVector<IPC::BufferDescriptorABW, IPC::MAX_BUFFER_DESCRIPTORS> buffer_b_desciptors;
+    FixedVector<IPC::BufferDescriptorABW, IPC::MAX_BUFFER_DESCRIPTORS> buffer_w_desciptors;
+    FixedVector<IPC::BufferDescriptorC, IPC::MAX_BUFFER_C_DESCRIPTORS> buffer_c_desciptors;
 
     u32_le command{};
     u64 pid{};
@@ -372,7 +452,14 @@ private:
     u32 domain_offset{};
 
     SessionRequestManager *manager;
-    bool is_thread_waiting{};
+    // Keeps the session alive until the reply to a deferred request has been sent
+    std::shared_ptr<SessionRequestManager> deferred_manager;
+    bool is_deferred{};
+    // Deferred requests read and write their own copy of the command buffer, which the service
+    // thread copies back into the buffer the request came in when it sends the reply
+    std::array<u32, IPC::COMMAND_BUFFER_LENGTH> deferred_cmd_buf{};
+    u32* kernel_cmd_buf = nullptr;
+    DeferredReplies::Queue* deferred_queue = nullptr;
 };
 
 } // namespace Kernel
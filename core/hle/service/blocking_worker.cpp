@@ -0,0 +1,73 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "common/thread.h"
+#include "core/hle/kernel/hle_ipc.h"
+#include "core/hle/service/blocking_worker.h"
+
+namespace Service {
+
+namespace {
+/// Workers that have been idle this long exit
+constexpr auto IDLE_TIMEOUT = std::chrono::seconds{30};
+
+/**
+ * Workers are started on demand, so that there is one for each outstanding task. A fixed number
+ * of them could all end up waiting on something that never happens, e.g. sockets nobody writes
+ * to, and starve the others.
+ */
+struct WorkerPool {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Common::UniqueFunction<void>> tasks;
+    std::size_t num_idle = 0;
+};
+WorkerPool pool;
+
+void RunWorker() {
+    Common::SetCurrentThreadName("mizu:BlockingWorker");
+    std::unique_lock lock{pool.mutex};
+    while (true) {
+        ++pool.num_idle;
+        const bool has_task =
+            pool.condition.wait_for(lock, IDLE_TIMEOUT, [] { return !pool.tasks.empty(); });
+        --pool.num_idle;
+        if (!has_task) {
+            return;
+        }
+        auto task = std::move(pool.tasks.front());
+        pool.tasks.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+void QueueTask(Common::UniqueFunction<void> task) {
+    {
+        std::scoped_lock lock{pool.mutex};
+        pool.tasks.emplace_back(std::move(task));
+        if (pool.num_idle < pool.tasks.size()) {
+            std::thread(RunWorker).detach();
+        }
+    }
+    pool.condition.notify_one();
+}
+} // Anonymous namespace
+
+void RunBlocking(Kernel::HLERequestContext& ctx,
+                 Common::UniqueFunction<void, Kernel::HLERequestContext&> work) {
+    QueueTask([deferred = ctx.Defer(), work = std::move(work)] {
+        work(*deferred);
+        deferred->SendDeferredReply();
+    });
+}
+
+} // namespace Service
@@ -0,0 +1,24 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/unique_function.h"
+
+namespace Kernel {
+class HLERequestContext;
+}
+
+namespace Service {
+
+/**
+ * Defers the request and runs work on a worker thread, which then sends the reply built by work.
+ * For handlers that wait on other threads, e.g. for a socket, a GPU fence or a free buffer, so
+ * that the wait does not stall the service thread for every other session.
+ *
+ * Work receives the deferred context, see Kernel::HLERequestContext::Defer for what it may do.
+ */
+void RunBlocking(Kernel::HLERequestContext& ctx,
+                 Common::UniqueFunction<void, Kernel::HLERequestContext&> work);
+
+} // namespace Service
@@ -22,6 +22,7 @@
 #include "core/file_sys/registered_cache.h"
 #include "core/file_sys/romfs_factory.h"
 #include "core/file_sys/savedata_factory.h"
+#include "core/file_sys/savedata_journal.h"
 #include "core/file_sys/sdmc_factory.h"
 #include "core/file_sys/vfs.h"
 #include "core/file_sys/vfs_offset.h"
@@ -277,6 +278,15 @@ ResultVal<FileSys::FileTimeStampRaw> VfsDirectoryServiceWrapper::GetFileTimeStam
     return MakeResult(dir->GetFileTimeStamp(Common::FS::GetFilename(path)));
 }
 
+ResultCode VfsDirectoryServiceWrapper::Commit() const {
+    // Other archives write through to the disk right away
+    auto* const journaled = dynamic_cast<FileSys::JournaledVfsDirectory*>(backing.get());
+    if (journaled != nullptr && !journaled->Commit()) {
+        return ResultUnknown;
+    }
+    return ResultSuccess;
+}
+
 FileSystemController::FileSystemController() {}
 
 FileSystemController::~FileSystemController() = default;
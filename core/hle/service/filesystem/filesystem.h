@@ -251,6 +251,12 @@ public:
      */
     ResultVal<FileSys::FileTimeStampRaw> GetFileTimeStampRaw(const std::string& path) const;
 
+    /**
+     * Commits the writes to the archive, when it stages them until then
+     * @return Result of the operation
+     */
+    ResultCode Commit() const;
+
 private:
     FileSys::VirtualDir backing;
 };
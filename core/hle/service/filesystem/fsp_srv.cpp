@@ -7,6 +7,7 @@
 #include <cinttypes>
 #include <cstring>
 #include <iterator>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -27,13 +28,38 @@
 #include "core/file_sys/savedata_factory.h"
 #include "core/file_sys/system_archive/system_archive.h"
 #include "core/file_sys/vfs.h"
+#include "core/file_sys/vfs_async.h"
 #include "core/hle/ipc_helpers.h"
+#include "core/hle/service/blocking_worker.h"
 #include "core/hle/service/filesystem/filesystem.h"
 #include "core/hle/service/filesystem/fsp_srv.h"
 #include "core/reporter.h"
 
 namespace Service::FileSystem {
 
+/**
+ * Reads like ReadBytes without blocking the service thread, the reply is built by the thread
+ * that completes the read. With reply_size, the size read follows the result, as for IFile.
+ */
+static void ReadDeferred(Kernel::HLERequestContext& ctx, FileSys::VirtualFile backend, s64 offset,
+                         s64 length, bool reply_size) {
+    // Not zeroed, only what was read is written back
+    auto output = std::make_unique_for_overwrite<u8[]>(static_cast<std::size_t>(length));
+    const std::span<u8> dest{output.get(), static_cast<std::size_t>(length)};
+    FileSys::ReadAsync(std::move(backend), dest, static_cast<std::size_t>(offset),
+                       [deferred = ctx.Defer(), output = std::move(output),
+                        reply_size](std::size_t bytes_read) {
+                           deferred->WriteBuffer(output.get(), bytes_read);
+
+                           IPC::ResponseBuilder rb{*deferred, reply_size ? 4u : 2u};
+                           rb.Push(ResultSuccess);
+                           if (reply_size) {
+                               rb.Push(static_cast<u64>(bytes_read));
+                           }
+                           deferred->SendDeferredReply();
+                       });
+}
+
 struct SizeGetter {
     std::function<u64()> get_free_size;
     std::function<u64()> get_total_size;
@@ -100,6 +126,11 @@ private:
             return;
         }
 
+        if (Settings::values.use_async_fs_io.GetValue()) {
+            ReadDeferred(ctx, backend, offset, length, false);
+            return;
+        }
+
         // Read the data from the Storage backend
         std::vector<u8> output = backend->ReadBytes(length, offset);
         // Write the data to memory
@@ -161,6 +192,11 @@ private:
             return;
         }
 
+        if (Settings::values.use_async_fs_io.GetValue()) {
+            ReadDeferred(ctx, backend, offset, length, true);
+            return;
+        }
+
         // Read the data from the Storage backend
         std::vector<u8> output = backend->ReadBytes(length, offset);
 
@@ -484,10 +520,20 @@ public:
     }
 
     void Commit(Kernel::HLERequestContext& ctx) {
-        LOG_WARNING(Service_FS, "(STUBBED) called");
+        LOG_DEBUG(Service_FS, "called");
 
-        IPC::ResponseBuilder rb{ctx, 2};
-        rb.Push(ResultSuccess);
+        if (!Settings::values.use_save_data_journal.GetValue()) {
+            // Writes already went straight to the files
+            IPC::ResponseBuilder rb{ctx, 2};
+            rb.Push(ResultSuccess);
+            return;
+        }
+
+        // Syncing to the disk can take a while, the other sessions are served in the meantime
+        RunBlocking(ctx, [backend = backend](Kernel::HLERequestContext& ctx) {
+            IPC::ResponseBuilder rb{ctx, 2};
+            rb.Push(backend.Commit());
+        });
     }
 
     void GetFreeSpaceSize(Kernel::HLERequestContext& ctx) {
@@ -445,6 +445,8 @@ void Controller_NPad::OnUpdate(u8* data,
     if (!IsControllerActivated()) {
         return;
     }
+    // Every device of a controller reads the same published state during this update
+    const Input::SnapshotScope snapshot_scope;
     for (std::size_t i = 0; i < shared_memory_entries.size(); ++i) {
         auto& npad = shared_memory_entries[i];
         const std::array<NPadGeneric*, 7> controller_npads{
@@ -612,6 +614,29 @@ void Controller_NPad::OnUpdate(u8* data,
     }
     std::memcpy(data + NPAD_OFFSET, shared_memory_entries.data(),
                 shared_memory_entries.size() * sizeof(NPadEntry));
+    RecordInputLatency(snapshot_scope);
+}
+
+void Controller_NPad::RecordInputLatency(const Input::SnapshotScope& scope) {
+    constexpr u64 samples_per_report = 1000;
+
+    const std::optional<s64> event_time = scope.OldestEventTime();
+    if (!event_time) {
+        return;
+    }
+    const s64 latency = Input::SnapshotScope::Now() - *event_time;
+    input_latency_total += latency;
+    input_latency_max = std::max(input_latency_max, latency);
+    if (++input_latency_samples < samples_per_report) {
+        return;
+    }
+    LOG_DEBUG(Service_HID, "Input latency over {} updates: average {} us, max {} us",
+              input_latency_samples,
+              input_latency_total / static_cast<s64>(input_latency_samples) / 1000,
+              input_latency_max / 1000);
+    input_latency_samples = 0;
+    input_latency_total = 0;
+    input_latency_max = 0;
 }
 
 void Controller_NPad::OnMotionUpdate(u8* data,
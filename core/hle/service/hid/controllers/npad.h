@@ -546,6 +546,7 @@ private:
     void InitNewlyAddedController(std::size_t controller_idx);
     bool IsControllerSupported(NPadControllerType controller) const;
     void RequestPadStateUpdate(u32 npad_id);
+    void RecordInputLatency(const Input::SnapshotScope& scope);
 
     std::atomic<u32> press_state{};
 
@@ -591,5 +592,10 @@ private:
     std::array<ControllerPad, 10> npad_pad_states{};
     std::array<TriggerState, 10> npad_trigger_states{};
     bool is_in_lr_assignment_mode{false};
+
+    // Latency from the newest backend input event to the shared memory write, in nanoseconds
+    u64 input_latency_samples{};
+    s64 input_latency_total{};
+    s64 input_latency_max{};
 };
 } // namespace Service::HID
@@ -4,8 +4,11 @@
 //
 // Adapted by Kent Hall for mizu on Horizon Linux.
 
+#include <algorithm>
 #include <array>
 #include <csignal>
+#include <utility>
+#include <vector>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include "common/common_types.h"
@@ -41,6 +44,116 @@ namespace Service::HID {
 constexpr auto pad_update_ns = std::chrono::nanoseconds{1000 * 1000};         // (1ms, 1000Hz)
 constexpr auto motion_update_ns = std::chrono::nanoseconds{15 * 1000 * 1000}; // (15ms, 66.666Hz)
 
+/**
+ * Drives the updates of every IAppletResource from a single pair of timers. All resources are
+ * updated inside the same input snapshot scope, so each physical controller is sampled once per
+ * tick however many sessions consume it. The timers stop while no resource has an activated
+ * controller and are restarted by the next activation.
+ */
+class UpdateDriver {
+public:
+    static UpdateDriver& Instance() {
+        static UpdateDriver driver;
+        return driver;
+    }
+
+    void Register(IAppletResource* resource) {
+        std::lock_guard lock{mutex};
+        resources.push_back(resource);
+        ScheduleLocked();
+    }
+
+    void Unregister(IAppletResource* resource) {
+        // Waits for a running update, no callback can observe the resource afterwards
+        std::lock_guard lock{mutex};
+        std::erase(resources, resource);
+    }
+
+    /// Restarts the timers if they were stopped for lack of activated controllers
+    void Wake() {
+        std::lock_guard lock{mutex};
+        ScheduleLocked();
+    }
+
+private:
+    UpdateDriver() {
+        pad_update_event = KernelHelpers::CreateTimerEvent(
+            "HID::UpdatePadCallback", this, [](::sigval sigev_value) {
+                static_cast<UpdateDriver*>(sigev_value.sival_ptr)->UpdateControllers();
+            });
+        motion_update_event = KernelHelpers::CreateTimerEvent(
+            "HID::MotionPadCallback", this, [](::sigval sigev_value) {
+                static_cast<UpdateDriver*>(sigev_value.sival_ptr)->UpdateMotion();
+            });
+    }
+
+    ~UpdateDriver() {
+        std::lock_guard lock{mutex};
+        resources.clear();
+        KernelHelpers::CloseTimerEvent(pad_update_event);
+        KernelHelpers::CloseTimerEvent(motion_update_event);
+    }
+
+    void ScheduleLocked() {
+        if (!pad_scheduled) {
+            pad_scheduled = true;
+            KernelHelpers::ScheduleTimerEvent(pad_update_ns, pad_update_event);
+        }
+        if (!motion_scheduled) {
+            motion_scheduled = true;
+            KernelHelpers::ScheduleTimerEvent(motion_update_ns, motion_update_event);
+        }
+    }
+
+    void UpdateControllers() {
+        std::lock_guard lock{mutex};
+        const bool should_reload = Settings::values.is_device_reload_pending.exchange(false);
+        const Input::SnapshotScope snapshot_scope;
+
+        bool any_activated = false;
+        for (IAppletResource* resource : resources) {
+            const auto guard = resource->LockService();
+            if (!resource->HasActivatedControllers()) {
+                resource->reload_pending |= should_reload;
+                continue;
+            }
+            any_activated = true;
+            resource->UpdateControllers(should_reload);
+        }
+
+        pad_scheduled = any_activated;
+        if (any_activated) {
+            KernelHelpers::ScheduleTimerEvent(pad_update_ns, pad_update_event);
+        }
+    }
+
+    void UpdateMotion() {
+        std::lock_guard lock{mutex};
+
+        bool any_activated = false;
+        for (IAppletResource* resource : resources) {
+            const auto guard = resource->LockService();
+            if (!resource->IsMotionActivated()) {
+                continue;
+            }
+            any_activated = true;
+            resource->UpdateMotion();
+        }
+
+        motion_scheduled = any_activated;
+        if (any_activated) {
+            KernelHelpers::ScheduleTimerEvent(motion_update_ns, motion_update_event);
+        }
+    }
+
+    std::mutex mutex;
+    std::vector<IAppletResource*> resources;
+    ::timer_t pad_update_event;
+    ::timer_t motion_update_event;
+    bool pad_scheduled{false};
+    bool motion_scheduled{false};
+};
+
 IAppletResource::IAppletResource()
     : ServiceFramework{"IAppletResource"}, shared_mem{nullptr, shared_mem_deleter} {
     static const FunctionInfo functions[] = {
@@ -90,32 +203,14 @@ IAppletResource::IAppletResource()
     GetController<Controller_Stubbed>(HidController::InputDetector).WriteLocked()->SetCommonHeaderOffset(0x5200);
     GetController<Controller_Stubbed>(HidController::UniquePad).WriteLocked()->SetCommonHeaderOffset(0x5A00);
 
-    // Register update callbacks
-    pad_update_event = KernelHelpers::CreateTimerEvent(
-        "HID::UpdatePadCallback",
-        this,
-        [](::sigval sigev_value) {
-            auto iar = static_cast<IAppletResource *>(sigev_value.sival_ptr);
-            const auto guard = iar->LockService();
-            iar->UpdateControllers();
-        });
-    motion_update_event = KernelHelpers::CreateTimerEvent(
-        "HID::MotionPadCallback",
-        this,
-        [](::sigval sigev_value) {
-            auto iar = static_cast<IAppletResource *>(sigev_value.sival_ptr);
-            const auto guard = iar->LockService();
-            iar->UpdateMotion();
-        });
-
-    KernelHelpers::ScheduleTimerEvent(pad_update_ns, pad_update_event);
-    KernelHelpers::ScheduleTimerEvent(motion_update_ns, motion_update_event);
+    UpdateDriver::Instance().Register(this);
 
     ReloadInputDevices();
 }
 
 void IAppletResource::ActivateController(HidController controller) {
     controllers[static_cast<size_t>(controller)]->ActivateController();
+    UpdateDriver::Instance().Wake();
 }
 
 void IAppletResource::DeactivateController(HidController controller) {
@@ -123,14 +218,7 @@ void IAppletResource::DeactivateController(HidController controller) {
 }
 
 IAppletResource::~IAppletResource() {
-    ASSERT(stop_source.request_stop());
-    {
-        std::unique_lock lock{done_mtx};
-        while (!pad_is_done || !motion_is_done)
-            done_cv.wait(lock);
-    }
-    KernelHelpers::CloseTimerEvent(pad_update_event);
-    KernelHelpers::CloseTimerEvent(motion_update_event);
+    UpdateDriver::Instance().Unregister(this);
     if (shared_mem_fd != -1) {
         ::close(shared_mem_fd);
     }
@@ -144,37 +232,29 @@ void IAppletResource::GetSharedMemoryHandle(Kernel::HLERequestContext& ctx) {
     rb.PushCopyFds(shared_mem_fd);
 }
 
-void IAppletResource::UpdateControllers() {
-    if (stop_source.stop_requested()) {
-        std::unique_lock lock{done_mtx};
-        pad_is_done = true;
-        done_cv.notify_all();
-        return;
-    }
+bool IAppletResource::HasActivatedControllers() const {
+    return std::any_of(controllers.begin(), controllers.end(), [](const auto& controller) {
+        return controller->IsControllerActivated();
+    });
+}
+
+bool IAppletResource::IsMotionActivated() const {
+    return controllers[static_cast<size_t>(HidController::NPad)]->IsControllerActivated();
+}
 
-    const bool should_reload = Settings::values.is_device_reload_pending.exchange(false);
+void IAppletResource::UpdateControllers(bool should_reload) {
+    should_reload |= std::exchange(reload_pending, false);
     for (const auto& controller : controllers) {
         if (should_reload) {
             controller->OnLoadInputDevices();
         }
         controller->OnUpdate(shared_mem.get(), SHARED_MEMORY_SIZE);
     }
-
-    KernelHelpers::ScheduleTimerEvent(pad_update_ns, pad_update_event);
 }
 
 void IAppletResource::UpdateMotion() {
-    if (stop_source.stop_requested()) {
-        std::unique_lock lock{done_mtx};
-        motion_is_done = true;
-        done_cv.notify_all();
-        return;
-    }
-
     controllers[static_cast<size_t>(HidController::NPad)]->OnMotionUpdate(
         shared_mem.get(), SHARED_MEMORY_SIZE);
-
-    KernelHelpers::ScheduleTimerEvent(motion_update_ns, motion_update_event);
 }
 
 class IActiveVibrationDeviceList final : public ServiceFramework<IActiveVibrationDeviceList> {
@@ -1281,8 +1361,8 @@ void Hid::SendVibrationValues(Kernel::HLERequestContext& ctx) {
     IPC::RequestParser rp{ctx};
     const auto applet_resource_user_id{rp.Pop<u64>()};
 
-    const auto handles = ctx.ReadBuffer(0);
-    const auto vibrations = ctx.ReadBuffer(1);
+    const auto& handles = ctx.ReadBufferInArena(0);
+    const auto& vibrations = ctx.ReadBufferInArena(1);
 
     std::vector<Controller_NPad::DeviceHandle> vibration_device_handles(
         handles.size() / sizeof(Controller_NPad::DeviceHandle));
@@ -1570,8 +1650,7 @@ void Hid::InitializeSevenSixAxisSensor(Kernel::HLERequestContext& ctx) {
     ASSERT_MSG(t_mem_2->GetSize() == 0x7F000, "t_mem_2 has incorrect size");
 
     // Activate console six axis controller
-    (*SharedReader(applet_resource))->GetController<Controller_ConsoleSixAxis>(HidController::ConsoleSixAxisSensor)
-        .WriteLocked()->ActivateController();
+    (*SharedReader(applet_resource))->ActivateController(HidController::ConsoleSixAxisSensor);
 
     (*SharedReader(applet_resource))->GetController<Controller_ConsoleSixAxis>(HidController::ConsoleSixAxisSensor)
         .WriteLocked()->SetTransferMemoryPointer(sYstem.Memory().GetPointer(t_mem_1->GetSourceAddress()));
@@ -8,8 +8,6 @@
 
 #include <chrono>
 #include <mutex>
-#include <stop_token>
-#include <condition_variable>
 #include <sys/mman.h>
 
 #include "core/hle/service/hid/controllers/controller_base.h"
@@ -42,6 +40,8 @@ enum class HidController : std::size_t {
     MaxControllers,
 };
 
+class UpdateDriver;
+
 class IAppletResource final : public ServiceFramework<IAppletResource> {
 public:
     explicit IAppletResource();
@@ -61,22 +61,21 @@ public:
     }
 
 private:
+    friend class UpdateDriver;
+
     template <typename T>
     void MakeController(HidController controller) {
         controllers[static_cast<std::size_t>(controller)] = std::make_unique<T>();
     }
 
     void GetSharedMemoryHandle(Kernel::HLERequestContext& ctx);
-    void UpdateControllers();
+    bool HasActivatedControllers() const;
+    bool IsMotionActivated() const;
+    void UpdateControllers(bool should_reload);
     void UpdateMotion();
 
-    ::timer_t pad_update_event;
-    ::timer_t motion_update_event;
-
-    std::stop_source stop_source;
-    std::condition_variable done_cv;
-    std::mutex done_mtx;
-    bool pad_is_done = false, motion_is_done = false;
+    // Set when a device reload was requested while this resource was idle
+    bool reload_pending{false};
 
     std::array<std::unique_ptr<ControllerBase>, static_cast<size_t>(HidController::MaxControllers)>
         controllers{};
@@ -0,0 +1,169 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "common/fs/fs_paths.h"
+#include "common/fs/path_util.h"
+#include "common/logging/log.h"
+#include "common/settings.h"
+#include "core/hle/kernel/hle_ipc.h"
+#include "core/hle/service/ipc_trace.h"
+#include "core/hle/service/ipc_trace_format.h"
+#include "core/hle/service/service.h"
+
+namespace Service::IPCTrace {
+
+namespace {
+static_assert(sizeof(ipc_trace_name) == 64);
+static_assert(sizeof(ipc_trace_header) == 64 + IPC_TRACE_MAX_NAMES * sizeof(ipc_trace_name));
+static_assert(sizeof(ipc_trace_record) == 64);
+
+constexpr char TRACE_FILE[] = "ipc_trace.bin";
+
+/// 64 MiB of records
+constexpr u64 NUM_RECORDS = 1 << 20;
+
+constexpr std::size_t FILE_SIZE = sizeof(ipc_trace_header) + NUM_RECORDS * sizeof(ipc_trace_record);
+
+ipc_trace_header* header{};
+ipc_trace_record* records{};
+
+/// Serializes additions to the name table
+std::mutex names_mutex;
+
+/// Title of the process requests came from last on this service thread
+struct CachedTitle {
+    ::pid_t pid = -1;
+    u64 title_id = 0;
+};
+thread_local CachedTitle cached_title;
+
+u64 TitleID(::pid_t pid) {
+    if (cached_title.pid != pid) {
+        cached_title = {pid, GetTitleID()};
+    }
+    return cached_title.title_id;
+}
+
+u32 TotalSize(const auto& descriptors) {
+    u64 size = 0;
+    for (const auto& descriptor : descriptors) {
+        size += descriptor.Size();
+    }
+    return static_cast<u32>(std::min<u64>(size, UINT32_MAX));
+}
+
+bool AddName(u32 service_id, u32 command_id, u32 flags, std::string_view name) {
+    const u32 index = header->num_names;
+    if (index == IPC_TRACE_MAX_NAMES) {
+        return false;
+    }
+    ipc_trace_name& entry = header->names[index];
+    entry.service_id = service_id;
+    entry.command_id = command_id;
+    entry.flags = flags;
+    const std::size_t length = std::min(name.size(), sizeof(entry.name) - 1);
+    std::memcpy(entry.name, name.data(), length);
+    entry.name[length] = '\0';
+    std::atomic_ref{header->num_names}.store(index + 1, std::memory_order_release);
+    return true;
+}
+} // Anonymous namespace
+
+void Initialize() {
+    if (!Settings::values.enable_ipc_trace.GetValue() || header) {
+        return;
+    }
+    const auto path = Common::FS::GetMizuPath(Common::FS::MizuPath::LogDir) / TRACE_FILE;
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        LOG_ERROR(Service, "Unable to create IPC trace {}: {}", path.string(), ::strerror(errno));
+        return;
+    }
+    void* mapping = MAP_FAILED;
+    if (::ftruncate(fd, FILE_SIZE) == 0) {
+        mapping = ::mmap(nullptr, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR(Service, "Unable to map IPC trace {}: {}", path.string(), ::strerror(errno));
+        ::close(fd);
+        return;
+    }
+    // The mapping keeps the file alive
+    ::close(fd);
+
+    auto* const new_header = static_cast<ipc_trace_header*>(mapping);
+    new_header->version = IPC_TRACE_VERSION;
+    new_header->capacity = NUM_RECORDS;
+    // The magic goes last, the analyzer rejects files whose header was not written out
+    std::atomic_ref{new_header->magic}.store(IPC_TRACE_MAGIC, std::memory_order_release);
+
+    header = new_header;
+    records = reinterpret_cast<ipc_trace_record*>(static_cast<u8*>(mapping) +
+                                                  sizeof(ipc_trace_header));
+    LOG_INFO(Service, "Recording IPC requests to {}", path.string());
+}
+
+bool IsEnabled() {
+    return header != nullptr;
+}
+
+u16 RegisterService(std::string_view service_name, std::span<const CommandName> commands) {
+    std::scoped_lock lock{names_mutex};
+    // Service ids are name table indices, id 0 is used for services missing from the table
+    if (header->num_names == 0) {
+        AddName(0, IPC_TRACE_SERVICE_NAME, 0, "(none)");
+    }
+    const u32 service_id = header->num_names;
+    if (service_id > UINT16_MAX || !AddName(service_id, IPC_TRACE_SERVICE_NAME, 0, service_name)) {
+        LOG_WARNING(Service, "IPC trace name table is full, {} is not traced", service_name);
+        return 0;
+    }
+    for (const CommandName& command : commands) {
+        if (!AddName(service_id, command.command_id, command.is_tipc ? IPC_TRACE_FLAG_TIPC : 0,
+                     command.name)) {
+            LOG_WARNING(Service, "IPC trace name table is full, some commands of {} are unnamed",
+                        service_name);
+            break;
+        }
+    }
+    return static_cast<u16>(service_id);
+}
+
+void Record(u16 service_id, Kernel::HLERequestContext& ctx,
+            std::chrono::steady_clock::time_point start) {
+    const auto end = std::chrono::steady_clock::now();
+    const u64 index = std::atomic_ref{header->next}.fetch_add(1, std::memory_order_relaxed);
+    ipc_trace_record& record = records[index % NUM_RECORDS];
+    std::atomic_ref sequence{record.sequence};
+    sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const ::pid_t pid = ctx.GetRequesterPid();
+    record.timestamp_ns = static_cast<u64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count());
+    record.duration_ns = static_cast<u64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    record.title_id = TitleID(pid);
+    record.pid = static_cast<u32>(pid);
+    record.command_id = ctx.GetCommand();
+    record.object_id =
+        ctx.IsDomain() && ctx.HasDomainMessageHeader() ? ctx.GetDomainMessageHeader().object_id : 0;
+    record.service_id = service_id;
+    record.command_type = static_cast<u8>(ctx.GetCommandType());
+    record.flags = ctx.IsTipc() ? IPC_TRACE_FLAG_TIPC : 0;
+    record.in_size = TotalSize(ctx.BufferDescriptorA()) + TotalSize(ctx.BufferDescriptorX());
+    record.out_size = TotalSize(ctx.BufferDescriptorB()) + TotalSize(ctx.BufferDescriptorC());
+
+    sequence.store(index + 1, std::memory_order_release);
+}
+
+} // namespace Service::IPCTrace
@@ -0,0 +1,45 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <chrono>
+#include <span>
+#include <string_view>
+
+#include "common/common_types.h"
+
+namespace Kernel {
+class HLERequestContext;
+}
+
+/**
+ * Optional binary trace of every IPC request handled by the services, for offline analysis with
+ * ipctrace. Records go to a ring in a memory mapped file in the log directory, recording one costs
+ * a few stores and no system calls once the requesting process is known.
+ */
+namespace Service::IPCTrace {
+
+struct CommandName {
+    u32 command_id;
+    bool is_tipc;
+    const char* name;
+};
+
+/// Creates the trace file and starts recording, when enabled in the settings
+void Initialize();
+
+/// Returns true when requests are being recorded
+[[nodiscard]] bool IsEnabled();
+
+/**
+ * Adds a service and the names of its commands to the name table of the trace.
+ * Returns the id of the service to pass to Record, 0 when the table is full.
+ */
+u16 RegisterService(std::string_view service_name, std::span<const CommandName> commands);
+
+/// Records a request handled by the service with the given id, received at start
+void Record(u16 service_id, Kernel::HLERequestContext& ctx,
+            std::chrono::steady_clock::time_point start);
+
+} // namespace Service::IPCTrace
@@ -0,0 +1,59 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+/*
+ * Layout of the IPC trace file, shared with the ipctrace analyzer so it has to stay plain C.
+ *
+ * The file starts with a header holding the name table, followed by a ring of fixed size records.
+ * A record is complete when its sequence equals its index plus one, the ring holds the last
+ * capacity records out of the next records written.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define IPC_TRACE_MAGIC 0x4543415254435049ULL /* "IPCTRACE" */
+#define IPC_TRACE_VERSION 1
+
+#define IPC_TRACE_MAX_NAMES 8192
+#define IPC_TRACE_NAME_LENGTH 52
+
+/* Command id of the name entry holding the name of the service itself */
+#define IPC_TRACE_SERVICE_NAME 0xFFFFFFFFu
+
+/* Record and name flags */
+#define IPC_TRACE_FLAG_TIPC 0x1 /* the command id is a TIPC command */
+
+struct ipc_trace_name {
+    uint32_t service_id;
+    uint32_t command_id;
+    uint32_t flags;
+    char name[IPC_TRACE_NAME_LENGTH]; /* null terminated */
+};
+
+struct ipc_trace_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t num_names; /* published name entries */
+    uint64_t capacity;  /* number of record slots */
+    uint64_t next;      /* number of records reserved so far */
+    uint64_t reserved[4];
+    struct ipc_trace_name names[IPC_TRACE_MAX_NAMES];
+};
+
+struct ipc_trace_record {
+    uint64_t sequence;     /* index of the record plus one, 0 while it is being written */
+    uint64_t timestamp_ns; /* CLOCK_MONOTONIC when the request was received */
+    uint64_t duration_ns;  /* time spent handling the request */
+    uint64_t title_id;
+    uint32_t pid;        /* requesting process */
+    uint32_t command_id;
+    uint32_t object_id;  /* domain object, 0 outside of domains */
+    uint16_t service_id; /* index into the name table of the service name */
+    uint8_t command_type;
+    uint8_t flags;
+    uint32_t in_size;  /* total size of the A and X buffers */
+    uint32_t out_size; /* total size of the B and C buffers */
+    uint32_t reserved[2];
+};
@@ -57,6 +57,15 @@ public:
                             std::vector<u8>& output, std::vector<u8>& inline_output,
 			    Shared<Tegra::GPU>& gpu) = 0;
 
+    /**
+     * Returns true if the ioctl1 request may wait for the GPU. Such requests are handled on a
+     * worker thread, and without holding the device lock, so the device has to synchronize them
+     * with its other ioctls itself.
+     */
+    virtual bool IsBlockingIoctl1(Ioctl command, const std::vector<u8>& input) {
+        return false;
+    }
+
     /**
      * Called once a device is openned
      * @param fd The device fd
@@ -60,6 +60,21 @@ NvResult nvhost_ctrl::Ioctl3(DeviceFD fd, Ioctl command, const std::vector<u8>&
     return NvResult::NotImplemented;
 }
 
+bool nvhost_ctrl::IsBlockingIoctl1(Ioctl command, const std::vector<u8>& input) {
+    if (command.group != 0x0 || (command.cmd != 0x1d && command.cmd != 0x1e) ||
+        input.size() < sizeof(IocCtrlEventWaitParams)) {
+        return false;
+    }
+    IocCtrlEventWaitParams params{};
+    std::memcpy(&params, input.data(), sizeof(params));
+    const u32 event_id = params.value & 0x00FF;
+    // Only events that failed before are waited for with WaitFence, the others time out
+    // immediately and get signalled later. All of the state is in events_interface and the
+    // syncpoint manager, so the waits need no device lock.
+    return params.timeout != 0 && event_id < MaxNvEvents &&
+           SharedReader(events_interface)->failed[event_id];
+}
+
 void nvhost_ctrl::OnOpen(DeviceFD fd, Shared<Tegra::GPU>& gpu) {}
 void nvhost_ctrl::OnClose(DeviceFD fd, Shared<Tegra::GPU>& gpu) {}
 
@@ -27,6 +27,8 @@ public:
     NvResult Ioctl3(DeviceFD fd, Ioctl command, const std::vector<u8>& input,
                     std::vector<u8>& output, std::vector<u8>& inline_output, Shared<Tegra::GPU>& gpu) override;
 
+    bool IsBlockingIoctl1(Ioctl command, const std::vector<u8>& input) override;
+
     void OnOpen(DeviceFD fd, Shared<Tegra::GPU>& gpu) override;
     void OnClose(DeviceFD fd, Shared<Tegra::GPU>& gpu) override;
 
@@ -21,29 +21,18 @@
 namespace Service::Nvidia::Devices {
 
 namespace {
-// Copies count amount of type T from the input vector into the dst vector.
-// Returns the number of bytes written into dst.
+// Reads the element at index of an array of T starting at offset bytes into the buffer
 template <typename T>
-std::size_t SliceVectors(const std::vector<u8>& input, std::vector<T>& dst, std::size_t count,
-                         std::size_t offset) {
-    if (dst.empty()) {
-        return 0;
-    }
-    const size_t bytes_copied = count * sizeof(T);
-    std::memcpy(dst.data(), input.data() + offset, bytes_copied);
-    return bytes_copied;
+T ReadElement(const std::vector<u8>& buffer, std::size_t offset, std::size_t index) {
+    T value;
+    std::memcpy(&value, buffer.data() + offset + index * sizeof(T), sizeof(T));
+    return value;
 }
 
-// Writes the data in src to an offset into the dst vector. The offset is specified in bytes
-// Returns the number of bytes written into dst.
+// Writes value to the element at index of an array of T starting at offset bytes into the buffer
 template <typename T>
-std::size_t WriteVectors(std::vector<u8>& dst, const std::vector<T>& src, std::size_t offset) {
-    if (src.empty()) {
-        return 0;
-    }
-    const size_t bytes_copied = src.size() * sizeof(T);
-    std::memcpy(dst.data() + offset, src.data(), bytes_copied);
-    return bytes_copied;
+void WriteElement(std::vector<u8>& buffer, std::size_t offset, std::size_t index, const T& value) {
+    std::memcpy(buffer.data() + offset + index * sizeof(T), &value, sizeof(T));
 }
 } // Anonymous namespace
 
@@ -66,44 +55,48 @@ NvResult nvhost_nvdec_common::Submit(const std::vector<u8>& input, std::vector<u
     std::memcpy(&params, input.data(), sizeof(IoctlSubmit));
     LOG_DEBUG(Service_NVDRV, "called NVDEC Submit, cmd_buffer_count={}", params.cmd_buffer_count);
 
-    // Instantiate param buffers
-    std::vector<CommandBuffer> command_buffers(params.cmd_buffer_count);
-    std::vector<Reloc> relocs(params.relocation_count);
-    std::vector<u32> reloc_shifts(params.relocation_count);
-    std::vector<SyncptIncr> syncpt_increments(params.syncpoint_count);
-    std::vector<u32> fence_thresholds(params.fence_count);
-
-    // Slice input into their respective buffers
-    std::size_t offset = sizeof(IoctlSubmit);
-    offset += SliceVectors(input, command_buffers, params.cmd_buffer_count, offset);
-    offset += SliceVectors(input, relocs, params.relocation_count, offset);
-    offset += SliceVectors(input, reloc_shifts, params.relocation_count, offset);
-    offset += SliceVectors(input, syncpt_increments, params.syncpoint_count, offset);
-    offset += SliceVectors(input, fence_thresholds, params.fence_count, offset);
+    // The parameter arrays follow the header back to back. They are accessed in place rather than
+    // sliced into vectors, so submitting does not allocate.
+    const std::size_t cmd_buffers_offset = sizeof(IoctlSubmit);
+    const std::size_t relocs_offset =
+        cmd_buffers_offset + std::size_t{params.cmd_buffer_count} * sizeof(CommandBuffer);
+    const std::size_t reloc_shifts_offset =
+        relocs_offset + std::size_t{params.relocation_count} * sizeof(Reloc);
+    const std::size_t syncpt_increments_offset =
+        reloc_shifts_offset + std::size_t{params.relocation_count} * sizeof(u32);
+    const std::size_t fence_thresholds_offset =
+        syncpt_increments_offset + std::size_t{params.syncpoint_count} * sizeof(SyncptIncr);
+    const std::size_t size =
+        fence_thresholds_offset + std::size_t{params.fence_count} * sizeof(u32);
+    if (input.size() < size || output.size() < size) {
+        LOG_ERROR(Service_NVDRV, "Submit parameters do not fit, size={} input={} output={}", size,
+                  input.size(), output.size());
+        return NvResult::InvalidState;
+    }
+
+    // Some games expect command_buffers to be written back
+    std::memcpy(output.data(), input.data(), size);
 
     if (SharedReader(gpu)->UseNvdec()) {
-        for (std::size_t i = 0; i < syncpt_increments.size(); i++) {
-            const SyncptIncr& syncpt_incr = syncpt_increments[i];
-            fence_thresholds[i] =
-                syncpoint_manager.IncreaseSyncpoint(syncpt_incr.id, syncpt_incr.increments);
+        const u32 count = std::min(params.syncpoint_count, params.fence_count);
+        for (u32 i = 0; i < count; i++) {
+            const auto syncpt_incr =
+                ReadElement<SyncptIncr>(input, syncpt_increments_offset, i);
+            WriteElement<u32>(
+                output, fence_thresholds_offset, i,
+                syncpoint_manager.IncreaseSyncpoint(syncpt_incr.id, syncpt_incr.increments));
         }
     }
-    for (const auto& cmd_buffer : command_buffers) {
+    for (u32 i = 0; i < params.cmd_buffer_count; i++) {
+        const auto cmd_buffer = ReadElement<CommandBuffer>(input, cmd_buffers_offset, i);
         const auto object = nvmap_dev->ReadLocked()->GetObject(cmd_buffer.memory_id);
         ASSERT_OR_EXECUTE(object, return NvResult::InvalidState;);
-        Tegra::ChCommandHeaderList cmdlist(cmd_buffer.word_count);
+        // Reuses the capacity of earlier submits
+        cmdlist.resize(cmd_buffer.word_count);
         horizon_servctl_read_buffer(object->addr + cmd_buffer.offset,
                                  cmdlist.data(), cmdlist.size() * sizeof(u32));
         SharedWriter(gpu)->PushCommandBuffer(cmdlist);
     }
-    std::memcpy(output.data(), &params, sizeof(IoctlSubmit));
-    // Some games expect command_buffers to be written back
-    offset = sizeof(IoctlSubmit);
-    offset += WriteVectors(output, command_buffers, offset);
-    offset += WriteVectors(output, relocs, offset);
-    offset += WriteVectors(output, reloc_shifts, offset);
-    offset += WriteVectors(output, syncpt_increments, offset);
-    offset += WriteVectors(output, fence_thresholds, offset);
 
     return NvResult::Success;
 }
@@ -133,15 +126,23 @@ NvResult nvhost_nvdec_common::GetWaitbase(const std::vector<u8>& input, std::vec
 NvResult nvhost_nvdec_common::MapBuffer(const std::vector<u8>& input, std::vector<u8>& output, Shared<Tegra::GPU>& gpu) {
     IoctlMapBuffer params{};
     std::memcpy(&params, input.data(), sizeof(IoctlMapBuffer));
-    std::vector<MapBufferEntry> cmd_buffer_handles(params.num_entries);
 
-    SliceVectors(input, cmd_buffer_handles, params.num_entries, sizeof(IoctlMapBuffer));
+    const std::size_t size =
+        sizeof(IoctlMapBuffer) + std::size_t{params.num_entries} * sizeof(MapBufferEntry);
+    if (input.size() < size || output.size() < size) {
+        LOG_ERROR(Service_NVDRV, "MapBuffer parameters do not fit, size={} input={} output={}",
+                  size, input.size(), output.size());
+        return NvResult::InvalidState;
+    }
+
+    // The entries are updated in place in the output
+    std::memcpy(output.data(), input.data(), size);
 
-    for (auto& cmd_buffer : cmd_buffer_handles) {
+    for (u32 i = 0; i < params.num_entries; i++) {
+        auto cmd_buffer = ReadElement<MapBufferEntry>(output, sizeof(IoctlMapBuffer), i);
         auto object{nvmap_dev->ReadLocked()->GetObject(cmd_buffer.map_handle)};
         if (!object) {
             LOG_ERROR(Service_NVDRV, "invalid cmd_buffer nvmap_handle={:X}", cmd_buffer.map_handle);
-            std::memcpy(output.data(), &params, output.size());
             return NvResult::InvalidState;
         }
         if (object->dma_map_addr == 0) {
@@ -156,11 +157,9 @@ NvResult nvhost_nvdec_common::MapBuffer(const std::vector<u8>& input, std::vecto
             LOG_ERROR(Service_NVDRV, "failed to map size={}", object->size);
         } else {
             cmd_buffer.map_address = object->dma_map_addr;
+            WriteElement(output, sizeof(IoctlMapBuffer), i, cmd_buffer);
         }
     }
-    std::memcpy(output.data(), &params, sizeof(IoctlMapBuffer));
-    std::memcpy(output.data() + sizeof(IoctlMapBuffer), cmd_buffer_handles.data(),
-                cmd_buffer_handles.size() * sizeof(MapBufferEntry));
 
     return NvResult::Success;
 }
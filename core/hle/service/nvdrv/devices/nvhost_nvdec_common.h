@@ -11,6 +11,7 @@
 #include "common/common_types.h"
 #include "common/swap.h"
 #include "core/hle/service/nvdrv/devices/nvdevice.h"
+#include "video_core/cdma_pusher.h"
 
 namespace Service::Nvidia {
 class SyncpointManager;
@@ -119,6 +120,9 @@ protected:
     std::shared_ptr<nvmap> nvmap_dev;
     SyncpointManager& syncpoint_manager;
     std::array<u32, MaxSyncPoints> device_syncpoints{};
+
+    /// Command buffer read from guest memory by the last submit, reused between submits.
+    Tegra::ChCommandHeaderList cmdlist;
 };
 }; // namespace Devices
 } // namespace Service::Nvidia
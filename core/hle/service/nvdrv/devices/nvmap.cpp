@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <cstring>
+#include <iterator>
 
 #include "common/assert.h"
 #include "common/logging/log.h"
@@ -80,11 +81,27 @@ u32 nvmap::CreateObject(u32 size) {
     object->status = Object::Status::Created;
     object->refcount = 1;
 
-    const u32 handle = next_handle++;
+    u32 index;
+    if (!free_slots.empty()) {
+        index = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        ASSERT_MSG(handles.size() <= HANDLE_INDEX_MASK, "Out of nvmap handles");
+        index = static_cast<u32>(handles.size());
+        handles.emplace_back();
+    }
+    handles[index].object = std::move(object);
 
-    handles.insert_or_assign(handle, std::move(object));
+    return MakeHandle(index);
+}
 
-    return handle;
+void nvmap::FreeHandle(u32 handle) {
+    const u32 index = handle & HANDLE_INDEX_MASK;
+    HandleSlot& slot = handles[index];
+    slot.object.reset();
+    // Wrap around within the bits left in the handle
+    slot.generation = (slot.generation + 1) & (~0U >> HANDLE_INDEX_BITS);
+    free_slots.push_back(index);
 }
 
 NvResult nvmap::IocCreate(const std::vector<u8>& input, std::vector<u8>& output) {
@@ -173,23 +190,24 @@ NvResult nvmap::IocFromId(const std::vector<u8>& input, std::vector<u8>& output)
 
     LOG_WARNING(Service_NVDRV, "(STUBBED) called");
 
-    auto itr = std::find_if(handles.begin(), handles.end(),
-                            [&](const auto& entry) { return entry.second->id == params.id; });
+    auto itr = std::find_if(handles.begin(), handles.end(), [&](const HandleSlot& slot) {
+        return slot.object && slot.object->id == params.id;
+    });
     if (itr == handles.end()) {
         LOG_ERROR(Service_NVDRV, "Object does not exist, handle={:08X}", params.handle);
         return NvResult::BadValue;
     }
 
-    auto& object = itr->second;
+    auto& object = itr->object;
     if (object->status != Object::Status::Allocated) {
         LOG_ERROR(Service_NVDRV, "Object is not allocated, handle={:08X}", params.handle);
         return NvResult::BadValue;
     }
 
-    itr->second->refcount++;
+    object->refcount++;
 
     // Return the existing handle instead of creating a new one.
-    params.handle = itr->first;
+    params.handle = MakeHandle(static_cast<u32>(std::distance(handles.begin(), itr)));
 
     std::memcpy(output.data(), &params, sizeof(params));
     return NvResult::Success;
@@ -248,12 +266,12 @@ NvResult nvmap::IocFree(const std::vector<u8>& input, std::vector<u8>& output) {
 
     LOG_WARNING(Service_NVDRV, "(STUBBED) called");
 
-    auto itr = handles.find(params.handle);
-    if (itr == handles.end()) {
+    const auto object = GetObject(params.handle);
+    if (!object) {
         LOG_ERROR(Service_NVDRV, "Object does not exist, handle={:08X}", params.handle);
         return NvResult::BadValue;
     }
-    if (!itr->second->refcount) {
+    if (!object->refcount) {
         LOG_ERROR(
             Service_NVDRV,
             "There is no references to this object. The object is already freed. handle={:08X}",
@@ -261,21 +279,21 @@ NvResult nvmap::IocFree(const std::vector<u8>& input, std::vector<u8>& output) {
         return NvResult::BadValue;
     }
 
-    itr->second->refcount--;
+    object->refcount--;
 
-    params.size = itr->second->size;
+    params.size = object->size;
 
-    if (itr->second->refcount == 0) {
+    if (object->refcount == 0) {
         params.flags = Freed;
         // The address of the nvmap is written to the output if we're finally freeing it, otherwise
         // 0 is written.
-        params.address = itr->second->addr;
+        params.address = object->addr;
     } else {
         params.flags = NotFreedYet;
         params.address = 0;
     }
 
-    handles.erase(params.handle);
+    FreeHandle(params.handle);
 
     std::memcpy(output.data(), &params, sizeof(params));
     return NvResult::Success;
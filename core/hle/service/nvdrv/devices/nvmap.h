@@ -7,7 +7,6 @@
 #pragma once
 
 #include <memory>
-#include <unordered_map>
 #include <vector>
 #include "common/common_funcs.h"
 #include "common/common_types.h"
@@ -49,22 +48,38 @@ public:
     };
 
     std::shared_ptr<Object> GetObject(u32 handle) const {
-        auto itr = handles.find(handle);
-        if (itr != handles.end()) {
-            return itr->second;
+        const u32 index = handle & HANDLE_INDEX_MASK;
+        if (index < handles.size() && handles[index].generation == handle >> HANDLE_INDEX_BITS) {
+            return handles[index].object;
         }
         return {};
     }
 
 private:
-    /// Id to use for the next handle that is created.
-    u32 next_handle = 0;
+    /// Handles are an index into the handle table with the generation of the slot in the upper
+    /// bits, so handles to a freed object are rejected after its slot has been reused.
+    static constexpr u32 HANDLE_INDEX_BITS = 20;
+    static constexpr u32 HANDLE_INDEX_MASK = (1U << HANDLE_INDEX_BITS) - 1;
+
+    struct HandleSlot {
+        u32 generation{};
+        std::shared_ptr<Object> object;
+    };
+
+    u32 MakeHandle(u32 index) const {
+        return handles[index].generation << HANDLE_INDEX_BITS | index;
+    }
+
+    void FreeHandle(u32 handle);
 
     /// Id to use for the next object that is created.
     u32 next_id = 0;
 
-    /// Mapping of currently allocated handles to the objects they represent.
-    std::unordered_map<u32, std::shared_ptr<Object>> handles;
+    /// Objects of currently allocated handles, indexed by handle index.
+    std::vector<HandleSlot> handles;
+
+    /// Indices of the free slots of the handle table.
+    std::vector<u32> free_slots;
 
     struct IocCreateParams {
         // Input
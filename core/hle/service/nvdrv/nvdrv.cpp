@@ -117,6 +117,15 @@ NvResult Module::Ioctl1(DeviceFD fd, Ioctl command, const std::vector<u8>& input
     return itr->second->WriteLocked()->Ioctl1(fd, command, input, output, gpu);
 }
 
+std::shared_ptr<Devices::nvdevice> Module::GetBlockingIoctl1Device(
+    DeviceFD fd, Ioctl command, const std::vector<u8>& input) const {
+    const auto itr = open_files.find(fd);
+    if (itr == open_files.end() || !itr->second->IsBlockingIoctl1(command, input)) {
+        return nullptr;
+    }
+    return itr->second;
+}
+
 NvResult Module::Ioctl2(DeviceFD fd, Ioctl command, const std::vector<u8>& input,
                         const std::vector<u8>& inline_input, std::vector<u8>& output,
                         Shared<Tegra::GPU>& gpu) const {
@@ -123,6 +123,14 @@ public:
     NvResult Ioctl1(DeviceFD fd, Ioctl command, const std::vector<u8>& input,
                     std::vector<u8>& output, Shared<Tegra::GPU>& gpu) const;
 
+    /**
+     * Returns the device of fd if the ioctl1 request may wait for the GPU, nullptr otherwise.
+     * Blocking requests are sent to the device directly, so that neither the module nor the
+     * device stay locked while they wait.
+     */
+    std::shared_ptr<Devices::nvdevice> GetBlockingIoctl1Device(DeviceFD fd, Ioctl command,
+                                                               const std::vector<u8>& input) const;
+
     NvResult Ioctl2(DeviceFD fd, Ioctl command, const std::vector<u8>& input,
                     const std::vector<u8>& inline_input, std::vector<u8>& output,
 		    Shared<Tegra::GPU>& gpu) const;
@@ -8,6 +8,8 @@
 #include "common/logging/log.h"
 #include "core/core.h"
 #include "core/hle/ipc_helpers.h"
+#include "core/hle/service/blocking_worker.h"
+#include "core/hle/service/nvdrv/devices/nvdevice.h"
 #include "core/hle/service/nvdrv/nvdata.h"
 #include "core/hle/service/nvdrv/nvdrv.h"
 #include "core/hle/service/nvdrv/nvdrv_interface.h"
@@ -75,9 +77,26 @@ void NVDRV::Ioctl1(Kernel::HLERequestContext& ctx) {
     }
 
     // Check device
-    std::vector<u8> output_buffer(ctx.GetWriteBufferSize(0));
-    const auto input_buffer = ctx.ReadBuffer(0);
+    const auto& input_buffer = ctx.ReadBufferInArena(0);
+
+    if (auto device = SharedReader(*nvdrv)->GetBlockingIoctl1Device(fd, command, input_buffer)) {
+        // Fence waits go to a worker, other sessions are served meanwhile
+        RunBlocking(ctx, [device = std::move(device), fd, command, input = input_buffer,
+                          &gpu = GPU(ctx.GetRequesterPid())](Kernel::HLERequestContext& ctx) {
+            std::vector<u8> output(ctx.GetWriteBufferSize(0));
+            const auto nv_result = device->Ioctl1(fd, command, input, output, gpu);
+            if (command.is_out != 0) {
+                ctx.WriteBuffer(output);
+            }
+
+            IPC::ResponseBuilder rb{ctx, 3};
+            rb.Push(ResultSuccess);
+            rb.PushEnum(nv_result);
+        });
+        return;
+    }
 
+    std::vector<u8>& output_buffer = ctx.AllocateInArena(ctx.GetWriteBufferSize(0));
     const auto nv_result = SharedReader(*nvdrv)->Ioctl1(fd, command, input_buffer, output_buffer,
                                                         GPU(ctx.GetRequesterPid()));
     if (command.is_out != 0) {
@@ -101,9 +120,9 @@ void NVDRV::Ioctl2(Kernel::HLERequestContext& ctx) {
         return;
     }
 
-    const auto input_buffer = ctx.ReadBuffer(0);
-    const auto input_inlined_buffer = ctx.ReadBuffer(1);
-    std::vector<u8> output_buffer(ctx.GetWriteBufferSize(0));
+    const auto& input_buffer = ctx.ReadBufferInArena(0);
+    const auto& input_inlined_buffer = ctx.ReadBufferInArena(1);
+    std::vector<u8>& output_buffer = ctx.AllocateInArena(ctx.GetWriteBufferSize(0));
 
     const auto nv_result =
         SharedReader(*nvdrv)->Ioctl2(fd, command, input_buffer, input_inlined_buffer, output_buffer,
@@ -129,9 +148,9 @@ void NVDRV::Ioctl3(Kernel::HLERequestContext& ctx) {
         return;
     }
 
-    const auto input_buffer = ctx.ReadBuffer(0);
-    std::vector<u8> output_buffer(ctx.GetWriteBufferSize(0));
-    std::vector<u8> output_buffer_inline(ctx.GetWriteBufferSize(1));
+    const auto& input_buffer = ctx.ReadBufferInArena(0);
+    std::vector<u8>& output_buffer = ctx.AllocateInArena(ctx.GetWriteBufferSize(0));
+    std::vector<u8>& output_buffer_inline = ctx.AllocateInArena(ctx.GetWriteBufferSize(1));
 
     const auto nv_result =
         SharedReader(*nvdrv)->Ioctl3(fd, command, input_buffer, output_buffer, output_buffer_inline,
@@ -5,34 +5,38 @@
 // Adapted by Kent Hall for mizu on Horizon Linux.
 
 #include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 #include "common/assert.h"
 #include "common/logging/log.h"
 #include "core/core.h"
 #include "core/hle/service/kernel_helpers.h"
 #include "core/hle/service/nvflinger/buffer_queue.h"
+#include "core/hle/service/service.h"
 
 namespace Service::NVFlinger {
 
 BufferQueue::BufferQueue(u32 id_, u64 layer_id_)
     : id(id_), layer_id(layer_id_) {
     buffer_wait_event = KernelHelpers::CreateEvent("BufferQueue:WaitEvent");
+    free_buffer_event = ::eventfd(0, EFD_CLOEXEC);
+    if (free_buffer_event == -1) {
+        LOG_CRITICAL(Service, "eventfd failed: {}", ::strerror(errno));
+    }
 }
 
 BufferQueue::~BufferQueue() {
     KernelHelpers::CloseEvent(buffer_wait_event);
+    ::close(free_buffer_event);
 }
 
 void BufferQueue::SetPreallocatedBuffer(u32 slot, const IGBPBuffer& igbp_buffer) {
     ASSERT(slot < buffer_slots);
     LOG_WARNING(Service, "Adding graphics buffer {}", slot);
 
-    {
-        std::unique_lock lock{free_buffers_mutex};
-        free_buffers.push_back(slot);
-    }
-    free_buffers_condition.notify_one();
-
     buffers[slot] = {
         .slot = slot,
         .status = Buffer::Status::Free,
@@ -41,17 +45,32 @@ void BufferQueue::SetPreallocatedBuffer(u32 slot, const IGBPBuffer& igbp_buffer)
         .crop_rect = {},
         .swap_interval = 0,
         .multi_fence = {},
+        .queue_time = {},
     };
 
+    free_buffers.Push(slot);
+    SignalFreeBuffer();
+
     KernelHelpers::SignalEvent(buffer_wait_event);
 }
 
 std::optional<std::pair<u32, Service::Nvidia::MultiFence*>> BufferQueue::DequeueBuffer(u32 width,
                                                                                        u32 height) {
     // Wait for first request before trying to dequeue
-    {
-        std::unique_lock lock{free_buffers_mutex};
-        free_buffers_condition.wait(lock, [this] { return !free_buffers.empty() || !is_connect; });
+    if (!HasFreeBuffer()) {
+        // Registering first means that either SignalFreeBuffer sees the waiter, or the waiter sees
+        // the free buffer
+        ++num_free_waiters;
+        while (!HasFreeBuffer()) {
+            eventfd_t count;
+            if (::eventfd_read(free_buffer_event, &count) == -1 && errno != EINTR) {
+                LOG_CRITICAL(Service, "eventfd_read failed: {}", ::strerror(errno));
+                break;
+            }
+        }
+        --num_free_waiters;
+        // Reading the event woke this waiter only, pass it on to any other
+        SignalFreeBuffer();
     }
 
     if (!is_connect) {
@@ -60,26 +79,29 @@ std::optional<std::pair<u32, Service::Nvidia::MultiFence*>> BufferQueue::Dequeue
         return std::nullopt;
     }
 
-    std::unique_lock lock{free_buffers_mutex};
+    const auto slot = free_buffers.Pop([this, width, height](u32 free_slot) {
+        const Buffer& buffer = buffers[free_slot];
+        return buffer.status == Buffer::Status::Free && buffer.igbp_buffer.width == width &&
+               buffer.igbp_buffer.height == height;
+    });
+    if (!slot) {
+        return std::nullopt;
+    }
+    buffers[*slot].status = Buffer::Status::Dequeued;
+    return {{buffers[*slot].slot, &buffers[*slot].multi_fence}};
+}
 
-    auto f_itr = free_buffers.begin();
-    auto slot = buffers.size();
+bool BufferQueue::HasFreeBuffer() {
+    return !free_buffers.IsEmpty() || !is_connect;
+}
 
-    while (f_itr != free_buffers.end()) {
-        const Buffer& buffer = buffers[*f_itr];
-        if (buffer.status == Buffer::Status::Free && buffer.igbp_buffer.width == width &&
-            buffer.igbp_buffer.height == height) {
-            slot = *f_itr;
-            free_buffers.erase(f_itr);
-            break;
-        }
-        ++f_itr;
+void BufferQueue::SignalFreeBuffer() {
+    if (num_free_waiters.load() == 0) {
+        return;
     }
-    if (slot == buffers.size()) {
-        return std::nullopt;
+    if (::eventfd_write(free_buffer_event, 1) == -1) {
+        LOG_CRITICAL(Service, "eventfd_write failed: {}", ::strerror(errno));
     }
-    buffers[slot].status = Buffer::Status::Dequeued;
-    return {{buffers[slot].slot, &buffers[slot].multi_fence}};
 }
 
 const IGBPBuffer& BufferQueue::RequestBuffer(u32 slot) const {
@@ -102,8 +124,8 @@ void BufferQueue::QueueBuffer(u32 slot, BufferTransformFlags transform,
     buffers[slot].crop_rect = crop_rect;
     buffers[slot].swap_interval = swap_interval;
     buffers[slot].multi_fence = multi_fence;
-    std::unique_lock lock{queue_sequence_mutex};
-    queue_sequence.push_back(slot);
+    buffers[slot].queue_time = GetGlobalTimeNs();
+    queue_sequence.Push(slot);
 }
 
 void BufferQueue::CancelBuffer(u32 slot, const Service::Nvidia::MultiFence& multi_fence) {
@@ -111,37 +133,26 @@ void BufferQueue::CancelBuffer(u32 slot, const Service::Nvidia::MultiFence& mult
     ASSERT(buffers[slot].status != Buffer::Status::Free);
     ASSERT(buffers[slot].slot == slot);
 
+    queue_sequence.Remove(slot);
     buffers[slot].status = Buffer::Status::Free;
     buffers[slot].multi_fence = multi_fence;
     buffers[slot].swap_interval = 0;
 
-    {
-        std::unique_lock lock{free_buffers_mutex};
-        free_buffers.push_back(slot);
-    }
-    free_buffers_condition.notify_one();
+    free_buffers.Push(slot);
+    SignalFreeBuffer();
 
     KernelHelpers::SignalEvent(buffer_wait_event);
 }
 
 std::optional<std::reference_wrapper<const BufferQueue::Buffer>> BufferQueue::AcquireBuffer() {
-    std::unique_lock lock{queue_sequence_mutex};
-    std::size_t buffer_slot = buffers.size();
-    // Iterate to find a queued buffer matching the requested slot.
-    while (buffer_slot == buffers.size() && !queue_sequence.empty()) {
-        const auto slot = static_cast<std::size_t>(queue_sequence.front());
-        ASSERT(slot < buffers.size());
-        if (buffers[slot].status == Buffer::Status::Queued) {
-            ASSERT(buffers[slot].slot == slot);
-            buffer_slot = slot;
-        }
-        queue_sequence.pop_front();
-    }
-    if (buffer_slot == buffers.size()) {
+    const auto slot = queue_sequence.Pop(
+        [this](u32 queued_slot) { return buffers[queued_slot].status == Buffer::Status::Queued; });
+    if (!slot) {
         return std::nullopt;
     }
-    buffers[buffer_slot].status = Buffer::Status::Acquired;
-    return {{buffers[buffer_slot]}};
+    ASSERT(buffers[*slot].slot == *slot);
+    buffers[*slot].status = Buffer::Status::Acquired;
+    return {{buffers[*slot]}};
 }
 
 void BufferQueue::ReleaseBuffer(u32 slot) {
@@ -150,30 +161,25 @@ void BufferQueue::ReleaseBuffer(u32 slot) {
     ASSERT(buffers[slot].slot == slot);
 
     buffers[slot].status = Buffer::Status::Free;
-    {
-        std::unique_lock lock{free_buffers_mutex};
-        free_buffers.push_back(slot);
-    }
-    free_buffers_condition.notify_one();
+    free_buffers.Push(slot);
+    SignalFreeBuffer();
 
     KernelHelpers::SignalEvent(buffer_wait_event);
 }
 
 void BufferQueue::Connect() {
-    std::unique_lock lock{queue_sequence_mutex};
-    queue_sequence.clear();
+    queue_sequence.Clear();
     is_connect = true;
 }
 
 void BufferQueue::Disconnect() {
+    // The buffers are gone until they are set again, so none of them is free either
+    free_buffers.Clear();
+    queue_sequence.Clear();
     buffers.fill({});
-    {
-        std::unique_lock lock{queue_sequence_mutex};
-        queue_sequence.clear();
-    }
     KernelHelpers::SignalEvent(buffer_wait_event);
     is_connect = false;
-    free_buffers_condition.notify_one();
+    SignalFreeBuffer();
 }
 
 u32 BufferQueue::Query(QueryType type) {
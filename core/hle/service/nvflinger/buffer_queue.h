@@ -6,10 +6,13 @@
 
 #pragma once
 
-#include <condition_variable>
-#include <list>
-#include <mutex>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <functional>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "common/common_funcs.h"
@@ -45,6 +48,69 @@ struct IGBPBuffer {
 
 static_assert(sizeof(IGBPBuffer) == 0x16C, "IGBPBuffer has wrong size");
 
+/**
+ * FIFO of buffer slots that takes no locks and never allocates. A slot is in the queue at most once,
+ * so one bit of a mask says whether it is, and a sequence number stamped when it is pushed orders
+ * it. Any thread may push and pop.
+ */
+class SlotQueue {
+public:
+    static_assert(buffer_slots <= 64, "Slots must fit in the mask");
+
+    void Push(u32 slot) {
+        sequences[slot].store(next_sequence.fetch_add(1, std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+        // Publishes the sequence and whatever was written to the buffer before
+        queued.fetch_or(u64{1} << slot);
+    }
+
+    /// Removes the slot pushed first among those accepted by pred
+    template <typename Pred>
+    std::optional<u32> Pop(Pred&& pred) {
+        u64 current = queued.load(std::memory_order_acquire);
+        while (current != 0) {
+            u32 oldest = buffer_slots;
+            u64 oldest_sequence = 0;
+            for (u64 remaining = current; remaining != 0; remaining &= remaining - 1) {
+                const u32 slot = static_cast<u32>(std::countr_zero(remaining));
+                const u64 sequence = sequences[slot].load(std::memory_order_relaxed);
+                if ((oldest == buffer_slots || sequence < oldest_sequence) && pred(slot)) {
+                    oldest = slot;
+                    oldest_sequence = sequence;
+                }
+            }
+            if (oldest == buffer_slots) {
+                return std::nullopt;
+            }
+            const u64 bit = u64{1} << oldest;
+            if ((queued.fetch_and(~bit, std::memory_order_acq_rel) & bit) != 0) {
+                return oldest;
+            }
+            // Another thread took it first
+            current = queued.load(std::memory_order_acquire);
+        }
+        return std::nullopt;
+    }
+
+    /// Removes the slot if it is in the queue
+    void Remove(u32 slot) {
+        queued.fetch_and(~(u64{1} << slot), std::memory_order_acq_rel);
+    }
+
+    bool IsEmpty() const {
+        return queued.load() == 0;
+    }
+
+    void Clear() {
+        queued.store(0, std::memory_order_release);
+    }
+
+private:
+    std::atomic<u64> queued{};
+    std::array<std::atomic<u64>, buffer_slots> sequences{};
+    std::atomic<u64> next_sequence{};
+};
+
 class BufferQueue final {
 public:
     enum class QueryType {
@@ -91,11 +157,15 @@ public:
         Common::Rectangle<int> crop_rect;
         u32 swap_interval;
         Service::Nvidia::MultiFence multi_fence;
+        /// When the buffer was queued, for present latency statistics
+        std::chrono::nanoseconds queue_time;
     };
 
     void SetPreallocatedBuffer(u32 slot, const IGBPBuffer& igbp_buffer);
     std::optional<std::pair<u32, Service::Nvidia::MultiFence*>> DequeueBuffer(u32 width,
                                                                               u32 height);
+    /// Returns true if DequeueBuffer would not wait for a buffer to be released
+    bool HasFreeBuffer();
     const IGBPBuffer& RequestBuffer(u32 slot) const;
     void QueueBuffer(u32 slot, BufferTransformFlags transform,
                      const Common::Rectangle<int>& crop_rect, u32 swap_interval,
@@ -122,19 +192,21 @@ public:
 private:
     BufferQueue(const BufferQueue&) = delete;
 
+    /// Wakes up DequeueBuffer when there may be a free buffer or the queue was disconnected
+    void SignalFreeBuffer();
+
     u32 id{};
     u64 layer_id{};
     std::atomic_bool is_connect{};
 
-    std::list<u32> free_buffers;
+    SlotQueue free_buffers;
     std::array<Buffer, buffer_slots> buffers;
-    std::list<u32> queue_sequence;
+    SlotQueue queue_sequence;
     int buffer_wait_event{};
 
-    std::mutex free_buffers_mutex;
-    std::condition_variable free_buffers_condition;
-
-    std::mutex queue_sequence_mutex;
+    /// Blocking eventfd DequeueBuffer waits on, only written while num_free_waiters is not 0
+    int free_buffer_event{-1};
+    std::atomic<u32> num_free_waiters{};
 };
 
 } // namespace Service::NVFlinger
@@ -5,7 +5,11 @@
 // Adapted by Kent Hall for mizu on Horizon Linux.
 
 #include <algorithm>
+#include <cerrno>
+#include <cstdlib>
 #include <optional>
+#include <vector>
+#include <time.h>
 
 #include "common/assert.h"
 #include "common/logging/log.h"
@@ -26,6 +30,57 @@ namespace Service::NVFlinger {
 
 constexpr auto frame_ns = std::chrono::nanoseconds{1000000000 / 60};
 
+namespace {
+/// Vsyncs covered by each frame pacing report
+constexpr std::size_t PACING_REPORT_FRAMES = 600;
+
+/// Largest difference to a multiple of the host refresh period that vsync is aligned across
+constexpr double HOST_ALIGN_TOLERANCE = 0.05;
+
+/// Deadline misses and wakeup lateness of the vsync thread, reported every PACING_REPORT_FRAMES
+class PacingStats {
+public:
+    PacingStats() {
+        latenesses.reserve(PACING_REPORT_FRAMES);
+    }
+
+    void Record(std::chrono::nanoseconds lateness, u64 missed, std::chrono::nanoseconds period) {
+        latenesses.push_back(lateness.count());
+        num_missed += missed;
+        if (latenesses.size() == PACING_REPORT_FRAMES) {
+            Report(period);
+        }
+    }
+
+private:
+    void Report(std::chrono::nanoseconds period) {
+        std::sort(latenesses.begin(), latenesses.end());
+        const auto percentile = [this](std::size_t percent) {
+            return latenesses[(latenesses.size() - 1) * percent / 100] / 1000;
+        };
+        LOG_DEBUG(Service_VI,
+                  "VSync every {} us: {} deadlines missed over {} vsyncs, wakeup lateness p50 {} us "
+                  "p90 {} us p99 {} us max {} us",
+                  period.count() / 1000, num_missed, latenesses.size(), percentile(50),
+                  percentile(90), percentile(99), latenesses.back() / 1000);
+        latenesses.clear();
+        num_missed = 0;
+    }
+
+    std::vector<s64> latenesses;
+    u64 num_missed = 0;
+};
+
+void SleepUntil(std::chrono::nanoseconds deadline) {
+    const ::timespec ts{
+        .tv_sec = static_cast<time_t>(deadline.count() / 1000000000),
+        .tv_nsec = static_cast<long>(deadline.count() % 1000000000),
+    };
+    while (::clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+} // Anonymous namespace
+
 void NVFlinger::SplitVSync(std::stop_token stop_token) {
     std::string name = "mizu:VSyncThread";
     MicroProfileOnThreadCreate(name.c_str());
@@ -35,20 +90,28 @@ void NVFlinger::SplitVSync(std::stop_token stop_token) {
 
     Common::SetCurrentThreadName(name.c_str());
     Common::SetCurrentThreadPriority(Common::ThreadPriority::High);
-    s64 delay = 0;
+
+    // Vsyncs are scheduled at absolute deadlines on the clock of GetGlobalTimeNs, so the time
+    // spent composing and oversleeping does not add up over frames
+    PacingStats pacing;
+    auto deadline = GetGlobalTimeNs();
     while (!stop_token.stop_requested()) {
-        guard->lock();
-        const s64 time_start = GetGlobalTimeNs().count();
-        Compose();
-        const auto ticks = GetNextTicks();
-        const s64 time_end = GetGlobalTimeNs().count();
-        const s64 time_passed = time_end - time_start;
-        const s64 next_time = std::max<s64>(0, ticks - time_passed - delay);
-        guard->unlock();
-        if (next_time > 0) {
-            std::this_thread::sleep_for(std::chrono::nanoseconds{next_time});
+        std::chrono::nanoseconds period;
+        {
+            const auto lock_guard = Lock();
+            Compose();
+            period = AlignToHostRefresh(std::chrono::nanoseconds{GetNextTicks()});
         }
-        delay = (GetGlobalTimeNs().count() - time_end) - next_time;
+        deadline += period;
+
+        // Vsyncs missed while composing are dropped rather than signalled back to back
+        s64 missed = 0;
+        if (const auto now = GetGlobalTimeNs(); now >= deadline) {
+            missed = (now - deadline) / period + 1;
+            deadline += missed * period;
+        }
+        SleepUntil(deadline);
+        pacing.Record(GetGlobalTimeNs() - deadline, static_cast<u64>(missed), period);
     }
 }
 
@@ -251,48 +314,85 @@ void NVFlinger::Compose() {
         // Trigger vsync for this display at the end of drawing
         SCOPE_EXIT({ display.SignalVSyncEvent(); });
 
-        // Don't do anything for displays without layers.
-        if (!display.HasLayers())
-            continue;
+        for (const auto& layer : display.GetLayers()) {
+            ComposeLayer(*layer);
+        }
+    }
+}
 
-        // TODO(Subv): Support more than 1 layer.
-        std::shared_ptr<VI::Layer> layer = display.GetLayer(0);
-        auto& buffer_queue = layer->GetBufferQueue();
+void NVFlinger::ComposeLayer(VI::Layer& layer) {
+    auto& buffer_queue = layer.GetBufferQueue();
 
+    // A buffer the GPU was not done with at the last composition goes first
+    const BufferQueue::Buffer* buffer = layer.GetPendingBuffer();
+    if (!buffer) {
         // Search for a queued buffer and acquire it
-        auto buffer = buffer_queue.AcquireBuffer();
+        const auto acquired = buffer_queue.AcquireBuffer();
+        if (!acquired) {
+            return;
+        }
+        buffer = &acquired->get();
+    }
 
-        if (!buffer) {
-            continue;
+    auto& gpu = layer.GPU();
+    auto& stats = layer.GetPresentStats();
+
+    // Waiting for the fences here would hold up the other layers and the vsync events of all
+    // displays, so the buffer is left for a later composition instead
+    const auto& multi_fence = buffer->multi_fence;
+    for (u32 fence_id = 0; fence_id < multi_fence.num_fences; fence_id++) {
+        const auto& fence = multi_fence.fences[fence_id];
+        if (!SharedUnlocked(gpu)->IsFenceSignalled(fence.id, fence.value)) {
+            layer.SetPendingBuffer(buffer);
+            ++stats.num_not_ready;
+            return;
         }
+    }
+    layer.SetPendingBuffer(nullptr);
 
-        const auto& igbp_buffer = buffer->get().igbp_buffer;
+    MicroProfileFlip();
 
-        // gpu is kept alive by layer's shared_ptr reference
-        auto& gpu = layer->GPU();
-        const auto& multi_fence = buffer->get().multi_fence;
-        guard->unlock();
-        for (u32 fence_id = 0; fence_id < multi_fence.num_fences; fence_id++) {
-            const auto& fence = multi_fence.fences[fence_id];
-            SharedUnlocked(gpu)->WaitFence(fence.id, fence.value);
-        }
-        guard->lock();
+    // Now send the buffer to the GPU for drawing.
+    // TODO(Subv): Support more than just disp0. The display device selection is probably based
+    // on which display we're drawing (Default, Internal, External, etc)
+    auto nvdisp = SharedReader(*nvdrv)->GetDevice<Nvidia::Devices::nvdisp_disp0>("/dev/nvdisp_disp0");
+    ASSERT(nvdisp);
 
-        MicroProfileFlip();
+    const auto& igbp_buffer = buffer->igbp_buffer;
+    nvdisp->WriteLocked()->flip(igbp_buffer.gpu_buffer_id, igbp_buffer.offset, igbp_buffer.external_format,
+                                igbp_buffer.width, igbp_buffer.height, igbp_buffer.stride,
+                                buffer->transform, buffer->crop_rect, gpu);
 
-        // Now send the buffer to the GPU for drawing.
-        // TODO(Subv): Support more than just disp0. The display device selection is probably based
-        // on which display we're drawing (Default, Internal, External, etc)
-        auto nvdisp = SharedReader(*nvdrv)->GetDevice<Nvidia::Devices::nvdisp_disp0>("/dev/nvdisp_disp0");
-        ASSERT(nvdisp);
+    const auto latency = GetGlobalTimeNs() - buffer->queue_time;
+    ++stats.num_presented;
+    stats.total_latency += latency;
+    stats.max_latency = std::max(stats.max_latency, latency);
 
-        nvdisp->WriteLocked()->flip(igbp_buffer.gpu_buffer_id, igbp_buffer.offset, igbp_buffer.external_format,
-                                    igbp_buffer.width, igbp_buffer.height, igbp_buffer.stride,
-                                    buffer->get().transform, buffer->get().crop_rect, gpu);
+    swap_interval = buffer->swap_interval;
+    buffer_queue.ReleaseBuffer(buffer->slot);
+}
 
-        swap_interval = buffer->get().swap_interval;
-        buffer_queue.ReleaseBuffer(buffer->get().slot);
+void NVFlinger::SetHostRefreshRate(double refresh_rate) {
+    const auto lock_guard = Lock();
+    if (refresh_rate <= 0) {
+        host_refresh_period = {};
+        return;
+    }
+    host_refresh_period = std::chrono::nanoseconds{static_cast<s64>(1000000000 / refresh_rate)};
+    LOG_INFO(Service_VI, "Host display refreshes every {} us", host_refresh_period.count() / 1000);
+}
+
+std::chrono::nanoseconds NVFlinger::AlignToHostRefresh(std::chrono::nanoseconds period) const {
+    if (!Settings::values.align_vsync_to_host.GetValue() || host_refresh_period.count() == 0) {
+        return period;
+    }
+    const auto num_refreshes = std::max<s64>(
+        1, (period + host_refresh_period / 2) / host_refresh_period);
+    const auto aligned = num_refreshes * host_refresh_period;
+    if (std::abs((aligned - period).count()) > period.count() * HOST_ALIGN_TOLERANCE) {
+        return period;
     }
+    return aligned;
 }
 
 s64 NVFlinger::GetNextTicks() const {
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -73,6 +74,10 @@ public:
 
     [[nodiscard]] s64 GetNextTicks() const;
 
+    /// Sets the refresh rate of the host display, which vsync is aligned to when
+    /// align_vsync_to_host is set.
+    void SetHostRefreshRate(double refresh_rate);
+
 private:
     [[nodiscard]] std::unique_lock<std::mutex> Lock() const {
         return std::unique_lock{*guard};
@@ -98,6 +103,13 @@ private:
     /// Creates a layer with the specified layer ID in the desired display.
     void CreateLayerAtId(VI::Display& display, u64 layer_id, ::pid_t pid);
 
+    /// Presents the next buffer of the layer if the GPU is done with it, without waiting for it.
+    void ComposeLayer(VI::Layer& layer);
+
+    /// Rounds the time to the next vsync to a multiple of the host refresh period when close to
+    /// one, so that frames do not drift against the host display and judder.
+    [[nodiscard]] std::chrono::nanoseconds AlignToHostRefresh(std::chrono::nanoseconds period) const;
+
     void SplitVSync(std::stop_token stop_token);
 
     std::shared_ptr<Shared<Nvidia::Module>> nvdrv;
@@ -113,6 +125,9 @@ private:
 
     u32 swap_interval = 1;
 
+    /// Refresh period of the host display, zero when unknown.
+    std::chrono::nanoseconds host_refresh_period{};
+
     /// Event that handles screen composition.
     ::timer_t composition_event;
 
@@ -17,6 +17,7 @@
 #include "core/hle/ipc.h"
 #include "core/hle/ipc_helpers.h"
 #include "core/hle/kernel/svc_results.h"
+#include "core/hle/service/ipc_trace.h"
 #include "core/hle/service/acc/acc.h"
 #include "core/hle/service/am/am.h"
 #include "core/hle/service/am/applets/applets.h"
@@ -127,6 +128,7 @@ void ServiceFrameworkBase::RegisterHandlersBase(const FunctionInfoBase* function
         // Usually this array is sorted by id already, so hint to insert at the end
         handlers.emplace_hint(handlers.cend(), functions[i].expected_header, functions[i]);
     }
+    BuildDispatchTable(handlers, dispatch_table);
 }
 
 void ServiceFrameworkBase::RegisterHandlersBaseTipc(const FunctionInfoBase* functions,
@@ -137,6 +139,26 @@ void ServiceFrameworkBase::RegisterHandlersBaseTipc(const FunctionInfoBase* func
         handlers_tipc.emplace_hint(handlers_tipc.cend(), functions[i].expected_header,
                                    functions[i]);
     }
+    BuildDispatchTable(handlers_tipc, dispatch_table_tipc);
+}
+
+void ServiceFrameworkBase::BuildDispatchTable(const HandlerMap& map, std::vector<u16>& table) {
+    // Ids above are rare and far apart, those are still looked up in the map
+    const auto end = map.lower_bound(MAX_DENSE_COMMAND_ID);
+    table.assign(end == map.begin() ? 0 : std::prev(end)->first + 1, 0);
+    for (auto it = map.begin(); it != end; ++it) {
+        table[it->first] = static_cast<u16>(std::distance(map.begin(), it) + 1);
+    }
+}
+
+const ServiceFrameworkBase::FunctionInfoBase* ServiceFrameworkBase::FindHandler(
+    const HandlerMap& map, const std::vector<u16>& table, u32 command) {
+    if (command < MAX_DENSE_COMMAND_ID) {
+        const u16 index = command < table.size() ? table[command] : 0;
+        return index == 0 ? nullptr : &map.nth(index - 1)->second;
+    }
+    const auto it = map.find(command);
+    return it == map.end() ? nullptr : &it->second;
 }
 
 void ServiceFrameworkBase::ReportUnimplementedFunction(Kernel::HLERequestContext& ctx,
@@ -161,8 +183,7 @@ void ServiceFrameworkBase::ReportUnimplementedFunction(Kernel::HLERequestContext
 }
 
 void ServiceFrameworkBase::InvokeRequest(Kernel::HLERequestContext& ctx) {
-    auto itr = handlers.find(ctx.GetCommand());
-    const FunctionInfoBase* info = itr == handlers.end() ? nullptr : &itr->second;
+    const FunctionInfoBase* info = FindHandler(handlers, dispatch_table, ctx.GetCommand());
     if (info == nullptr || info->handler_callback == nullptr) {
         return ReportUnimplementedFunction(ctx, info);
     }
@@ -173,11 +194,8 @@ void ServiceFrameworkBase::InvokeRequest(Kernel::HLERequestContext& ctx) {
 }
 
 void ServiceFrameworkBase::InvokeRequestTipc(Kernel::HLERequestContext& ctx) {
-    boost::container::flat_map<u32, FunctionInfoBase>::iterator itr;
-
-    itr = handlers_tipc.find(ctx.GetCommand());
-
-    const FunctionInfoBase* info = itr == handlers_tipc.end() ? nullptr : &itr->second;
+    const FunctionInfoBase* info =
+        FindHandler(handlers_tipc, dispatch_table_tipc, ctx.GetCommand());
     if (info == nullptr || info->handler_callback == nullptr) {
         return ReportUnimplementedFunction(ctx, info);
     }
@@ -186,9 +204,25 @@ void ServiceFrameworkBase::InvokeRequestTipc(Kernel::HLERequestContext& ctx) {
     handler_invoker(this, info->handler_callback, ctx);
 }
 
+void ServiceFrameworkBase::RegisterWithIPCTrace() {
+    std::vector<IPCTrace::CommandName> commands;
+    commands.reserve(handlers.size() + handlers_tipc.size());
+    for (const auto& [command_id, info] : handlers) {
+        commands.push_back({command_id, false, info.name});
+    }
+    for (const auto& [command_id, info] : handlers_tipc) {
+        commands.push_back({command_id, true, info.name});
+    }
+    ipc_trace_id = IPCTrace::RegisterService(service_name, commands);
+}
+
 ResultCode ServiceFrameworkBase::HandleSyncRequest(Kernel::HLERequestContext& ctx) {
     const auto guard = LockService();
 
+    const bool is_traced = IPCTrace::IsEnabled();
+    const auto start = is_traced ? std::chrono::steady_clock::now()
+                                 : std::chrono::steady_clock::time_point{};
+
     switch (ctx.GetCommandType()) {
     /*
      * Close/Control commands should be handled in the kernel.
@@ -212,7 +246,16 @@ ResultCode ServiceFrameworkBase::HandleSyncRequest(Kernel::HLERequestContext& ct
         UNIMPLEMENTED_MSG("command_type={}", ctx.GetCommandType());
     }
 
-    ctx.WriteToOutgoingCommandBuffer();
+    if (is_traced) {
+        if (!ipc_trace_id) [[unlikely]] {
+            RegisterWithIPCTrace();
+        }
+        IPCTrace::Record(*ipc_trace_id, ctx, start);
+    }
+
+    if (!ctx.IsDeferred()) {
+        ctx.WriteToOutgoingCommandBuffer();
+    }
 
     return ResultSuccess;
 }
@@ -235,6 +278,9 @@ void StartServices() {
         ::exit(1);
     }
 
+    // Before any service thread starts handling requests
+    IPCTrace::Initialize();
+
     Account::InstallInterfaces();
     AM::InstallInterfaces();
     AOC::InstallInterfaces();
@@ -294,10 +340,11 @@ void StartServices() {
     for (;;) {
         unsigned long session_id;
 
-        long cmdptr = horizon_servctl(HZN_SCTL_GET_CMD, &session_id);
+        long cmdptr = Kernel::DeferredReplies::SendReadyAndReceive(&session_id);
         if (cmdptr == -1) {
             ResultCode rc(errno);
-            if (rc == Kernel::ResultCancelled) // this means EINTR
+            // EINTR, e.g. when a deferred reply is ready to be sent
+            if (rc == Kernel::ResultCancelled || errno == EINTR)
                 continue;
             LOG_CRITICAL(Service, "Unexpected error on HZN_SCTL_GET_CMD: {}", rc.description.Value());
 	    ::exit(1);
@@ -379,13 +426,16 @@ out:
             context.convert_to_domain = false;
         }
 
-        if (horizon_servctl(HZN_SCTL_PUT_CMD, session_id, (long)context.IsDomain()) == -1) {
+        // Deferred requests are replied to later, by this thread once their handler is done
+        if (!context.IsDeferred() &&
+            horizon_servctl(HZN_SCTL_PUT_CMD, session_id, (long)context.IsDomain()) == -1) {
             // Just give up on the new session if this fails
             if (new_session) {
                 session_managers.erase(FindSessionManager(session_id));
             }
             LOG_ERROR(Service, "HZN_SCTL_PUT_CMD failed: {}", ResultCode(errno).description.Value());
         }
+        Kernel::RequestArena::Reset();
     }
 }
 
@@ -9,10 +9,12 @@
 #include <cstddef>
 #include <mutex>
 #include <shared_mutex>
+#include <optional>
 #include <string>
 #include <unordered_set>
 #include <thread>
 #include <chrono>
+#include <vector>
 #include <boost/container/flat_map.hpp>
 #include <unistd.h>
 #include <sys/syscall.h>
@@ -219,6 +221,14 @@ inline void PutGPU(::pid_t req_pid) {
         return;
     }
     if (--it->second.refcount == 0) {
+#ifndef VIDEO_CORE_COMPAT
+        const auto usage = SharedUnlocked(it->second.gpu)->MemoryUsage();
+        LOG_INFO(HW_GPU,
+                 "GPU instance for {} used {} KiB to track guest memory (buffer page table {} KiB, "
+                 "texture page tables {} KiB, cached pages {} KiB)",
+                 req_pid, usage.Total() / 1024, usage.buffer_page_table / 1024,
+                 usage.texture_page_tables / 1024, usage.cached_pages / 1024);
+#endif
         gpus_locked->erase(it);
     }
 }
@@ -324,9 +334,18 @@ private:
                                   u32 max_sessions_, InvokerFn* handler_invoker_);
     ~ServiceFrameworkBase();
 
+    using HandlerMap = boost::container::flat_map<u32, FunctionInfoBase>;
+
+    /// Command ids below this are dispatched through a table indexed by command id
+    static constexpr u32 MAX_DENSE_COMMAND_ID = 0x1000;
+
     void RegisterHandlersBase(const FunctionInfoBase* functions, std::size_t n);
     void RegisterHandlersBaseTipc(const FunctionInfoBase* functions, std::size_t n);
+    static void BuildDispatchTable(const HandlerMap& map, std::vector<u16>& table);
+    static const FunctionInfoBase* FindHandler(const HandlerMap& map,
+                                               const std::vector<u16>& table, u32 command);
     void ReportUnimplementedFunction(Kernel::HLERequestContext& ctx, const FunctionInfoBase* info);
+    void RegisterWithIPCTrace();
 
     /// Maximum number of concurrent sessions that this service can handle.
     u32 max_sessions;
@@ -337,11 +356,19 @@ private:
 
     /// Function used to safely up-cast pointers to the derived class before invoking a handler.
     InvokerFn* handler_invoker;
-    boost::container::flat_map<u32, FunctionInfoBase> handlers;
-    boost::container::flat_map<u32, FunctionInfoBase> handlers_tipc;
+    HandlerMap handlers;
+    HandlerMap handlers_tipc;
+
+    /// Position in the handler map plus one for each command id up to the largest registered id
+    /// below MAX_DENSE_COMMAND_ID, 0 for ids without a handler
+    std::vector<u16> dispatch_table;
+    std::vector<u16> dispatch_table_tipc;
 
     /// Used to gain exclusive access to the service members, e.g. from CoreTiming thread.
     Common::SpinLock lock_service;
+
+    /// Id of the service in the IPC trace, assigned on its first traced request
+    std::optional<u16> ipc_trace_id;
 };
 
 /**
@@ -6,6 +6,7 @@
 
 #include <array>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -15,6 +16,7 @@
 #include "common/microprofile.h"
 #include "common/thread.h"
 #include "core/hle/ipc_helpers.h"
+#include "core/hle/service/blocking_worker.h"
 #include "core/hle/service/sockets/bsd.h"
 #include "core/hle/service/sockets/sockets_translate.h"
 #include "core/network/network.h"
@@ -38,6 +40,10 @@ bool IsConnectionBased(Type type) {
 
 } // Anonymous namespace
 
+bool BSD::PollWork::IsBlocking(const BSD* bsd) const {
+    return timeout != 0;
+}
+
 void BSD::PollWork::Execute(BSD* bsd) {
     std::tie(ret, bsd_errno) = bsd->PollImpl(write_buffer, read_buffer, nfds, timeout);
 }
@@ -80,6 +86,10 @@ void BSD::ConnectWork::Response(Kernel::HLERequestContext& ctx) {
     rb.PushEnum(bsd_errno);
 }
 
+bool BSD::RecvWork::IsBlocking(const BSD* bsd) const {
+    return (flags & FLAG_MSG_DONTWAIT) == 0 && !bsd->IsNonBlocking(fd);
+}
+
 void BSD::RecvWork::Execute(BSD* bsd) {
     std::tie(ret, bsd_errno) = bsd->RecvImpl(fd, flags, message);
 }
@@ -93,6 +103,10 @@ void BSD::RecvWork::Response(Kernel::HLERequestContext& ctx) {
     rb.PushEnum(bsd_errno);
 }
 
+bool BSD::RecvFromWork::IsBlocking(const BSD* bsd) const {
+    return (flags & FLAG_MSG_DONTWAIT) == 0 && !bsd->IsNonBlocking(fd);
+}
+
 void BSD::RecvFromWork::Execute(BSD* bsd) {
     std::tie(ret, bsd_errno) = bsd->RecvFromImpl(fd, flags, message, addr);
 }
@@ -449,6 +463,16 @@ void BSD::EventFd(Kernel::HLERequestContext& ctx) {
 
 template <typename Work>
 void BSD::ExecuteWork(Kernel::HLERequestContext& ctx, Work work) {
+    if constexpr (requires { work.IsBlocking(this); }) {
+        if (work.IsBlocking(this)) {
+            // Waiting for the network must not hold up the other sessions
+            RunBlocking(ctx, [this, work = std::move(work)](Kernel::HLERequestContext& ctx) mutable {
+                work.Execute(this);
+                work.Response(ctx);
+            });
+            return;
+        }
+    }
     work.Execute(this);
     work.Response(ctx);
 }
@@ -470,16 +494,18 @@ std::pair<s32, Errno> BSD::SocketImpl(Domain domain, Type type, Protocol protoco
         return {-1, Errno::MFILE};
     }
 
-    file_descriptors[fd] = FileDescriptor{};
-    FileDescriptor& descriptor = *file_descriptors[fd];
+    FileDescriptor descriptor;
     // ENONMEM might be thrown here
 
     LOG_INFO(Service, "New socket fd={}", fd);
 
-    descriptor.socket = std::make_unique<Network::Socket>();
+    descriptor.socket = std::make_shared<Network::Socket>();
     descriptor.socket->Initialize(Translate(domain), Translate(type), Translate(type, protocol));
     descriptor.is_connection_based = IsConnectionBased(type);
 
+    std::scoped_lock lock{descriptors_mutex};
+    file_descriptors[fd] = std::move(descriptor);
+
     return {fd, Errno::SUCCESS};
 }
 
@@ -512,31 +538,36 @@ std::pair<s32, Errno> BSD::PollImpl(std::vector<u8>& write_buffer, std::vector<u
         return {-1, Errno::INVAL};
     }
 
-    for (PollFD& pollfd : fds) {
-        ASSERT(False(pollfd.revents));
-
-        if (pollfd.fd > static_cast<s32>(MAX_FD) || pollfd.fd < 0) {
-            LOG_ERROR(Service, "File descriptor handle={} is invalid", pollfd.fd);
-            pollfd.revents = PollEvents{};
-            return {0, Errno::SUCCESS};
-        }
-
-        const std::optional<FileDescriptor>& descriptor = file_descriptors[pollfd.fd];
-        if (!descriptor) {
-            LOG_ERROR(Service, "File descriptor handle={} is not allocated", pollfd.fd);
-            pollfd.revents = PollEvents::Nval;
-            return {0, Errno::SUCCESS};
+    // Keeps the sockets alive in case they are closed while polling
+    std::vector<std::shared_ptr<Network::Socket>> sockets(fds.size());
+    {
+        std::scoped_lock lock{descriptors_mutex};
+        for (size_t i = 0; i < fds.size(); ++i) {
+            PollFD& pollfd = fds[i];
+            ASSERT(False(pollfd.revents));
+
+            if (pollfd.fd > static_cast<s32>(MAX_FD) || pollfd.fd < 0) {
+                LOG_ERROR(Service, "File descriptor handle={} is invalid", pollfd.fd);
+                pollfd.revents = PollEvents{};
+                return {0, Errno::SUCCESS};
+            }
+
+            const std::optional<FileDescriptor>& descriptor = file_descriptors[pollfd.fd];
+            if (!descriptor) {
+                LOG_ERROR(Service, "File descriptor handle={} is not allocated", pollfd.fd);
+                pollfd.revents = PollEvents::Nval;
+                return {0, Errno::SUCCESS};
+            }
+            sockets[i] = descriptor->socket;
         }
     }
 
     std::vector<Network::PollFD> host_pollfds(fds.size());
-    std::transform(fds.begin(), fds.end(), host_pollfds.begin(), [this](PollFD pollfd) {
-        Network::PollFD result;
-        result.socket = file_descriptors[pollfd.fd]->socket.get();
-        result.events = TranslatePollEventsToHost(pollfd.events);
-        result.revents = Network::PollEvents{};
-        return result;
-    });
+    for (size_t i = 0; i < fds.size(); ++i) {
+        host_pollfds[i].socket = sockets[i].get();
+        host_pollfds[i].events = TranslatePollEventsToHost(fds[i].events);
+        host_pollfds[i].revents = Network::PollEvents{};
+    }
 
     const auto result = Network::Poll(host_pollfds, timeout);
 
@@ -566,10 +597,13 @@ std::pair<s32, Errno> BSD::AcceptImpl(s32 fd, std::vector<u8>& write_buffer) {
         return {-1, Translate(bsd_errno)};
     }
 
-    file_descriptors[new_fd] = FileDescriptor{};
-    FileDescriptor& new_descriptor = *file_descriptors[new_fd];
-    new_descriptor.socket = std::move(result.socket);
-    new_descriptor.is_connection_based = descriptor.is_connection_based;
+    {
+        std::scoped_lock lock{descriptors_mutex};
+        file_descriptors[new_fd] = FileDescriptor{
+            .socket = std::move(result.socket),
+            .is_connection_based = descriptor.is_connection_based,
+        };
+    }
 
     ASSERT(write_buffer.size() == sizeof(SockAddrIn));
     const SockAddrIn guest_addr_in = Translate(result.sockaddr_in);
@@ -657,6 +691,7 @@ std::pair<s32, Errno> BSD::FcntlImpl(s32 fd, FcntlCmd cmd, s32 arg) {
         if (bsd_errno != Errno::SUCCESS) {
             return {-1, bsd_errno};
         }
+        std::scoped_lock lock{descriptors_mutex};
         descriptor.flags = arg;
         return {0, Errno::SUCCESS};
     }
@@ -718,20 +753,28 @@ Errno BSD::ShutdownImpl(s32 fd, s32 how) {
 }
 
 std::pair<s32, Errno> BSD::RecvImpl(s32 fd, u32 flags, std::vector<u8>& message) {
-    if (!IsFileDescriptorValid(fd)) {
-        return {-1, Errno::BADF};
+    std::shared_ptr<Network::Socket> socket;
+    {
+        std::scoped_lock lock{descriptors_mutex};
+        if (!IsFileDescriptorValid(fd)) {
+            return {-1, Errno::BADF};
+        }
+        socket = file_descriptors[fd]->socket;
     }
-    return Translate(file_descriptors[fd]->socket->Recv(flags, message));
+    return Translate(socket->Recv(flags, message));
 }
 
 std::pair<s32, Errno> BSD::RecvFromImpl(s32 fd, u32 flags, std::vector<u8>& message,
                                         std::vector<u8>& addr) {
-    if (!IsFileDescriptorValid(fd)) {
-        return {-1, Errno::BADF};
+    FileDescriptor descriptor;
+    {
+        std::scoped_lock lock{descriptors_mutex};
+        if (!IsFileDescriptorValid(fd)) {
+            return {-1, Errno::BADF};
+        }
+        descriptor = *file_descriptors[fd];
     }
 
-    FileDescriptor& descriptor = *file_descriptors[fd];
-
     Network::SockAddrIn addr_in{};
     Network::SockAddrIn* p_addr_in = nullptr;
     if (descriptor.is_connection_based) {
@@ -796,19 +839,27 @@ std::pair<s32, Errno> BSD::SendToImpl(s32 fd, u32 flags, const std::vector<u8>&
 }
 
 Errno BSD::CloseImpl(s32 fd) {
+    std::scoped_lock lock{descriptors_mutex};
     if (!IsFileDescriptorValid(fd)) {
         return Errno::BADF;
     }
 
-    const Errno bsd_errno = Translate(file_descriptors[fd]->socket->Close());
-    if (bsd_errno != Errno::SUCCESS) {
-        return bsd_errno;
+    const std::shared_ptr<Network::Socket>& socket = file_descriptors[fd]->socket;
+    if (socket.use_count() > 1) {
+        // A request on a worker still uses the socket, wake it up. The socket is closed once the
+        // request drops it, its host descriptor must not be reused while the request is at it.
+        socket->Shutdown(Network::ShutdownHow::RDWR);
+    } else {
+        const Errno bsd_errno = Translate(socket->Close());
+        if (bsd_errno != Errno::SUCCESS) {
+            return bsd_errno;
+        }
     }
 
     LOG_INFO(Service, "Close socket fd={}", fd);
 
     file_descriptors[fd].reset();
-    return bsd_errno;
+    return Errno::SUCCESS;
 }
 
 s32 BSD::FindFreeFileDescriptorHandle() noexcept {
@@ -832,6 +883,12 @@ bool BSD::IsFileDescriptorValid(s32 fd) const noexcept {
     return true;
 }
 
+bool BSD::IsNonBlocking(s32 fd) const noexcept {
+    // Requests on invalid descriptors fail right away
+    return fd >= static_cast<s32>(MAX_FD) || fd < 0 || !file_descriptors[fd] ||
+           (file_descriptors[fd]->flags & FLAG_O_NONBLOCK) != 0;
+}
+
 void BSD::BuildErrnoResponse(Kernel::HLERequestContext& ctx, Errno bsd_errno) const noexcept {
     IPC::ResponseBuilder rb{ctx, 4};
 
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "common/common_types.h"
@@ -33,12 +34,14 @@ private:
     static constexpr size_t MAX_FD = 128;
 
     struct FileDescriptor {
-        std::unique_ptr<Network::Socket> socket;
+        /// Shared with the blocking requests running on workers
+        std::shared_ptr<Network::Socket> socket;
         s32 flags = 0;
         bool is_connection_based = false;
     };
 
     struct PollWork {
+        bool IsBlocking(const BSD* bsd) const;
         void Execute(BSD* bsd);
         void Response(Kernel::HLERequestContext& ctx);
 
@@ -70,6 +73,7 @@ private:
     };
 
     struct RecvWork {
+        bool IsBlocking(const BSD* bsd) const;
         void Execute(BSD* bsd);
         void Response(Kernel::HLERequestContext& ctx);
 
@@ -81,6 +85,7 @@ private:
     };
 
     struct RecvFromWork {
+        bool IsBlocking(const BSD* bsd) const;
         void Execute(BSD* bsd);
         void Response(Kernel::HLERequestContext& ctx);
 
@@ -164,10 +169,17 @@ private:
 
     s32 FindFreeFileDescriptorHandle() noexcept;
     bool IsFileDescriptorValid(s32 fd) const noexcept;
+    bool IsNonBlocking(s32 fd) const noexcept;
 
     void BuildErrnoResponse(Kernel::HLERequestContext& ctx, Errno bsd_errno) const noexcept;
 
     std::array<std::optional<FileDescriptor>, MAX_FD> file_descriptors;
+
+    /**
+     * Only the service thread changes file_descriptors, it holds this while doing so. Blocking
+     * requests running on workers hold it to look up their sockets.
+     */
+    std::mutex descriptors_mutex;
 };
 
 class BSDCFG final : public ServiceFramework<BSDCFG> {
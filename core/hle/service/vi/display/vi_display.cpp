@@ -39,9 +39,6 @@ void Display::SignalVSyncEvent() {
 }
 
 void Display::CreateLayer(u64 layer_id, NVFlinger::BufferQueue& buffer_queue, ::pid_t pid) {
-    // TODO(Subv): Support more than 1 layer.
-    ASSERT_MSG(layers.empty(), "Only one layer is supported per display at the moment");
-
     layers.emplace_back(std::make_shared<Layer>(layer_id, buffer_queue, pid));
 }
 
@@ -57,6 +57,11 @@ public:
     /// Gets a layer for this display based off an index.
     std::shared_ptr<Layer> GetLayer(std::size_t index);
 
+    /// Gets all layers of this display, in the order they were created.
+    const std::vector<std::shared_ptr<Layer>>& GetLayers() const {
+        return layers;
+    }
+
     /// Gets the readable vsync event.
     int GetVSyncEvent() const;
 
@@ -4,8 +4,9 @@
 //
 // Adapted by Kent Hall for mizu on Horizon Linux.
 
-#include "core/hle/service/vi/layer/vi_layer.h"
+#include "common/logging/log.h"
 #include "core/hle/service/nvflinger/buffer_queue.h"
+#include "core/hle/service/vi/layer/vi_layer.h"
 
 namespace Service::VI {
 
@@ -15,6 +16,14 @@ Layer::Layer(u64 id, NVFlinger::BufferQueue& queue, ::pid_t pid)
 }
 
 Layer::~Layer() {
+    if (present_stats.num_presented != 0) {
+        LOG_INFO(Service_VI,
+                 "Layer {} presented {} buffers, latency avg {} us max {} us, {} compositions "
+                 "skipped it waiting on fences",
+                 layer_id, present_stats.num_presented,
+                 present_stats.total_latency.count() / 1000 / present_stats.num_presented,
+                 present_stats.max_latency.count() / 1000, present_stats.num_not_ready);
+    }
     buffer_queue.Disconnect();
     PutGPU(requester_pid);
 }
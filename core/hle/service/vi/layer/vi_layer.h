@@ -6,20 +6,28 @@
 
 #pragma once
 
+#include <chrono>
 #include <sys/types.h>
 #include "common/common_types.h"
+#include "core/hle/service/nvflinger/buffer_queue.h"
 #include "core/hle/service/service.h"
 #include "video_core/gpu.h"
 
-namespace Service::NVFlinger {
-class BufferQueue;
-}
-
 namespace Service::VI {
 
 /// Represents a single display layer.
 class Layer {
 public:
+    /// Statistics on the buffers presented from this layer, logged when it is closed.
+    struct PresentStats {
+        u64 num_presented{};
+        /// Compositions which skipped the layer as the fences of its buffer had not signalled
+        u64 num_not_ready{};
+        /// Time from queueing a buffer to presenting it
+        std::chrono::nanoseconds total_latency{};
+        std::chrono::nanoseconds max_latency{};
+    };
+
     /// Constructs a layer with a given ID and buffer queue.
     ///
     /// @param id    The ID to assign to this layer.
@@ -59,10 +67,26 @@ public:
         return buffer_queue;
     }
 
+    /// Gets the buffer acquired by an earlier composition which was not ready to be presented,
+    /// or nullptr.
+    const NVFlinger::BufferQueue::Buffer* GetPendingBuffer() const {
+        return pending_buffer;
+    }
+
+    void SetPendingBuffer(const NVFlinger::BufferQueue::Buffer* buffer) {
+        pending_buffer = buffer;
+    }
+
+    PresentStats& GetPresentStats() {
+        return present_stats;
+    }
+
 private:
     u64 layer_id;
     NVFlinger::BufferQueue& buffer_queue;
     ::pid_t requester_pid;
+    const NVFlinger::BufferQueue::Buffer* pending_buffer{};
+    PresentStats present_stats;
 };
 
 } // namespace Service::VI
@@ -9,6 +9,7 @@
 #include <cstring>
 #include <memory>
 #include <optional>
+#include <span>
 #include <type_traits>
 #include <utility>
 
@@ -20,6 +21,7 @@
 #include "common/settings.h"
 #include "common/swap.h"
 #include "core/hle/ipc_helpers.h"
+#include "core/hle/service/blocking_worker.h"
 #include "core/hle/service/nvdrv/nvdata.h"
 #include "core/hle/service/nvdrv/nvdrv.h"
 #include "core/hle/service/nvflinger/buffer_queue.h"
@@ -58,21 +60,29 @@ struct DisplayInfo {
 };
 static_assert(sizeof(DisplayInfo) == 0x60, "DisplayInfo has wrong size");
 
+/**
+ * A binder parcel. Requests are read in place from the buffer they arrived in, and responses are
+ * built in storage inside the parcel, so that handling one does not allocate.
+ */
 class Parcel {
 public:
     // This default size was chosen arbitrarily.
     static constexpr std::size_t DefaultBufferSize = 0x40;
-    Parcel() : buffer(DefaultBufferSize) {}
-    explicit Parcel(std::vector<u8> data) : buffer(std::move(data)) {}
+    /// Responses are built in place, the largest one, to RequestBuffer, is 0x190 bytes
+    static constexpr std::size_t MaxBufferSize = 0x200;
+
+    Parcel() = default;
+    /// The parcel reads from data, which must outlive it, e.g. a buffer in the request arena
+    explicit Parcel(std::span<const u8> data) : input(data) {}
     virtual ~Parcel() = default;
 
     template <typename T>
     T Read() {
         static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable.");
-        ASSERT(read_index + sizeof(T) <= buffer.size());
+        ASSERT(read_index + sizeof(T) <= input.size());
 
         T val;
-        std::memcpy(&val, buffer.data() + read_index, sizeof(T));
+        std::memcpy(&val, input.data() + read_index, sizeof(T));
         read_index += sizeof(T);
         read_index = Common::AlignUp(read_index, 4);
         return val;
@@ -81,48 +91,40 @@ public:
     template <typename T>
     T ReadUnaligned() {
         static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable.");
-        ASSERT(read_index + sizeof(T) <= buffer.size());
+        ASSERT(read_index + sizeof(T) <= input.size());
 
         T val;
-        std::memcpy(&val, buffer.data() + read_index, sizeof(T));
+        std::memcpy(&val, input.data() + read_index, sizeof(T));
         read_index += sizeof(T);
         return val;
     }
 
-    std::vector<u8> ReadBlock(std::size_t length) {
-        ASSERT(read_index + length <= buffer.size());
-        const u8* const begin = buffer.data() + read_index;
-        const u8* const end = begin + length;
-        std::vector<u8> data(begin, end);
+    std::span<const u8> ReadBlock(std::size_t length) {
+        ASSERT(read_index + length <= input.size());
+        const std::span<const u8> data = input.subspan(read_index, length);
         read_index += length;
         read_index = Common::AlignUp(read_index, 4);
         return data;
     }
 
-    std::u16string ReadInterfaceToken() {
+    void SkipInterfaceToken() {
         [[maybe_unused]] const u32 unknown = Read<u32_le>();
         const u32 length = Read<u32_le>();
 
-        std::u16string token{};
-
-        for (u32 ch = 0; ch < length + 1; ++ch) {
-            token.push_back(ReadUnaligned<u16_le>());
-        }
+        // The token is a null terminated UTF-16 string, it is not checked
+        const std::size_t token_size = (std::size_t{length} + 1) * sizeof(u16_le);
+        ASSERT(read_index + token_size <= input.size());
+        read_index += token_size;
 
         read_index = Common::AlignUp(read_index, 4);
-
-        return token;
     }
 
     template <typename T>
     void Write(const T& val) {
         static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable.");
+        ASSERT(write_index + sizeof(T) <= output.size());
 
-        if (buffer.size() < write_index + sizeof(T)) {
-            buffer.resize(buffer.size() + sizeof(T) + DefaultBufferSize);
-        }
-
-        std::memcpy(buffer.data() + write_index, &val, sizeof(T));
+        std::memcpy(output.data() + write_index, &val, sizeof(T));
         write_index += sizeof(T);
         write_index = Common::AlignUp(write_index, 4);
     }
@@ -139,16 +141,17 @@ public:
     }
 
     void Deserialize() {
-        ASSERT(buffer.size() > sizeof(Header));
+        ASSERT(input.size() > sizeof(Header));
 
         Header header{};
-        std::memcpy(&header, buffer.data(), sizeof(Header));
+        std::memcpy(&header, input.data(), sizeof(Header));
 
         read_index = header.data_offset;
         DeserializeData();
     }
 
-    std::vector<u8> Serialize() {
+    /// Returns the serialized parcel, which is valid as long as this object
+    std::span<const u8> Serialize() {
         ASSERT(read_index == 0);
         write_index = sizeof(Header);
 
@@ -159,9 +162,12 @@ public:
         header.data_offset = sizeof(Header);
         header.objects_size = 4;
         header.objects_offset = static_cast<u32>(sizeof(Header) + header.data_size);
-        std::memcpy(buffer.data(), &header, sizeof(Header));
+        std::memcpy(output.data(), &header, sizeof(Header));
 
-        return buffer;
+        // The objects stay zeroed
+        const std::size_t size = header.objects_offset + header.objects_size;
+        ASSERT(size <= output.size());
+        return std::span{output}.first(std::max(size, DefaultBufferSize));
     }
 
 protected:
@@ -178,7 +184,8 @@ private:
     };
     static_assert(sizeof(Header) == 16, "ParcelHeader has wrong size");
 
-    std::vector<u8> buffer;
+    std::span<const u8> input;
+    std::array<u8, MaxBufferSize> output{};
     std::size_t read_index = 0;
     std::size_t write_index = 0;
 };
@@ -211,12 +218,12 @@ private:
 
 class IGBPConnectRequestParcel : public Parcel {
 public:
-    explicit IGBPConnectRequestParcel(std::vector<u8> buffer_) : Parcel(std::move(buffer_)) {
+    explicit IGBPConnectRequestParcel(std::span<const u8> buffer_) : Parcel(buffer_) {
         Deserialize();
     }
 
     void DeserializeData() override {
-        [[maybe_unused]] const std::u16string token = ReadInterfaceToken();
+        SkipInterfaceToken();
         data = Read<Data>();
     }
 
@@ -273,13 +280,13 @@ private:
 
 class IGBPSetPreallocatedBufferRequestParcel : public Parcel {
 public:
-    explicit IGBPSetPreallocatedBufferRequestParcel(std::vector<u8> buffer_)
-        : Parcel(std::move(buffer_)) {
+    explicit IGBPSetPreallocatedBufferRequestParcel(std::span<const u8> buffer_)
+        : Parcel(buffer_) {
         Deserialize();
     }
 
     void DeserializeData() override {
-        [[maybe_unused]] const std::u16string token = ReadInterfaceToken();
+        SkipInterfaceToken();
         data = Read<Data>();
         if (data.contains_object != 0) {
             buffer_container = Read<BufferContainer>();
@@ -311,12 +318,12 @@ protected:
 
 class IGBPCancelBufferRequestParcel : public Parcel {
 public:
-    explicit IGBPCancelBufferRequestParcel(std::vector<u8> buffer_) : Parcel(std::move(buffer_)) {
+    explicit IGBPCancelBufferRequestParcel(std::span<const u8> buffer_) : Parcel(buffer_) {
         Deserialize();
     }
 
     void DeserializeData() override {
-        [[maybe_unused]] const std::u16string token = ReadInterfaceToken();
+        SkipInterfaceToken();
         data = Read<Data>();
     }
 
@@ -337,12 +344,12 @@ protected:
 
 class IGBPDequeueBufferRequestParcel : public Parcel {
 public:
-    explicit IGBPDequeueBufferRequestParcel(std::vector<u8> buffer_) : Parcel(std::move(buffer_)) {
+    explicit IGBPDequeueBufferRequestParcel(std::span<const u8> buffer_) : Parcel(buffer_) {
         Deserialize();
     }
 
     void DeserializeData() override {
-        [[maybe_unused]] const std::u16string token = ReadInterfaceToken();
+        SkipInterfaceToken();
         data = Read<Data>();
     }
 
@@ -376,12 +383,12 @@ protected:
 
 class IGBPRequestBufferRequestParcel : public Parcel {
 public:
-    explicit IGBPRequestBufferRequestParcel(std::vector<u8> buffer_) : Parcel(std::move(buffer_)) {
+    explicit IGBPRequestBufferRequestParcel(std::span<const u8> buffer_) : Parcel(buffer_) {
         Deserialize();
     }
 
     void DeserializeData() override {
-        [[maybe_unused]] const std::u16string token = ReadInterfaceToken();
+        SkipInterfaceToken();
         slot = Read<u32_le>();
     }
 
@@ -407,12 +414,12 @@ protected:
 
 class IGBPQueueBufferRequestParcel : public Parcel {
 public:
-    explicit IGBPQueueBufferRequestParcel(std::vector<u8> buffer_) : Parcel(std::move(buffer_)) {
+    explicit IGBPQueueBufferRequestParcel(std::span<const u8> buffer_) : Parcel(buffer_) {
         Deserialize();
     }
 
     void DeserializeData() override {
-        [[maybe_unused]] const std::u16string token = ReadInterfaceToken();
+        SkipInterfaceToken();
         data = Read<Data>();
     }
 
@@ -469,12 +476,12 @@ private:
 
 class IGBPQueryRequestParcel : public Parcel {
 public:
-    explicit IGBPQueryRequestParcel(std::vector<u8> buffer_) : Parcel(std::move(buffer_)) {
+    explicit IGBPQueryRequestParcel(std::span<const u8> buffer_) : Parcel(buffer_) {
         Deserialize();
     }
 
     void DeserializeData() override {
-        [[maybe_unused]] const std::u16string token = ReadInterfaceToken();
+        SkipInterfaceToken();
         type = Read<u32_le>();
     }
 
@@ -541,7 +548,7 @@ private:
 
         switch (transaction) {
         case TransactionId::Connect: {
-            IGBPConnectRequestParcel request{ctx.ReadBuffer()};
+            IGBPConnectRequestParcel request{ctx.ReadBufferInArena()};
             IGBPConnectResponseParcel response{
                 static_cast<u32>(static_cast<u32>(DisplayResolution::UndockedWidth) *
                                  Settings::values.resolution_factor.GetValue()),
@@ -554,7 +561,7 @@ private:
             break;
         }
         case TransactionId::SetPreallocatedBuffer: {
-            IGBPSetPreallocatedBufferRequestParcel request{ctx.ReadBuffer()};
+            IGBPSetPreallocatedBufferRequestParcel request{ctx.ReadBufferInArena()};
 
             buffer_queue.SetPreallocatedBuffer(request.data.slot, request.buffer_container.buffer);
 
@@ -563,23 +570,26 @@ private:
             break;
         }
         case TransactionId::DequeueBuffer: {
-            IGBPDequeueBufferRequestParcel request{ctx.ReadBuffer()};
+            IGBPDequeueBufferRequestParcel request{ctx.ReadBufferInArena()};
             const u32 width{request.data.width};
             const u32 height{request.data.height};
 
-            do {
-                if (auto result = buffer_queue.DequeueBuffer(width, height); result) {
-                    // Buffer is available
-                    IGBPDequeueBufferResponseParcel response{result->first, *result->second};
-                    ctx.WriteBuffer(response.Serialize());
-                    break;
-                }
-            } while (buffer_queue.IsConnected());
+            if (buffer_queue.HasFreeBuffer()) {
+                DequeueBuffer(ctx, buffer_queue, width, height);
+                break;
+            }
 
-            break;
+            // Until the compositor releases a buffer, vi goes on serving the other titles
+            RunBlocking(ctx, [queue = &buffer_queue, width, height](Kernel::HLERequestContext& ctx) {
+                DequeueBuffer(ctx, *queue, width, height);
+
+                IPC::ResponseBuilder rb{ctx, 2};
+                rb.Push(ResultSuccess);
+            });
+            return;
         }
         case TransactionId::RequestBuffer: {
-            IGBPRequestBufferRequestParcel request{ctx.ReadBuffer()};
+            IGBPRequestBufferRequestParcel request{ctx.ReadBufferInArena()};
 
             auto& buffer = buffer_queue.RequestBuffer(request.slot);
             IGBPRequestBufferResponseParcel response{buffer};
@@ -588,7 +598,7 @@ private:
             break;
         }
         case TransactionId::QueueBuffer: {
-            IGBPQueueBufferRequestParcel request{ctx.ReadBuffer()};
+            IGBPQueueBufferRequestParcel request{ctx.ReadBufferInArena()};
 
             buffer_queue.QueueBuffer(request.data.slot, request.data.transform,
                                      request.data.GetCropRect(), request.data.swap_interval,
@@ -599,7 +609,7 @@ private:
             break;
         }
         case TransactionId::Query: {
-            IGBPQueryRequestParcel request{ctx.ReadBuffer()};
+            IGBPQueryRequestParcel request{ctx.ReadBufferInArena()};
 
             const u32 value =
                 buffer_queue.Query(static_cast<NVFlinger::BufferQueue::QueryType>(request.type));
@@ -609,7 +619,7 @@ private:
             break;
         }
         case TransactionId::CancelBuffer: {
-            IGBPCancelBufferRequestParcel request{ctx.ReadBuffer()};
+            IGBPCancelBufferRequestParcel request{ctx.ReadBufferInArena()};
 
             buffer_queue.CancelBuffer(request.data.slot, request.data.multi_fence);
 
@@ -619,7 +629,7 @@ private:
         }
         case TransactionId::Disconnect: {
             LOG_WARNING(Service_VI, "(STUBBED) called, transaction=Disconnect");
-            const auto buffer = ctx.ReadBuffer();
+            [[maybe_unused]] const auto& buffer = ctx.ReadBufferInArena();
 
             buffer_queue.Disconnect();
 
@@ -628,7 +638,7 @@ private:
             break;
         }
         case TransactionId::DetachBuffer: {
-            const auto buffer = ctx.ReadBuffer();
+            [[maybe_unused]] const auto& buffer = ctx.ReadBufferInArena();
 
             IGBPEmptyResponseParcel response{};
             ctx.WriteBuffer(response.Serialize());
@@ -636,7 +646,7 @@ private:
         }
         case TransactionId::SetBufferCount: {
             LOG_WARNING(Service_VI, "(STUBBED) called, transaction=SetBufferCount");
-            [[maybe_unused]] const auto buffer = ctx.ReadBuffer();
+            [[maybe_unused]] const auto& buffer = ctx.ReadBufferInArena();
 
             IGBPEmptyResponseParcel response{};
             ctx.WriteBuffer(response.Serialize());
@@ -644,7 +654,7 @@ private:
         }
         case TransactionId::GetBufferHistory: {
             LOG_WARNING(Service_VI, "(STUBBED) called, transaction=GetBufferHistory");
-            [[maybe_unused]] const auto buffer = ctx.ReadBuffer();
+            [[maybe_unused]] const auto& buffer = ctx.ReadBufferInArena();
 
             IGBPEmptyResponseParcel response{};
             ctx.WriteBuffer(response.Serialize());
@@ -658,6 +668,18 @@ private:
         rb.Push(ResultSuccess);
     }
 
+    static void DequeueBuffer(Kernel::HLERequestContext& ctx, NVFlinger::BufferQueue& buffer_queue,
+                              u32 width, u32 height) {
+        do {
+            if (auto result = buffer_queue.DequeueBuffer(width, height); result) {
+                // Buffer is available
+                IGBPDequeueBufferResponseParcel response{result->first, *result->second};
+                ctx.WriteBuffer(response.Serialize());
+                break;
+            }
+        } while (buffer_queue.IsConnected());
+    }
+
     void AdjustRefcount(Kernel::HLERequestContext& ctx) {
         IPC::RequestParser rp{ctx};
         const u32 id = rp.Pop<u32>();
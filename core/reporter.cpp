@@ -7,6 +7,7 @@
 #include <ctime>
 #include <fstream>
 #include <iomanip>
+#include <span>
 
 #include <fmt/chrono.h>
 #include <fmt/format.h>
@@ -152,7 +153,7 @@ json GetFullDataAuto(const std::string& timestamp, u64 title_id) {
 }
 
 template <bool read_value, typename DescriptorType>
-json GetHLEBufferDescriptorData(const std::vector<DescriptorType>& buffer) {
+json GetHLEBufferDescriptorData(std::span<const DescriptorType> buffer) {
     auto buffer_out = json::array();
     for (const auto& desc : buffer) {
         auto entry = json{
@@ -0,0 +1,200 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+#include <utility>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "common/common_types.h"
+#include "common/logging/log.h"
+#include "input_common/sdl/sdl_event_waiter.h"
+
+namespace InputCommon::SDL {
+
+namespace {
+/// Directories holding the nodes SDL opens joysticks through, with the node name prefix
+constexpr std::array<std::pair<const char*, std::string_view>, 2> DEVICE_DIRECTORIES{{
+    {"/dev/input", "event"},
+    {"/dev", "hidraw"},
+}};
+
+bool TestBit(const u8* bits, unsigned bit) {
+    return (bits[bit / 8] >> (bit % 8) & 1) != 0;
+}
+
+/// Classifies an evdev node the way SDL does, joysticks have gamepad buttons or absolute axes
+bool IsJoystickDevice(int fd) {
+    std::array<u8, EV_MAX / 8 + 1> ev_bits{};
+    std::array<u8, KEY_MAX / 8 + 1> key_bits{};
+    if (::ioctl(fd, EVIOCGBIT(0, sizeof(ev_bits)), ev_bits.data()) < 0) {
+        return false;
+    }
+    if (TestBit(ev_bits.data(), EV_KEY) &&
+        ::ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits.data()) >= 0) {
+        for (unsigned button = BTN_JOYSTICK; button <= BTN_THUMBR; ++button) {
+            if (TestBit(key_bits.data(), button)) {
+                return true;
+            }
+        }
+        if (TestBit(key_bits.data(), BTN_TOUCH) || TestBit(key_bits.data(), BTN_TOOL_FINGER)) {
+            // Touchpads and touchscreens
+            return false;
+        }
+    }
+    return TestBit(ev_bits.data(), EV_ABS) && !TestBit(ev_bits.data(), EV_REL);
+}
+
+bool AddToEpoll(int epoll_fd, int fd) {
+    ::epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    return ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+} // Anonymous namespace
+
+EventWaiter::EventWaiter() {
+    epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (epoll_fd == -1 || wake_fd == -1 || inotify_fd == -1 || !AddToEpoll(epoll_fd, wake_fd) ||
+        !AddToEpoll(epoll_fd, inotify_fd)) {
+        LOG_WARNING(Input, "Failed to set up input event waiting: {}", std::strerror(errno));
+        for (int* const fd : {&epoll_fd, &wake_fd, &inotify_fd}) {
+            if (*fd != -1) {
+                ::close(*fd);
+                *fd = -1;
+            }
+        }
+        return;
+    }
+    for (const auto& [directory, prefix] : DEVICE_DIRECTORIES) {
+        if (::inotify_add_watch(inotify_fd, directory, IN_CREATE | IN_DELETE | IN_ATTRIB) == -1) {
+            LOG_WARNING(Input, "Unable to watch {} for new devices: {}", directory,
+                        std::strerror(errno));
+        }
+    }
+    ScanDevices();
+}
+
+EventWaiter::~EventWaiter() {
+    for (const auto& [fd, path] : devices) {
+        ::close(fd);
+    }
+    for (const int fd : {epoll_fd, wake_fd, inotify_fd}) {
+        if (fd != -1) {
+            ::close(fd);
+        }
+    }
+}
+
+bool EventWaiter::Wait(std::chrono::milliseconds timeout) {
+    std::array<::epoll_event, 16> events;
+    const int count = ::epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()),
+                                   static_cast<int>(timeout.count()));
+    bool rescan = false;
+    bool has_input = false;
+    for (int i = 0; i < count; ++i) {
+        const int fd = events[i].data.fd;
+        if (fd == wake_fd) {
+            u64 value;
+            [[maybe_unused]] const auto result = ::read(wake_fd, &value, sizeof(value));
+        } else if (fd == inotify_fd) {
+            DrainNotifications();
+            rescan = true;
+        } else if ((events[i].events & (EPOLLERR | EPOLLHUP)) != 0) {
+            CloseDevice(fd);
+        } else {
+            DrainDevice(fd);
+            has_input = true;
+        }
+    }
+    if (rescan) {
+        ScanDevices();
+    }
+    return has_input;
+}
+
+void EventWaiter::Interrupt() {
+    const u64 value = 1;
+    [[maybe_unused]] const auto result = ::write(wake_fd, &value, sizeof(value));
+}
+
+void EventWaiter::ScanDevices() {
+    for (const auto& [directory, prefix] : DEVICE_DIRECTORIES) {
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+            const std::string name = entry.path().filename().string();
+            if (!name.starts_with(prefix)) {
+                continue;
+            }
+            const std::string path = entry.path().string();
+            const bool is_watched =
+                std::any_of(devices.begin(), devices.end(),
+                            [&path](const auto& device) { return device.second == path; });
+            if (!is_watched) {
+                WatchDevice(path);
+            }
+        }
+    }
+}
+
+void EventWaiter::WatchDevice(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        // Nodes are created before udev applies their permissions, IN_ATTRIB brings us back
+        LOG_DEBUG(Input, "Unable to watch {}: {}", path, std::strerror(errno));
+        return;
+    }
+    if (path.starts_with("/dev/input/") && !IsJoystickDevice(fd)) {
+        // Keyboards and mice would wake the thread on every key press or mouse movement
+        ::close(fd);
+        return;
+    }
+    if (!AddToEpoll(epoll_fd, fd)) {
+        LOG_WARNING(Input, "Unable to watch {}: {}", path, std::strerror(errno));
+        ::close(fd);
+        return;
+    }
+    devices.emplace(fd, path);
+}
+
+void EventWaiter::CloseDevice(int fd) {
+    ::close(fd);
+    devices.erase(fd);
+}
+
+void EventWaiter::DrainDevice(int fd) {
+    // Only readiness matters here, SDL reads the events from its own descriptor
+    std::array<u8, 4096> buffer;
+    while (true) {
+        const ssize_t result = ::read(fd, buffer.data(), buffer.size());
+        if (result > 0) {
+            continue;
+        }
+        if (result == -1 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        }
+        // The device went away
+        CloseDevice(fd);
+        return;
+    }
+}
+
+void EventWaiter::DrainNotifications() {
+    alignas(::inotify_event) std::array<char, 4096> buffer;
+    while (::read(inotify_fd, buffer.data(), buffer.size()) > 0) {
+    }
+}
+
+} // namespace InputCommon::SDL
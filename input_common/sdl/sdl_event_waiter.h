@@ -0,0 +1,54 @@
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+namespace InputCommon::SDL {
+
+/**
+ * Blocks the SDL event thread until one of the device nodes SDL reads joysticks from has input,
+ * instead of pumping events on a fixed period. Watches the evdev and hidraw nodes through epoll
+ * and follows hotplug through inotify. Device input is drained from our own descriptors, SDL
+ * still reads its own copy of every event when pumping. Nodes we cannot open are nodes SDL cannot
+ * open either, so they are skipped.
+ */
+class EventWaiter {
+public:
+    EventWaiter();
+    ~EventWaiter();
+
+    EventWaiter(const EventWaiter&) = delete;
+    EventWaiter& operator=(const EventWaiter&) = delete;
+
+    /// Returns true when waiting is available, false when the caller has to poll
+    [[nodiscard]] bool IsValid() const {
+        return epoll_fd != -1;
+    }
+
+    /**
+     * Waits until a device has input, a device node is added or removed, Interrupt is called or
+     * the timeout expires. Returns true when a device had input.
+     */
+    bool Wait(std::chrono::milliseconds timeout);
+
+    /// Wakes up a thread blocked in Wait
+    void Interrupt();
+
+private:
+    void ScanDevices();
+    void WatchDevice(const std::string& path);
+    void CloseDevice(int fd);
+    void DrainDevice(int fd);
+    void DrainNotifications();
+
+    int epoll_fd = -1;
+    int inotify_fd = -1;
+    int wake_fd = -1;
+    std::unordered_map<int, std::string> devices;
+};
+
+} // namespace InputCommon::SDL
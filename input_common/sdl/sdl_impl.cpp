@@ -23,10 +23,12 @@
 #include "common/logging/log.h"
 #include "common/math_util.h"
 #include "common/param_package.h"
+#include "common/seqlock.h"
 #include "common/settings.h"
 #include "common/threadsafe_queue.h"
 #include "core/frontend/input.h"
 #include "input_common/motion_input.h"
+#include "input_common/sdl/sdl_event_waiter.h"
 #include "input_common/sdl/sdl_impl.h"
 
 namespace InputCommon::SDL {
@@ -58,6 +60,18 @@ static int SDLEventWatcher(void* user_data, SDL_Event* event) {
 
 class SDLJoystick {
 public:
+    static constexpr size_t MAX_BUTTONS = 64;
+    static constexpr size_t MAX_AXES = 16;
+    static constexpr size_t MAX_HATS = 8;
+
+    /// Whole controller state, published by the event thread and read without locks
+    struct Snapshot {
+        u64 buttons;
+        std::array<Sint16, MAX_AXES> axes;
+        std::array<Uint8, MAX_HATS> hats;
+        s64 event_time; ///< Steady clock time of the newest event, in nanoseconds
+    };
+
     SDLJoystick(std::string guid_, int port_, SDL_Joystick* joystick,
                 SDL_GameController* game_controller)
         : guid{std::move(guid_)}, port{port_}, sdl_joystick{joystick, &SDL_JoystickClose},
@@ -79,14 +93,20 @@ public:
         }
     }
 
-    void SetButton(int button, bool value) {
+    void SetButton(int button, bool value, s64 event_time) {
+        if (!IsValidIndex(button, MAX_BUTTONS)) {
+            return;
+        }
         std::lock_guard lock{mutex};
-        state.buttons.insert_or_assign(button, value);
+        const u64 mask = u64{1} << button;
+        pending.buttons = value ? (pending.buttons | mask) : (pending.buttons & ~mask);
+        Publish(event_time);
     }
 
     void PreSetButton(int button) {
-        if (!state.buttons.contains(button)) {
-            SetButton(button, false);
+        // Buttons start released, only check that the binding can be represented
+        if (!IsValidIndex(button, MAX_BUTTONS)) {
+            LOG_WARNING(Input, "Joystick {} button {} is out of range", guid, button);
         }
     }
 
@@ -119,59 +139,74 @@ public:
     }
 
     bool GetButton(int button) const {
-        std::lock_guard lock{mutex};
-        return state.buttons.at(button);
+        return GetButton(ReadSnapshot(), button);
+    }
+
+    static bool GetButton(const Snapshot& snapshot, int button) {
+        if (!IsValidIndex(button, MAX_BUTTONS)) {
+            return false;
+        }
+        return ((snapshot.buttons >> button) & 1) != 0;
     }
 
     bool ToggleButton(int button) {
-        std::lock_guard lock{mutex};
+        std::lock_guard lock{toggle_mutex};
 
-        if (!state.toggle_buttons.contains(button) || !state.lock_buttons.contains(button)) {
-            state.toggle_buttons.insert_or_assign(button, false);
-            state.lock_buttons.insert_or_assign(button, false);
+        if (!toggle_buttons.contains(button) || !lock_buttons.contains(button)) {
+            toggle_buttons.insert_or_assign(button, false);
+            lock_buttons.insert_or_assign(button, false);
         }
 
-        const bool button_state = state.toggle_buttons.at(button);
-        const bool button_lock = state.lock_buttons.at(button);
+        const bool button_state = toggle_buttons.at(button);
+        const bool button_lock = lock_buttons.at(button);
 
         if (button_lock) {
             return button_state;
         }
 
-        state.lock_buttons.insert_or_assign(button, true);
+        lock_buttons.insert_or_assign(button, true);
 
         if (button_state) {
-            state.toggle_buttons.insert_or_assign(button, false);
+            toggle_buttons.insert_or_assign(button, false);
         } else {
-            state.toggle_buttons.insert_or_assign(button, true);
+            toggle_buttons.insert_or_assign(button, true);
         }
 
         return !button_state;
     }
 
     bool UnlockButton(int button) {
-        std::lock_guard lock{mutex};
-        if (!state.toggle_buttons.contains(button)) {
+        std::lock_guard lock{toggle_mutex};
+        if (!toggle_buttons.contains(button)) {
             return false;
         }
-        state.lock_buttons.insert_or_assign(button, false);
-        return state.toggle_buttons.at(button);
+        lock_buttons.insert_or_assign(button, false);
+        return toggle_buttons.at(button);
     }
 
-    void SetAxis(int axis, Sint16 value) {
+    void SetAxis(int axis, Sint16 value, s64 event_time) {
+        if (!IsValidIndex(axis, MAX_AXES)) {
+            return;
+        }
         std::lock_guard lock{mutex};
-        state.axes.insert_or_assign(axis, value);
+        pending.axes[axis] = value;
+        Publish(event_time);
     }
 
     void PreSetAxis(int axis) {
-        if (!state.axes.contains(axis)) {
-            SetAxis(axis, 0);
+        // Axes start centered, only check that the binding can be represented
+        if (!IsValidIndex(axis, MAX_AXES)) {
+            LOG_WARNING(Input, "Joystick {} axis {} is out of range", guid, axis);
         }
     }
 
     float GetAxis(int axis, float range, float offset) const {
-        std::lock_guard lock{mutex};
-        const float value = static_cast<float>(state.axes.at(axis)) / 32767.0f;
+        return GetAxis(ReadSnapshot(), axis, range, offset);
+    }
+
+    static float GetAxis(const Snapshot& snapshot, int axis, float range, float offset) {
+        const Sint16 raw = IsValidIndex(axis, MAX_AXES) ? snapshot.axes[axis] : 0;
+        const float value = static_cast<float>(raw) / 32767.0f;
         const float offset_scale = (value + offset) > 0.0f ? 1.0f + offset : 1.0f - offset;
         return (value + offset) / range / offset_scale;
     }
@@ -192,8 +227,9 @@ public:
 
     std::tuple<float, float> GetAnalog(int axis_x, int axis_y, float range, float offset_x,
                                        float offset_y) const {
-        float x = GetAxis(axis_x, range, offset_x);
-        float y = GetAxis(axis_y, range, offset_y);
+        const Snapshot snapshot = ReadSnapshot();
+        float x = GetAxis(snapshot, axis_x, range, offset_x);
+        float y = GetAxis(snapshot, axis_y, range, offset_y);
         y = -y; // 3DS uses an y-axis inverse from SDL
 
         // Make sure the coordinates are in the unit circle,
@@ -220,15 +256,22 @@ public:
         return motion;
     }
 
-    void SetHat(int hat, Uint8 direction) {
+    void SetHat(int hat, Uint8 direction, s64 event_time) {
+        if (!IsValidIndex(hat, MAX_HATS)) {
+            return;
+        }
         std::lock_guard lock{mutex};
-        state.hats.insert_or_assign(hat, direction);
+        pending.hats[hat] = direction;
+        Publish(event_time);
     }
 
     bool GetHatDirection(int hat, Uint8 direction) const {
-        std::lock_guard lock{mutex};
-        return (state.hats.at(hat) & direction) != 0;
+        if (!IsValidIndex(hat, MAX_HATS)) {
+            return false;
+        }
+        return (ReadSnapshot().hats[hat] & direction) != 0;
     }
+
     /**
      * The guid of the joystick
      */
@@ -305,13 +348,61 @@ public:
     }
 
 private:
-    struct State {
-        std::unordered_map<int, bool> buttons;
-        std::unordered_map<int, bool> toggle_buttons{};
-        std::unordered_map<int, bool> lock_buttons{};
-        std::unordered_map<int, Sint16> axes;
-        std::unordered_map<int, Uint8> hats;
-    } state;
+    /// Publishes the pending state, the caller must hold the mutex
+    void Publish(s64 event_time) {
+        pending.event_time = event_time;
+        snapshot.Write(pending);
+    }
+
+    /**
+     * Reads the published state. Inside of an Input::SnapshotScope the controller is read once,
+     * later reads in the same scope return the same state.
+     */
+    Snapshot ReadSnapshot() const {
+        const u64 epoch = Input::SnapshotScope::CurrentEpoch();
+        if (epoch == 0) {
+            return snapshot.Read();
+        }
+        CachedSnapshot* slot = nullptr;
+        for (CachedSnapshot& cached : snapshot_cache) {
+            if (cached.epoch == epoch && cached.joystick == this) {
+                return cached.snapshot;
+            }
+            if (!slot && cached.epoch != epoch) {
+                slot = &cached;
+            }
+        }
+        u64 sequence;
+        const Snapshot value = snapshot.Read(&sequence);
+        if (sequence != 0 && reported_sequence.exchange(sequence, std::memory_order_relaxed) !=
+                                 sequence) {
+            Input::SnapshotScope::NoteEvent(value.event_time);
+        }
+        if (slot) {
+            *slot = {this, epoch, value};
+        }
+        return value;
+    }
+
+    static bool IsValidIndex(int index, size_t max) {
+        return index >= 0 && index < static_cast<int>(max);
+    }
+
+    struct CachedSnapshot {
+        const SDLJoystick* joystick;
+        u64 epoch;
+        Snapshot snapshot;
+    };
+    static thread_local std::array<CachedSnapshot, 8> snapshot_cache;
+
+    std::unordered_map<int, bool> toggle_buttons;
+    std::unordered_map<int, bool> lock_buttons;
+    std::mutex toggle_mutex;
+
+    Snapshot pending{};
+    Common::SeqLock<Snapshot> snapshot;
+    mutable std::atomic<u64> reported_sequence{};
+
     std::string guid;
     int port;
     std::unique_ptr<SDL_Joystick, decltype(&SDL_JoystickClose)> sdl_joystick;
@@ -325,6 +416,8 @@ private:
     bool has_accel{false};
 };
 
+thread_local std::array<SDLJoystick::CachedSnapshot, 8> SDLJoystick::snapshot_cache{};
+
 std::shared_ptr<SDLJoystick> SDLState::GetSDLJoystickByGUID(const std::string& guid, int port) {
     std::lock_guard lock{joystick_map_mutex};
     const auto it = joystick_map.find(guid);
@@ -420,29 +513,39 @@ void SDLState::CloseJoystick(SDL_Joystick* sdl_joystick) {
     }
 }
 
+s64 SDLState::EventTime(const SDL_Event& event) const {
+    const s64 now = Input::SnapshotScope::Now();
+    // SDL stamps events in milliseconds when they are pushed, move that to the steady clock
+    const u32 age_ms = SDL_GetTicks() - event.common.timestamp;
+    const s64 pushed = now - s64{age_ms} * 1'000'000;
+    // Events pumped after the waiter saw device input were readable since it woke up
+    const s64 input_ready = input_ready_time.load(std::memory_order_relaxed);
+    return input_ready != 0 ? std::min(input_ready, pushed) : pushed;
+}
+
 void SDLState::HandleGameControllerEvent(const SDL_Event& event) {
     switch (event.type) {
     case SDL_JOYBUTTONUP: {
         if (auto joystick = GetSDLJoystickBySDLID(event.jbutton.which)) {
-            joystick->SetButton(event.jbutton.button, false);
+            joystick->SetButton(event.jbutton.button, false, EventTime(event));
         }
         break;
     }
     case SDL_JOYBUTTONDOWN: {
         if (auto joystick = GetSDLJoystickBySDLID(event.jbutton.which)) {
-            joystick->SetButton(event.jbutton.button, true);
+            joystick->SetButton(event.jbutton.button, true, EventTime(event));
         }
         break;
     }
     case SDL_JOYHATMOTION: {
         if (auto joystick = GetSDLJoystickBySDLID(event.jhat.which)) {
-            joystick->SetHat(event.jhat.hat, event.jhat.value);
+            joystick->SetHat(event.jhat.hat, event.jhat.value, EventTime(event));
         }
         break;
     }
     case SDL_JOYAXISMOTION: {
         if (auto joystick = GetSDLJoystickBySDLID(event.jaxis.which)) {
-            joystick->SetAxis(event.jaxis.axis, event.jaxis.value);
+            joystick->SetAxis(event.jaxis.axis, event.jaxis.value, EventTime(event));
         }
         break;
     }
@@ -736,7 +839,7 @@ public:
                 direction = 0;
             }
             // This is necessary so accessing GetHat with hat won't crash
-            joystick->SetHat(hat, SDL_HAT_CENTERED);
+            joystick->SetHat(hat, SDL_HAT_CENTERED, Input::SnapshotScope::Now());
             return std::make_unique<SDLDirectionButton>(joystick, hat, direction);
         }
 
@@ -863,7 +966,7 @@ public:
                 direction = 0;
             }
             // This is necessary so accessing GetHat with hat won't crash
-            joystick->SetHat(hat, SDL_HAT_CENTERED);
+            joystick->SetHat(hat, SDL_HAT_CENTERED, Input::SnapshotScope::Now());
             return std::make_unique<SDLDirectionMotion>(joystick, hat, direction);
         }
 
@@ -937,11 +1040,26 @@ SDLState::SDLState() {
 
     initialized = true;
     if (start_thread) {
+        if (Settings::values.sdl_event_driven) {
+            event_waiter = std::make_unique<EventWaiter>();
+            if (!event_waiter->IsValid()) {
+                event_waiter.reset();
+            }
+        }
         poll_thread = std::thread([this] {
             using namespace std::chrono_literals;
             while (initialized) {
                 SDL_PumpEvents();
-                std::this_thread::sleep_for(1ms);
+                input_ready_time.store(0, std::memory_order_relaxed);
+                if (!event_waiter) {
+                    std::this_thread::sleep_for(1ms);
+                    continue;
+                }
+                // Bounded so SDL still gets to do its periodic work, e.g. expiring rumble
+                if (event_waiter->Wait(100ms)) {
+                    input_ready_time.store(Input::SnapshotScope::Now(),
+                                           std::memory_order_relaxed);
+                }
             }
         });
     }
@@ -964,6 +1082,9 @@ SDLState::~SDLState() {
 
     initialized = false;
     if (start_thread) {
+        if (event_waiter) {
+            event_waiter->Interrupt();
+        }
         poll_thread.join();
         SDL_QuitSubSystem(SDL_INIT_JOYSTICK);
     }
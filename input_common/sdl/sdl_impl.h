@@ -35,6 +35,7 @@ class SDLButtonFactory;
 class SDLMotionFactory;
 class SDLVibrationFactory;
 class SDLJoystick;
+class EventWaiter;
 
 class SDLState : public State {
 public:
@@ -47,6 +48,9 @@ public:
     /// Handle SDL_Events for joysticks from SDL_PollEvent
     void HandleGameControllerEvent(const SDL_Event& event);
 
+    /// Returns the steady clock time an event's input became available, in nanoseconds
+    s64 EventTime(const SDL_Event& event) const;
+
     /// Get the nth joystick with the corresponding GUID
     std::shared_ptr<SDLJoystick> GetSDLJoystickBySDLID(SDL_JoystickID sdl_id);
 
@@ -111,6 +115,11 @@ private:
     bool start_thread = false;
     std::atomic<bool> initialized = false;
 
+    /// Blocks the event thread until there is device input, null when polling instead
+    std::unique_ptr<EventWaiter> event_waiter;
+    /// Time the event thread woke up for device input, zero when it woke up for anything else
+    std::atomic<s64> input_ready_time = 0;
+
     std::thread poll_thread;
 };
 } // namespace InputCommon::SDL
@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "core/hle/service/ipc_trace_format.h"
+
+// Summarizes an IPC trace recorded by mizu with enable_ipc_trace set
+
+struct command_stats {
+	uint64_t title_id;
+	uint32_t service_id;
+	uint32_t command_id;
+	uint32_t flags;
+	uint64_t count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint64_t in_bytes;
+	uint64_t out_bytes;
+};
+
+static const struct ipc_trace_header *header;
+
+static struct command_stats *stats;
+static size_t num_stats, stats_capacity;
+
+// open addressing table of indices into stats, plus one
+static size_t *table;
+static size_t table_size;
+
+static uint64_t hash_key(uint64_t title_id, uint32_t service_id, uint32_t command_id, uint32_t flags)
+{
+	uint64_t h = title_id * 0x9E3779B97F4A7C15ULL;
+	h ^= ((uint64_t)service_id << 33 | (uint64_t)flags << 32 | command_id) * 0xC2B2AE3D27D4EB4FULL;
+	return h ^ (h >> 29);
+}
+
+static void *xrealloc(void *ptr, size_t size)
+{
+	ptr = realloc(ptr, size);
+	if (ptr == NULL) {
+		perror("realloc failed");
+		exit(1);
+	}
+	return ptr;
+}
+
+static void insert_index(size_t index)
+{
+	const struct command_stats *s = &stats[index];
+	size_t slot = hash_key(s->title_id, s->service_id, s->command_id, s->flags) & (table_size - 1);
+	while (table[slot] != 0)
+		slot = (slot + 1) & (table_size - 1);
+	table[slot] = index + 1;
+}
+
+static struct command_stats *find_stats(const struct ipc_trace_record *record)
+{
+	if (num_stats * 2 >= table_size) {
+		table_size = table_size ? table_size * 2 : 1024;
+		free(table);
+		table = calloc(table_size, sizeof(*table));
+		if (table == NULL) {
+			perror("calloc failed");
+			exit(1);
+		}
+		for (size_t i = 0; i < num_stats; ++i)
+			insert_index(i);
+	}
+
+	size_t slot = hash_key(record->title_id, record->service_id, record->command_id,
+			       record->flags) & (table_size - 1);
+	for (; table[slot] != 0; slot = (slot + 1) & (table_size - 1)) {
+		struct command_stats *s = &stats[table[slot] - 1];
+		if (s->title_id == record->title_id && s->service_id == record->service_id &&
+		    s->command_id == record->command_id && s->flags == record->flags)
+			return s;
+	}
+
+	if (num_stats == stats_capacity) {
+		stats_capacity = stats_capacity ? stats_capacity * 2 : 1024;
+		stats = xrealloc(stats, stats_capacity * sizeof(*stats));
+	}
+	struct command_stats *s = &stats[num_stats];
+	memset(s, 0, sizeof(*s));
+	s->title_id = record->title_id;
+	s->service_id = record->service_id;
+	s->command_id = record->command_id;
+	s->flags = record->flags;
+	table[slot] = ++num_stats;
+	return s;
+}
+
+static const char *lookup_name(uint32_t service_id, uint32_t command_id, uint32_t flags)
+{
+	uint32_t num_names = header->num_names;
+	if (num_names > IPC_TRACE_MAX_NAMES)
+		num_names = IPC_TRACE_MAX_NAMES;
+	for (uint32_t i = 0; i < num_names; ++i) {
+		const struct ipc_trace_name *name = &header->names[i];
+		if (name->service_id == service_id && name->command_id == command_id &&
+		    (command_id == IPC_TRACE_SERVICE_NAME || name->flags == flags))
+			return name->name;
+	}
+	return NULL;
+}
+
+static int compare_title(const struct command_stats *a, const struct command_stats *b)
+{
+	return a->title_id < b->title_id ? -1 : a->title_id > b->title_id;
+}
+
+static int compare_count(const void *lhs, const void *rhs)
+{
+	const struct command_stats *a = lhs, *b = rhs;
+	int title = compare_title(a, b);
+	if (title != 0)
+		return title;
+	return a->count < b->count ? 1 : a->count > b->count ? -1 : 0;
+}
+
+static int compare_latency(const void *lhs, const void *rhs)
+{
+	const struct command_stats *a = lhs, *b = rhs;
+	int title = compare_title(a, b);
+	if (title != 0)
+		return title;
+	return a->total_ns < b->total_ns ? 1 : a->total_ns > b->total_ns ? -1 : 0;
+}
+
+static void print_stats(const struct command_stats *s)
+{
+	const char *service = lookup_name(s->service_id, IPC_TRACE_SERVICE_NAME, 0);
+	const char *command = lookup_name(s->service_id, s->command_id, s->flags);
+	char command_buf[32];
+	if (command == NULL) {
+		snprintf(command_buf, sizeof(command_buf), "%s%" PRIu32,
+			 (s->flags & IPC_TRACE_FLAG_TIPC) ? "tipc " : "", s->command_id);
+		command = command_buf;
+	}
+	printf("  %10" PRIu64 " %12.3f %10.1f %10.1f %10.1f %10.1f  %s::%s\n",
+	       s->count, s->total_ns / 1e6, s->total_ns / 1e3 / s->count, s->max_ns / 1e3,
+	       (double)s->in_bytes / s->count, (double)s->out_bytes / s->count,
+	       service ? service : "?", command);
+}
+
+static void print_top(const struct command_stats *begin, const struct command_stats *end,
+		      unsigned top)
+{
+	printf("  %10s %12s %10s %10s %10s %10s  %s\n", "count", "total ms", "avg us", "max us",
+	       "avg in", "avg out", "command");
+	for (const struct command_stats *s = begin; s != end && top != 0; ++s, --top)
+		print_stats(s);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned top = 10;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		if (opt == 'n') {
+			top = (unsigned)strtoul(optarg, NULL, 10);
+		} else {
+			fprintf(stderr, "Usage: %s [-n top-count] <ipc_trace.bin>\n", argv[0]);
+			return 1;
+		}
+	}
+	if (optind != argc - 1) {
+		fprintf(stderr, "Usage: %s [-n top-count] <ipc_trace.bin>\n", argv[0]);
+		return 1;
+	}
+
+	int fd = open(argv[optind], O_RDONLY);
+	if (fd == -1) {
+		perror("open failed");
+		return 1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		perror("fstat failed");
+		return 1;
+	}
+	if ((size_t)st.st_size < sizeof(*header)) {
+		fprintf(stderr, "%s is not an IPC trace\n", argv[optind]);
+		return 1;
+	}
+	void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (mapping == MAP_FAILED) {
+		perror("mmap failed");
+		return 1;
+	}
+	close(fd);
+
+	header = mapping;
+	if (header->magic != IPC_TRACE_MAGIC || header->version != IPC_TRACE_VERSION ||
+	    sizeof(*header) + header->capacity * sizeof(struct ipc_trace_record) > (size_t)st.st_size) {
+		fprintf(stderr, "%s is not an IPC trace of version %d\n", argv[optind],
+			IPC_TRACE_VERSION);
+		return 1;
+	}
+	const struct ipc_trace_record *records =
+		(const struct ipc_trace_record *)((const char *)mapping + sizeof(*header));
+
+	// the ring only holds the last capacity records
+	const uint64_t next = header->next;
+	const uint64_t first = next > header->capacity ? next - header->capacity : 0;
+	uint64_t num_records = 0, incomplete = 0;
+	for (uint64_t i = first; i < next; ++i) {
+		const struct ipc_trace_record *record = &records[i % header->capacity];
+		if (record->sequence != i + 1) {
+			++incomplete;
+			continue;
+		}
+		struct command_stats *s = find_stats(record);
+		++s->count;
+		s->total_ns += record->duration_ns;
+		if (record->duration_ns > s->max_ns)
+			s->max_ns = record->duration_ns;
+		s->in_bytes += record->in_size;
+		s->out_bytes += record->out_size;
+		++num_records;
+	}
+	printf("%" PRIu64 " requests", num_records);
+	if (first != 0)
+		printf(", %" PRIu64 " older requests were overwritten", first);
+	if (incomplete != 0)
+		printf(", %" PRIu64 " were still being written", incomplete);
+	printf("\n");
+
+	struct command_stats *by_latency = xrealloc(NULL, num_stats * sizeof(*stats) + 1);
+	memcpy(by_latency, stats, num_stats * sizeof(*stats));
+	qsort(stats, num_stats, sizeof(*stats), compare_count);
+	qsort(by_latency, num_stats, sizeof(*stats), compare_latency);
+
+	// both arrays are grouped by title in the same order
+	for (size_t begin = 0, end; begin < num_stats; begin = end) {
+		uint64_t count = 0, total_ns = 0;
+		for (end = begin; end < num_stats && stats[end].title_id == stats[begin].title_id; ++end) {
+			count += stats[end].count;
+			total_ns += stats[end].total_ns;
+		}
+		printf("\nTitle %016" PRIX64 ": %" PRIu64 " requests, %.3f ms handling them\n",
+		       stats[begin].title_id, count, total_ns / 1e6);
+		printf(" Top %u by count:\n", top);
+		print_top(&stats[begin], &stats[end], top);
+		printf(" Top %u by total latency:\n", top);
+		print_top(&by_latency[begin], &by_latency[end], top);
+	}
+	return 0;
+}
@@ -1,9 +1,15 @@
 #include <csignal>
 #include <clocale>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
 #include <limits.h>
 #include <sched.h>
 #include <QApplication>
 #include <QHBoxLayout>
+#include <QScreen>
+#include "core/hle/service/nvflinger/nvflinger.h"
 #include "core/hle/service/service.h"
 #include "core/hle/service/sm/sm.h"
 #include "core/hle/kernel/code_set.h"
@@ -11,6 +17,9 @@
 #include "common/logging/log.h"
 #include "common/settings.h"
 #include "configuration/config.h"
+#ifndef VIDEO_CORE_COMPAT
+#include "video_core/shader_environment.h"
+#endif
 
 static void on_sig(int) {
     // this allows logging to flush gracefully
@@ -18,6 +27,19 @@ static void on_sig(int) {
 }
 
 int main(int argc, char **argv) {
+#ifndef VIDEO_CORE_COMPAT
+    // offline shader cache maintenance, merging one file onto itself compacts it
+    if (argc >= 2 && ::strcmp(argv[1], "--merge-shader-cache") == 0) {
+        if (argc < 4) {
+            ::fprintf(stderr, "Usage: %s --merge-shader-cache <output> <input>...\n", argv[0]);
+            return 1;
+        }
+        Common::Log::Initialize();
+        const std::vector<std::filesystem::path> inputs(argv + 3, argv + argc);
+        return VideoCommon::MergePipelineCaches(inputs, argv[2]) ? 0 : 1;
+    }
+#endif
+
     if (::signal(SIGINT, on_sig) == SIG_ERR) {
         ::perror("signal failed");
         return 1;
@@ -75,6 +97,9 @@ int main(int argc, char **argv) {
 
     // start service threads
     Service::StartServices();
+    if (const QScreen* screen = app.primaryScreen()) {
+        Service::SharedWriter(Service::nv_flinger)->SetHostRefreshRate(screen->refreshRate());
+    }
 
     // service manager thread
     std::thread sm_thread([](){
@@ -26,6 +26,7 @@
 #include "common/microprofile.h"
 #include "common/scope_exit.h"
 #include "common/settings.h"
+#include "common/sparse_page_table.h"
 #include "video_core/buffer_cache/buffer_base.h"
 #include "video_core/delayed_destruction_ring.h"
 #include "video_core/dirty_flags.h"
@@ -203,6 +204,11 @@ public:
     /// Return true when a CPU region is modified from the CPU
     [[nodiscard]] bool IsRegionCpuModified(VAddr addr, size_t size);
 
+    /// Return the host memory used by the page table tracking registered buffers
+    [[nodiscard]] size_t PageTableMemoryUsage() const noexcept {
+        return page_table.MemoryUsage();
+    }
+
     std::mutex mutex;
     Runtime& runtime;
 
@@ -221,7 +227,7 @@ private:
     void ForEachBufferInRange(VAddr cpu_addr, u64 size, Func&& func) {
         const u64 page_end = Common::DivCeil(cpu_addr + size, PAGE_SIZE);
         for (u64 page = cpu_addr >> PAGE_BITS; page < page_end;) {
-            const BufferId buffer_id = page_table[page];
+            const BufferId buffer_id = page_table.Get(page);
             if (!buffer_id) {
                 ++page;
                 continue;
@@ -440,7 +446,7 @@ private:
     u64 frame_tick = 0;
     u64 total_used_memory = 0;
 
-    std::array<BufferId, ((1ULL << 39) >> PAGE_BITS)> page_table;
+    Common::SparsePageTable<BufferId, ((1ULL << 39) >> PAGE_BITS)> page_table;
 };
 
 template <class P>
@@ -899,7 +905,7 @@ template <class P>
 bool BufferCache<P>::IsRegionGpuModified(VAddr addr, size_t size) {
     const u64 page_end = Common::DivCeil(addr + size, PAGE_SIZE);
     for (u64 page = addr >> PAGE_BITS; page < page_end;) {
-        const BufferId image_id = page_table[page];
+        const BufferId image_id = page_table.Get(page);
         if (!image_id) {
             ++page;
             continue;
@@ -919,7 +925,7 @@ bool BufferCache<P>::IsRegionRegistered(VAddr addr, size_t size) {
     const VAddr end_addr = addr + size;
     const u64 page_end = Common::DivCeil(end_addr, PAGE_SIZE);
     for (u64 page = addr >> PAGE_BITS; page < page_end;) {
-        const BufferId buffer_id = page_table[page];
+        const BufferId buffer_id = page_table.Get(page);
         if (!buffer_id) {
             ++page;
             continue;
@@ -939,7 +945,7 @@ template <class P>
 bool BufferCache<P>::IsRegionCpuModified(VAddr addr, size_t size) {
     const u64 page_end = Common::DivCeil(addr + size, PAGE_SIZE);
     for (u64 page = addr >> PAGE_BITS; page < page_end;) {
-        const BufferId image_id = page_table[page];
+        const BufferId image_id = page_table.Get(page);
         if (!image_id) {
             ++page;
             continue;
@@ -1438,7 +1444,7 @@ BufferId BufferCache<P>::FindBuffer(VAddr cpu_addr, u32 size, GPUVAddr gpu_addr)
         return NULL_BUFFER_ID;
     }
     const u64 page = cpu_addr >> PAGE_BITS;
-    const BufferId buffer_id = page_table[page];
+    const BufferId buffer_id = page_table.Get(page);
     if (!buffer_id) {
         return CreateBuffer(cpu_addr, size, gpu_addr);
     }
@@ -1460,7 +1466,7 @@ typename BufferCache<P>::OverlapResult BufferCache<P>::ResolveOverlaps(VAddr cpu
     int stream_score = 0;
     bool has_stream_leap = false;
     for (; cpu_addr >> PAGE_BITS < Common::DivCeil(end, PAGE_SIZE); cpu_addr += PAGE_SIZE) {
-        const BufferId overlap_id = page_table[cpu_addr >> PAGE_BITS];
+        const BufferId overlap_id = page_table.Get(cpu_addr >> PAGE_BITS);
         if (!overlap_id) {
             continue;
         }
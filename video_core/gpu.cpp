@@ -215,6 +215,13 @@ struct GPU::Impl {
         return *shader_notify;
     }
 
+    [[nodiscard]] VideoCore::MemoryUsage MemoryUsage() {
+        if (!rasterizer) {
+            return {};
+        }
+        return rasterizer->GetMemoryUsage();
+    }
+
     /// Returns a const reference to the shader notifier.
     [[nodiscard]] const VideoCore::ShaderNotify& ShaderNotify() const {
         return *shader_notify;
@@ -242,6 +249,13 @@ struct GPU::Impl {
         });
     }
 
+    [[nodiscard]] bool IsFenceSignalled(u32 syncpoint_id, u32 value) const {
+        if (!is_async || syncpoint_id == UINT32_MAX) {
+            return true;
+        }
+        return syncpoints.at(syncpoint_id).load() >= value;
+    }
+
     void IncrementSyncPoint(u32 syncpoint_id) {
         auto& syncpoint = syncpoints.at(syncpoint_id);
         syncpoint++;
@@ -881,10 +895,18 @@ const VideoCore::ShaderNotify& GPU::ShaderNotify() const {
     return impl->ShaderNotify();
 }
 
+VideoCore::MemoryUsage GPU::MemoryUsage() {
+    return impl->MemoryUsage();
+}
+
 void GPU::WaitFence(u32 syncpoint_id, u32 value) {
     impl->WaitFence(syncpoint_id, value);
 }
 
+bool GPU::IsFenceSignalled(u32 syncpoint_id, u32 value) const {
+    return impl->IsFenceSignalled(syncpoint_id, value);
+}
+
 void GPU::IncrementSyncPoint(u32 syncpoint_id) {
     impl->IncrementSyncPoint(syncpoint_id);
 }
@@ -25,6 +25,7 @@ class EmuWindow;
 namespace VideoCore {
 class RendererBase;
 class ShaderNotify;
+struct MemoryUsage;
 } // namespace VideoCore
 
 class GRenderWindow;
@@ -210,12 +211,18 @@ public:
     /// Returns a reference to the shader notifier.
     [[nodiscard]] VideoCore::ShaderNotify& ShaderNotify();
 
+    /// Returns the host memory used by the rasterizer to track guest memory.
+    [[nodiscard]] VideoCore::MemoryUsage MemoryUsage();
+
     /// Returns a const reference to the shader notifier.
     [[nodiscard]] const VideoCore::ShaderNotify& ShaderNotify() const;
 
     /// Allows the CPU/NvFlinger to wait on the GPU before presenting a frame.
     void WaitFence(u32 syncpoint_id, u32 value);
 
+    /// Returns true if WaitFence would return right away, for presenting without blocking.
+    [[nodiscard]] bool IsFenceSignalled(u32 syncpoint_id, u32 value) const;
+
     void IncrementSyncPoint(u32 syncpoint_id);
 
     void NotifySessionClose();
@@ -30,7 +30,8 @@ void RasterizerAccelerated::UpdatePagesCachedCount(VAddr addr, u64 size, int del
     std::atomic_thread_fence(std::memory_order_acquire);
     const u64 page_end = Common::DivCeil(addr + size, PAGE_SIZE);
     for (u64 page = addr >> PAGE_BITS; page != page_end; ++page) {
-        std::atomic_uint16_t& count = cached_pages.at(page >> 2).Count(page);
+        ASSERT_MSG((page >> 2) < NUM_CACHE_ENTRIES, "Page is out of range!");
+        std::atomic_uint16_t& count = cached_pages[page >> 2].Count(page);
 
         if (delta > 0) {
             ASSERT_MSG(count.load(std::memory_order::relaxed) < UINT16_MAX, "Count may overflow!");
@@ -71,4 +72,10 @@ void RasterizerAccelerated::UpdatePagesCachedCount(VAddr addr, u64 size, int del
     /* } */
 }
 
+MemoryUsage RasterizerAccelerated::GetMemoryUsage() {
+    return MemoryUsage{
+        .cached_pages = cached_pages.MemoryUsage(),
+    };
+}
+
 } // namespace VideoCore
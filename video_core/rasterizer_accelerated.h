@@ -10,6 +10,7 @@
 #include <atomic>
 
 #include "common/common_types.h"
+#include "common/sparse_page_table.h"
 #include "video_core/rasterizer_interface.h"
 
 namespace Core::Memory {
@@ -26,6 +27,8 @@ public:
 
     void UpdatePagesCachedCount(VAddr addr, u64 size, int delta) override;
 
+    MemoryUsage GetMemoryUsage() override;
+
 private:
     class CacheEntry final {
     public:
@@ -44,7 +47,9 @@ private:
     };
     static_assert(sizeof(CacheEntry) == 8, "CacheEntry should be 8 bytes!");
 
-    std::array<CacheEntry, 0x2000000> cached_pages;
+    static constexpr u64 NUM_CACHE_ENTRIES = 0x2000000;
+
+    Common::SparsePageTable<CacheEntry, NUM_CACHE_ENTRIES> cached_pages;
 };
 
 } // namespace VideoCore
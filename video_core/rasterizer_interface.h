@@ -35,6 +35,17 @@ enum class LoadCallbackStage {
 };
 using DiskResourceLoadCallback = std::function<void(LoadCallbackStage, std::size_t, std::size_t)>;
 
+/// Host memory used by the structures tracking guest memory, in bytes
+struct MemoryUsage {
+    std::size_t buffer_page_table{};
+    std::size_t texture_page_tables{};
+    std::size_t cached_pages{};
+
+    [[nodiscard]] std::size_t Total() const noexcept {
+        return buffer_page_table + texture_page_tables + cached_pages;
+    }
+};
+
 class RasterizerInterface {
 public:
     RasterizerInterface(Tegra::GPU& gpu_) : gpu{gpu_} {}
@@ -140,6 +151,11 @@ public:
     virtual void LoadDiskResources(u64 title_id, std::stop_token stop_loading,
                                    const DiskResourceLoadCallback& callback) {}
 
+    /// Return the host memory used to track guest memory
+    [[nodiscard]] virtual MemoryUsage GetMemoryUsage() {
+        return {};
+    }
+
     const Tegra::GPU& GPU() {
         return gpu;
     }
@@ -143,6 +143,14 @@ void RasterizerOpenGL::LoadDiskResources(u64 title_id, std::stop_token stop_load
     shader_cache.LoadDiskResources(title_id, stop_loading, callback);
 }
 
+VideoCore::MemoryUsage RasterizerOpenGL::GetMemoryUsage() {
+    VideoCore::MemoryUsage usage{RasterizerAccelerated::GetMemoryUsage()};
+    std::scoped_lock lock{texture_cache.mutex, buffer_cache.mutex};
+    usage.buffer_page_table = buffer_cache.PageTableMemoryUsage();
+    usage.texture_page_tables = texture_cache.PageTableMemoryUsage();
+    return usage;
+}
+
 void RasterizerOpenGL::Clear() {
     MICROPROFILE_SCOPE(OpenGL_Clears);
     if (!maxwell3d.ShouldExecute()) {
@@ -77,7 +77,8 @@ public:
         VideoCore::ShaderNotify* shader_notify, const Device& device,
         DescriptorPool& descriptor_pool, VKUpdateDescriptorQueue& update_descriptor_queue,
         Common::ThreadWorker* worker_thread, PipelineStatistics* pipeline_statistics,
-        RenderPassCache& render_pass_cache, const GraphicsPipelineCacheKey& key,
+        VkPipelineCache pipeline_cache, RenderPassCache& render_pass_cache,
+        const GraphicsPipelineCacheKey& key,
         std::array<vk::ShaderModule, NUM_STAGES> stages,
         const std::array<const Shader::Info*, NUM_STAGES>& infos);
 
@@ -117,7 +118,7 @@ private:
 
     void ConfigureDraw();
 
-    void MakePipeline(VkRenderPass render_pass);
+    void MakePipeline(VkRenderPass render_pass, VkPipelineCache pipeline_cache);
 
     void Validate();
 
@@ -5,10 +5,15 @@
 // Adapted by Kent Hall for mizu on Horizon Linux.
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <fstream>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <thread>
+#include <unordered_set>
+#include <variant>
 #include <vector>
 
 #include "common/bit_cast.h"
@@ -58,6 +63,39 @@ using VideoCommon::GraphicsEnvironment;
 
 constexpr u32 CACHE_VERSION = 5;
 
+constexpr std::array<char, 8> VULKAN_CACHE_MAGIC_NUMBER{'m', 'i', 'z', 'u', 'v', 'k', 'p', 'c'};
+constexpr std::chrono::seconds VULKAN_CACHE_SAVE_INTERVAL{30};
+
+constexpr std::array<char, 8> USAGE_MAGIC_NUMBER{'m', 'i', 'z', 'u', 'u', 's', 'e', '1'};
+constexpr std::chrono::seconds USAGE_SAVE_INTERVAL{30};
+constexpr size_t MAX_USAGE_RECORDS = 0x10000;
+
+/// Prefix of the driver pipeline cache file, a blob from another driver or device is discarded
+struct VulkanCacheHeader {
+    std::array<char, 8> magic_number;
+    u32 cache_version;
+    u32 vendor_id;
+    u32 device_id;
+    u32 driver_version;
+    std::array<u8, VK_UUID_SIZE> pipeline_cache_uuid;
+
+    bool operator==(const VulkanCacheHeader&) const = default;
+};
+static_assert(std::has_unique_object_representations_v<VulkanCacheHeader>);
+
+VulkanCacheHeader MakeVulkanCacheHeader(const Device& device) {
+    VulkanCacheHeader header{
+        .magic_number = VULKAN_CACHE_MAGIC_NUMBER,
+        .cache_version = CACHE_VERSION,
+        .vendor_id = device.GetVendorID(),
+        .device_id = device.GetDeviceID(),
+        .driver_version = device.GetDriverVersion(),
+        .pipeline_cache_uuid{},
+    };
+    std::ranges::copy(device.GetPipelineCacheUUID(), header.pipeline_cache_uuid.begin());
+    return header;
+}
+
 template <typename Container>
 auto MakeSpan(Container& container) {
     return std::span(container.data(), container.size());
@@ -242,6 +280,66 @@ Shader::RuntimeInfo MakeRuntimeInfo(std::span<const Shader::IR::Program> program
     info.y_negate = key.state.y_negate != 0;
     return info;
 }
+
+/// Marks a prewarm entry as being built and takes its environments, returns std::nullopt when the
+/// pipeline was already taken by a bind
+template <typename Pipeline, typename Key>
+std::optional<std::vector<FileEnvironment>> ClaimPrewarm(
+    std::mutex& mutex, std::unordered_map<Key, PrewarmEntry<Pipeline>>& entries, const Key& key) {
+    std::lock_guard lock{mutex};
+    const auto it{entries.find(key)};
+    if (it == entries.end() || it->second.state != PrewarmState::Queued) {
+        return std::nullopt;
+    }
+    it->second.state = PrewarmState::Building;
+    return std::move(it->second.envs);
+}
+
+template <typename Pipeline, typename Key>
+void FinishPrewarm(std::mutex& mutex, std::condition_variable& condvar,
+                   std::unordered_map<Key, PrewarmEntry<Pipeline>>& entries, const Key& key,
+                   std::unique_ptr<Pipeline> pipeline) {
+    std::lock_guard lock{mutex};
+    PrewarmEntry<Pipeline>& entry{entries.at(key)};
+    entry.pipeline = std::move(pipeline);
+    entry.state = PrewarmState::Built;
+    condvar.notify_all();
+}
+
+/// Drops the prewarm entries no worker has picked up yet, their queued jobs find nothing to claim
+template <typename Pipeline, typename Key>
+void DropQueuedPrewarms(std::mutex& mutex,
+                        std::unordered_map<Key, PrewarmEntry<Pipeline>>& entries) {
+    std::lock_guard lock{mutex};
+    std::erase_if(entries, [](const auto& item) {
+        return item.second.state == PrewarmState::Queued;
+    });
+}
+
+/// Takes a pipeline loaded from disk out of the prewarm entries. Waits for it when a worker is
+/// building it, and builds it on the calling thread when no worker has picked it up yet.
+/// Returns std::nullopt when the pipeline was not loaded from disk.
+template <typename Pipeline, typename Key, typename Build>
+std::optional<std::unique_ptr<Pipeline>> TakePrewarmed(
+    std::mutex& mutex, std::condition_variable& condvar,
+    std::unordered_map<Key, PrewarmEntry<Pipeline>>& entries, const Key& key, Build&& build) {
+    std::unique_lock lock{mutex};
+    const auto it{entries.find(key)};
+    if (it == entries.end()) {
+        return std::nullopt;
+    }
+    PrewarmEntry<Pipeline>& entry{it->second};
+    if (entry.state == PrewarmState::Queued) {
+        std::vector<FileEnvironment> envs{std::move(entry.envs)};
+        entries.erase(it);
+        lock.unlock();
+        return build(envs);
+    }
+    condvar.wait(lock, [&entry] { return entry.state == PrewarmState::Built; });
+    std::unique_ptr<Pipeline> pipeline{std::move(entry.pipeline)};
+    entries.erase(it);
+    return pipeline;
+}
 } // Anonymous namespace
 
 size_t ComputePipelineCacheKey::Hash() const noexcept {
@@ -329,9 +427,24 @@ PipelineCache::PipelineCache(RasterizerVulkan& rasterizer_, Tegra::Engines::Maxw
         .needs_demote_reorder = driver_id == VK_DRIVER_ID_AMD_PROPRIETARY_KHR ||
                                 driver_id == VK_DRIVER_ID_AMD_OPEN_SOURCE_KHR,
     };
+    // The profile and host info only depend on the device, instances on the same device and
+    // driver translate shaders the same way
+    const VulkanCacheHeader device_header{MakeVulkanCacheHeader(device)};
+    shared_cache = SharedPipelineCache::Acquire(
+        Common::CityHash64(reinterpret_cast<const char*>(&device_header), sizeof(device_header)));
 }
 
-PipelineCache::~PipelineCache() = default;
+PipelineCache::~PipelineCache() {
+    // Skip the pipelines still waiting for a worker and let the ones being built finish, the
+    // workers have to be idle before the final save reads the shared Vulkan pipeline cache
+    prewarm_cancelled = true;
+    DropQueuedPrewarms(prewarm_mutex, prewarm_graphics);
+    DropQueuedPrewarms(prewarm_mutex, prewarm_compute);
+    workers.WaitForRequests();
+    serialization_thread.WaitForRequests();
+    SaveVulkanPipelineCache(true);
+    SavePipelineUsage();
+}
 
 GraphicsPipeline* PipelineCache::CurrentGraphicsPipeline() {
     MICROPROFILE_SCOPE(Vulkan_PipelineCache);
@@ -371,7 +484,18 @@ ComputePipeline* PipelineCache::CurrentComputePipeline() {
     if (!is_new) {
         return pipeline.get();
     }
-    pipeline = CreateComputePipeline(key, shader);
+    RecordPipelineUsage(key.Hash(), true);
+    auto prewarmed{TakePrewarmed(prewarm_mutex, prewarm_condvar, prewarm_compute, key,
+                                 [&](std::vector<FileEnvironment>& envs) {
+                                     main_pools.ReleaseContents();
+                                     return CreateComputePipeline(main_pools, key, envs.front(),
+                                                                  nullptr, true);
+                                 })};
+    if (prewarmed) {
+        pipeline = std::move(*prewarmed);
+    } else {
+        pipeline = CreateComputePipeline(key, shader);
+    }
     return pipeline.get();
 }
 
@@ -387,39 +511,41 @@ void PipelineCache::LoadDiskResources(u64 title_id, std::stop_token stop_loading
         return;
     }
     pipeline_cache_filename = base_dir / "vulkan.bin";
+    vulkan_pipeline_cache_filename = base_dir / "vulkan_pipelines.bin";
+    pipeline_usage_filename = base_dir / "vulkan_usage.bin";
+    LoadVulkanPipelineCache();
+    LoadPipelineUsage();
 
-    struct {
-        std::mutex mutex;
-        size_t total{};
-        size_t built{};
-        bool has_loaded{};
-        std::unique_ptr<PipelineStatistics> statistics;
-    } state;
+    std::unordered_map<u64, size_t> usage_rank;
+    for (const PipelineUsage& usage : previous_usage) {
+        usage_rank.try_emplace(usage.hash, usage_rank.size());
+    }
+    struct PendingPrewarm {
+        size_t rank;
+        std::variant<GraphicsPipelineCacheKey, ComputePipelineCacheKey> key;
+    };
+    std::vector<PendingPrewarm> pending;
+    const auto rank_of{[&usage_rank](u64 hash) {
+        const auto it{usage_rank.find(hash)};
+        return it != usage_rank.end() ? it->second : std::numeric_limits<size_t>::max();
+    }};
 
     if (device.IsKhrPipelineEexecutablePropertiesEnabled()) {
-        state.statistics = std::make_unique<PipelineStatistics>(device);
+        prewarm_statistics = std::make_unique<PipelineStatistics>(device);
     }
-    const auto load_compute{[&](std::ifstream& file, FileEnvironment env) {
+    const auto load_compute{[&](std::istream& file, FileEnvironment env) {
         ComputePipelineCacheKey key;
         file.read(reinterpret_cast<char*>(&key), sizeof(key));
 
-        workers.QueueWork([this, key, env = std::move(env), &state, &callback]() mutable {
-            ShaderPools pools;
-            auto pipeline{CreateComputePipeline(pools, key, env, state.statistics.get(), false)};
-            std::lock_guard lock{state.mutex};
-            if (pipeline) {
-                compute_cache.emplace(key, std::move(pipeline));
-            }
-            ++state.built;
-            if (state.has_loaded) {
-                callback(VideoCore::LoadCallbackStage::Build, state.built, state.total);
-            }
-        });
-        ++state.total;
+        std::lock_guard lock{prewarm_mutex};
+        auto& entry{prewarm_compute[key]};
+        entry.envs.clear();
+        entry.envs.push_back(std::move(env));
+        pending.push_back({rank_of(key.Hash()), key});
     }};
     const bool extended_dynamic_state = device.IsExtExtendedDynamicStateSupported();
     const bool dynamic_vertex_input = device.IsExtVertexInputDynamicStateSupported();
-    const auto load_graphics{[&](std::ifstream& file, std::vector<FileEnvironment> envs) {
+    const auto load_graphics{[&](std::istream& file, std::vector<FileEnvironment> envs) {
         GraphicsPipelineCacheKey key;
         file.read(reinterpret_cast<char*>(&key), sizeof(key));
 
@@ -427,46 +553,86 @@ void PipelineCache::LoadDiskResources(u64 title_id, std::stop_token stop_loading
             (key.state.dynamic_vertex_input != 0) != dynamic_vertex_input) {
             return;
         }
-        workers.QueueWork([this, key, envs = std::move(envs), &state, &callback]() mutable {
-            ShaderPools pools;
-            boost::container::static_vector<Shader::Environment*, 5> env_ptrs;
-            for (auto& env : envs) {
-                env_ptrs.push_back(&env);
-            }
-            auto pipeline{CreateGraphicsPipeline(pools, key, MakeSpan(env_ptrs),
-                                                 state.statistics.get(), false)};
-
-            std::lock_guard lock{state.mutex};
-            graphics_cache.emplace(key, std::move(pipeline));
-            ++state.built;
-            if (state.has_loaded) {
-                callback(VideoCore::LoadCallbackStage::Build, state.built, state.total);
-            }
-        });
-        ++state.total;
+        std::lock_guard lock{prewarm_mutex};
+        prewarm_graphics[key].envs = std::move(envs);
+        pending.push_back({rank_of(key.Hash()), key});
     }};
     VideoCommon::LoadPipelines(stop_loading, pipeline_cache_filename, CACHE_VERSION, load_compute,
                                load_graphics);
 
-    LOG_INFO(Render_Vulkan, "Total Pipeline Count: {}", state.total);
+    // Build in the order the title needed the pipelines last time, pipelines it did not use keep
+    // the cache order (most recently written first)
+    std::ranges::stable_sort(pending, {}, &PendingPrewarm::rank);
+    prewarm_total = pending.size();
+    const size_t num_ranked{static_cast<size_t>(std::ranges::count_if(
+        pending, [](const PendingPrewarm& item) {
+            return item.rank != std::numeric_limits<size_t>::max();
+        }))};
+    LOG_INFO(Render_Vulkan, "Total Pipeline Count: {}, {} in recorded first use order",
+             prewarm_total, num_ranked);
 
-    std::unique_lock lock{state.mutex};
-    callback(VideoCore::LoadCallbackStage::Build, 0, state.total);
-    state.has_loaded = true;
-    lock.unlock();
+    for (const PendingPrewarm& item : pending) {
+        std::visit([this](const auto& key) { QueuePrewarm(key); }, item.key);
+    }
+    // Loading returns while the workers build, binds that need a pipeline before its turn take it
+    // from the prewarm entries instead of building a duplicate. There is no build progress to
+    // report to the callback, the workers only finish after the title has started.
+    session_start = std::chrono::steady_clock::now();
+    last_usage_save = session_start;
+}
 
-    workers.WaitForRequests();
+void PipelineCache::QueuePrewarm(const GraphicsPipelineCacheKey& key) {
+    workers.QueueWork([this, key] {
+        auto envs{ClaimPrewarm(prewarm_mutex, prewarm_graphics, key)};
+        if (!envs) {
+            FinishPrewarmJob();
+            return;
+        }
+        ShaderPools pools;
+        boost::container::static_vector<Shader::Environment*, 5> env_ptrs;
+        for (auto& env : *envs) {
+            env_ptrs.push_back(&env);
+        }
+        auto pipeline{CreateGraphicsPipeline(pools, key, MakeSpan(env_ptrs),
+                                             prewarm_statistics.get(), false)};
+        FinishPrewarm(prewarm_mutex, prewarm_condvar, prewarm_graphics, key, std::move(pipeline));
+        FinishPrewarmJob();
+    });
+}
 
-    if (state.statistics) {
-        state.statistics->Report();
-    }
+void PipelineCache::QueuePrewarm(const ComputePipelineCacheKey& key) {
+    workers.QueueWork([this, key] {
+        auto envs{ClaimPrewarm(prewarm_mutex, prewarm_compute, key)};
+        if (!envs) {
+            FinishPrewarmJob();
+            return;
+        }
+        ShaderPools pools;
+        auto pipeline{
+            CreateComputePipeline(pools, key, envs->front(), prewarm_statistics.get(), false)};
+        FinishPrewarm(prewarm_mutex, prewarm_condvar, prewarm_compute, key, std::move(pipeline));
+        FinishPrewarmJob();
+    });
 }
 
 GraphicsPipeline* PipelineCache::CurrentGraphicsPipelineSlowPath() {
     const auto [pair, is_new]{graphics_cache.try_emplace(graphics_key)};
     auto& pipeline{pair->second};
     if (is_new) {
-        pipeline = CreateGraphicsPipeline();
+        RecordPipelineUsage(graphics_key.Hash(), false);
+        auto prewarmed{TakePrewarmed(prewarm_mutex, prewarm_condvar, prewarm_graphics,
+                                     graphics_key, [this](std::vector<FileEnvironment>& envs) {
+                                         boost::container::static_vector<Shader::Environment*, 5>
+                                             env_ptrs;
+                                         for (auto& env : envs) {
+                                             env_ptrs.push_back(&env);
+                                         }
+                                         main_pools.ReleaseContents();
+                                         return CreateGraphicsPipeline(main_pools, graphics_key,
+                                                                       MakeSpan(env_ptrs), nullptr,
+                                                                       true);
+                                     })};
+        pipeline = prewarmed ? std::move(*prewarmed) : CreateGraphicsPipeline();
     }
     if (!pipeline) {
         return nullptr;
@@ -504,6 +670,39 @@ std::unique_ptr<GraphicsPipeline> PipelineCache::CreateGraphicsPipeline(
     std::span<Shader::Environment* const> envs, PipelineStatistics* statistics,
     bool build_in_parallel) try {
     LOG_INFO(Render_Vulkan, "0x{:016x}", key.Hash());
+    std::shared_ptr<const SharedPipelineCache::Graphics> translated{shared_cache->Find(key)};
+    if (!translated) {
+        translated = TranslateGraphicsPipeline(pools, key, envs);
+        shared_cache->Insert(key, translated);
+    }
+    std::array<const Shader::Info*, Maxwell::MaxShaderStage> infos{};
+    std::array<vk::ShaderModule, Maxwell::MaxShaderStage> modules;
+    for (size_t stage_index = 0; stage_index < Maxwell::MaxShaderStage; ++stage_index) {
+        if (!translated->infos[stage_index]) {
+            continue;
+        }
+        infos[stage_index] = &*translated->infos[stage_index];
+        modules[stage_index] = BuildShader(device, translated->code[stage_index]);
+        if (device.HasDebuggingToolAttached()) {
+            const u64 unique_hash{key.unique_hashes[stage_index + 1]};
+            const std::string name{fmt::format("Shader {:016x}", unique_hash)};
+            modules[stage_index].SetObjectNameEXT(name.c_str());
+        }
+    }
+    Common::ThreadWorker* const thread_worker{build_in_parallel ? &workers : nullptr};
+    return std::make_unique<GraphicsPipeline>(
+        maxwell3d, gpu_memory, scheduler, buffer_cache, texture_cache, &shader_notify, device,
+        descriptor_pool, update_descriptor_queue, thread_worker, statistics, *vulkan_pipeline_cache,
+        render_pass_cache, key, std::move(modules), infos);
+
+} catch (const Shader::Exception& exception) {
+    LOG_ERROR(Render_Vulkan, "{}", exception.what());
+    return nullptr;
+}
+
+std::shared_ptr<const SharedPipelineCache::Graphics> PipelineCache::TranslateGraphicsPipeline(
+    ShaderPools& pools, const GraphicsPipelineCacheKey& key,
+    std::span<Shader::Environment* const> envs) {
     size_t env_index{0};
     std::array<Shader::IR::Program, Maxwell::MaxShaderProgram> programs;
     const bool uses_vertex_a{key.unique_hashes[0] != 0};
@@ -527,8 +726,7 @@ std::unique_ptr<GraphicsPipeline> PipelineCache::CreateGraphicsPipeline(
             programs[index] = MergeDualVertexPrograms(program_va, program_vb, env);
         }
     }
-    std::array<const Shader::Info*, Maxwell::MaxShaderStage> infos{};
-    std::array<vk::ShaderModule, Maxwell::MaxShaderStage> modules;
+    auto translated{std::make_shared<SharedPipelineCache::Graphics>()};
 
     const Shader::IR::Program* previous_stage{};
     Shader::Backend::Bindings binding;
@@ -541,27 +739,14 @@ std::unique_ptr<GraphicsPipeline> PipelineCache::CreateGraphicsPipeline(
 
         Shader::IR::Program& program{programs[index]};
         const size_t stage_index{index - 1};
-        infos[stage_index] = &program.info;
 
         const auto runtime_info{MakeRuntimeInfo(programs, key, program, previous_stage)};
-        const std::vector<u32> code{EmitSPIRV(profile, runtime_info, program, binding)};
-        device.SaveShader(code);
-        modules[stage_index] = BuildShader(device, code);
-        if (device.HasDebuggingToolAttached()) {
-            const std::string name{fmt::format("Shader {:016x}", key.unique_hashes[index])};
-            modules[stage_index].SetObjectNameEXT(name.c_str());
-        }
+        translated->code[stage_index] = EmitSPIRV(profile, runtime_info, program, binding);
+        translated->infos[stage_index] = program.info;
+        device.SaveShader(translated->code[stage_index]);
         previous_stage = &program;
     }
-    Common::ThreadWorker* const thread_worker{build_in_parallel ? &workers : nullptr};
-    return std::make_unique<GraphicsPipeline>(
-        maxwell3d, gpu_memory, scheduler, buffer_cache, texture_cache, &shader_notify, device,
-        descriptor_pool, update_descriptor_queue, thread_worker, statistics, render_pass_cache, key,
-        std::move(modules), infos);
-
-} catch (const Shader::Exception& exception) {
-    LOG_ERROR(Render_Vulkan, "{}", exception.what());
-    return nullptr;
+    return translated;
 }
 
 std::unique_ptr<GraphicsPipeline> PipelineCache::CreateGraphicsPipeline() {
@@ -583,6 +768,7 @@ std::unique_ptr<GraphicsPipeline> PipelineCache::CreateGraphicsPipeline() {
             }
         }
         SerializePipeline(key, env_ptrs, pipeline_cache_filename, CACHE_VERSION);
+        SaveVulkanPipelineCache(false);
     });
     return pipeline;
 }
@@ -602,6 +788,7 @@ std::unique_ptr<ComputePipeline> PipelineCache::CreateComputePipeline(
     serialization_thread.QueueWork([this, key, env = std::move(env)] {
         SerializePipeline(key, std::array<const GenericEnvironment*, 1>{&env},
                           pipeline_cache_filename, CACHE_VERSION);
+        SaveVulkanPipelineCache(false);
     });
     return pipeline;
 }
@@ -610,24 +797,259 @@ std::unique_ptr<ComputePipeline> PipelineCache::CreateComputePipeline(
     ShaderPools& pools, const ComputePipelineCacheKey& key, Shader::Environment& env,
     PipelineStatistics* statistics, bool build_in_parallel) try {
     LOG_INFO(Render_Vulkan, "0x{:016x}", key.Hash());
-
-    Shader::Maxwell::Flow::CFG cfg{env, pools.flow_block, env.StartAddress()};
-    auto program{TranslateProgram(pools.inst, pools.block, env, cfg, host_info)};
-    const std::vector<u32> code{EmitSPIRV(profile, program)};
-    device.SaveShader(code);
-    vk::ShaderModule spv_module{BuildShader(device, code)};
+    std::shared_ptr<const SharedPipelineCache::Compute> translated{shared_cache->Find(key)};
+    if (!translated) {
+        translated = TranslateComputePipeline(pools, key, env);
+        shared_cache->Insert(key, translated);
+    }
+    vk::ShaderModule spv_module{BuildShader(device, translated->code)};
     if (device.HasDebuggingToolAttached()) {
         const auto name{fmt::format("Shader {:016x}", key.unique_hash)};
         spv_module.SetObjectNameEXT(name.c_str());
     }
     Common::ThreadWorker* const thread_worker{build_in_parallel ? &workers : nullptr};
     return std::make_unique<ComputePipeline>(device, descriptor_pool, update_descriptor_queue,
-                                             thread_worker, statistics, &shader_notify,
-                                             program.info, std::move(spv_module));
+                                             thread_worker, statistics, *vulkan_pipeline_cache,
+                                             &shader_notify, translated->info,
+                                             std::move(spv_module));
 
 } catch (const Shader::Exception& exception) {
     LOG_ERROR(Render_Vulkan, "{}", exception.what());
     return nullptr;
 }
 
+std::shared_ptr<const SharedPipelineCache::Compute> PipelineCache::TranslateComputePipeline(
+    ShaderPools& pools, const ComputePipelineCacheKey& key, Shader::Environment& env) {
+    Shader::Maxwell::Flow::CFG cfg{env, pools.flow_block, env.StartAddress()};
+    auto program{TranslateProgram(pools.inst, pools.block, env, cfg, host_info)};
+    auto translated{std::make_shared<SharedPipelineCache::Compute>()};
+    translated->code = EmitSPIRV(profile, program);
+    translated->info = program.info;
+    device.SaveShader(translated->code);
+    return translated;
+}
+
+std::shared_ptr<SharedPipelineCache> SharedPipelineCache::Acquire(u64 device_fingerprint) {
+    static std::mutex instances_mutex;
+    static std::unordered_map<u64, std::weak_ptr<SharedPipelineCache>> instances;
+
+    std::scoped_lock lock{instances_mutex};
+    std::erase_if(instances, [](const auto& pair) { return pair.second.expired(); });
+    std::weak_ptr<SharedPipelineCache>& instance{instances[device_fingerprint]};
+    std::shared_ptr<SharedPipelineCache> shared{instance.lock()};
+    if (!shared) {
+        shared = std::make_shared<SharedPipelineCache>();
+        instance = shared;
+    }
+    return shared;
+}
+
+std::shared_ptr<const SharedPipelineCache::Graphics> SharedPipelineCache::Find(
+    const GraphicsPipelineCacheKey& key) const {
+    std::shared_lock lock{mutex};
+    const auto it{graphics.find(key)};
+    return it != graphics.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<const SharedPipelineCache::Compute> SharedPipelineCache::Find(
+    const ComputePipelineCacheKey& key) const {
+    std::shared_lock lock{mutex};
+    const auto it{compute.find(key)};
+    return it != compute.end() ? it->second : nullptr;
+}
+
+void SharedPipelineCache::Insert(const GraphicsPipelineCacheKey& key,
+                                 std::shared_ptr<const Graphics> entry) {
+    std::unique_lock lock{mutex};
+    graphics.try_emplace(key, std::move(entry));
+}
+
+void SharedPipelineCache::Insert(const ComputePipelineCacheKey& key,
+                                 std::shared_ptr<const Compute> entry) {
+    std::unique_lock lock{mutex};
+    compute.try_emplace(key, std::move(entry));
+}
+
+void PipelineCache::LoadVulkanPipelineCache() {
+    const VulkanCacheHeader expected_header{MakeVulkanCacheHeader(device)};
+    std::vector<u8> initial_data;
+    try {
+        std::ifstream file(vulkan_pipeline_cache_filename, std::ios::binary | std::ios::ate);
+        if (file.is_open()) {
+            file.exceptions(std::ifstream::failbit);
+            const auto end{file.tellg()};
+            file.seekg(0, std::ios::beg);
+
+            VulkanCacheHeader header;
+            file.read(reinterpret_cast<char*>(&header), sizeof(header));
+            if (header == expected_header) {
+                initial_data.resize(static_cast<size_t>(end) - sizeof(header));
+                file.read(reinterpret_cast<char*>(initial_data.data()), initial_data.size());
+            } else {
+                LOG_INFO(Render_Vulkan, "Discarding Vulkan pipeline cache from another driver");
+            }
+        }
+    } catch (const std::ios_base::failure& e) {
+        LOG_ERROR(Common_Filesystem, "{}", e.what());
+        initial_data.clear();
+    }
+    const auto create{[this](std::span<const u8> data) {
+        return device.GetLogical().CreatePipelineCache({
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .initialDataSize = data.size(),
+            .pInitialData = data.data(),
+        });
+    }};
+    try {
+        vulkan_pipeline_cache = create(initial_data);
+    } catch (const vk::Exception& exception) {
+        LOG_ERROR(Render_Vulkan, "Driver rejected the pipeline cache: {}", exception.what());
+        vulkan_pipeline_cache = create({});
+    }
+    last_vulkan_cache_save = std::chrono::steady_clock::now();
+    LOG_INFO(Render_Vulkan, "Loaded {} bytes of Vulkan pipeline cache", initial_data.size());
+}
+
+void PipelineCache::SaveVulkanPipelineCache(bool force) {
+    if (!vulkan_pipeline_cache) {
+        return;
+    }
+    const auto now{std::chrono::steady_clock::now()};
+    if (!force && now - last_vulkan_cache_save < VULKAN_CACHE_SAVE_INTERVAL) {
+        return;
+    }
+    last_vulkan_cache_save = now;
+
+    // Write to a temporary file first so a crash mid-write never leaves a truncated cache behind
+    auto temp_filename{vulkan_pipeline_cache_filename};
+    temp_filename += ".tmp";
+    try {
+        const std::vector<u8> data{vulkan_pipeline_cache.GetData()};
+        const VulkanCacheHeader header{MakeVulkanCacheHeader(device)};
+        std::ofstream file(temp_filename, std::ios::binary | std::ios::trunc);
+        file.exceptions(std::ofstream::failbit);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header))
+            .write(reinterpret_cast<const char*>(data.data()), data.size());
+    } catch (const vk::Exception& exception) {
+        LOG_ERROR(Render_Vulkan, "Failed to read Vulkan pipeline cache: {}", exception.what());
+        return;
+    } catch (const std::ios_base::failure& e) {
+        LOG_ERROR(Common_Filesystem, "{}", e.what());
+        Common::FS::RemoveFile(temp_filename);
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_filename, vulkan_pipeline_cache_filename, ec);
+    if (ec) {
+        LOG_ERROR(Common_Filesystem, "Failed to replace Vulkan pipeline cache {}: {}",
+                  Common::FS::PathToUTF8String(vulkan_pipeline_cache_filename), ec.message());
+    }
+}
+
+void PipelineCache::FinishPrewarmJob() {
+    if (++prewarm_built != prewarm_total || prewarm_cancelled) {
+        return;
+    }
+    serialization_thread.QueueWork([this] { SaveVulkanPipelineCache(true); });
+    if (prewarm_statistics) {
+        prewarm_statistics->Report();
+    }
+}
+
+void PipelineCache::RecordPipelineUsage(u64 hash, bool is_compute) {
+    if (pipeline_usage_filename.empty()) {
+        return;
+    }
+    const auto now{std::chrono::steady_clock::now()};
+    const auto first_use{
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - session_start).count()};
+    std::lock_guard lock{usage_mutex};
+    if (session_usage.size() >= MAX_USAGE_RECORDS) {
+        return;
+    }
+    session_usage.push_back({
+        .hash = hash,
+        .first_use_ms = static_cast<u32>(std::min<s64>(first_use, std::numeric_limits<u32>::max())),
+        .is_compute = is_compute ? 1U : 0U,
+    });
+    if (now - last_usage_save >= USAGE_SAVE_INTERVAL) {
+        last_usage_save = now;
+        serialization_thread.QueueWork([this] { SavePipelineUsage(); });
+    }
+}
+
+void PipelineCache::LoadPipelineUsage() {
+    previous_usage.clear();
+    try {
+        std::ifstream file(pipeline_usage_filename, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            return;
+        }
+        file.exceptions(std::ifstream::failbit);
+        const size_t size{static_cast<size_t>(file.tellg())};
+        file.seekg(0, std::ios::beg);
+
+        std::array<char, 8> magic_number;
+        file.read(magic_number.data(), magic_number.size());
+        const size_t num_records{(size - magic_number.size()) / sizeof(PipelineUsage)};
+        if (magic_number != USAGE_MAGIC_NUMBER || num_records > MAX_USAGE_RECORDS) {
+            LOG_INFO(Render_Vulkan, "Discarding invalid pipeline usage file");
+            return;
+        }
+        previous_usage.resize(num_records);
+        file.read(reinterpret_cast<char*>(previous_usage.data()),
+                  num_records * sizeof(PipelineUsage));
+    } catch (const std::ios_base::failure& e) {
+        LOG_ERROR(Common_Filesystem, "{}", e.what());
+        previous_usage.clear();
+    }
+}
+
+void PipelineCache::SavePipelineUsage() {
+    if (pipeline_usage_filename.empty()) {
+        return;
+    }
+    std::vector<PipelineUsage> usage;
+    {
+        std::lock_guard lock{usage_mutex};
+        usage = session_usage;
+    }
+    if (usage.empty()) {
+        return;
+    }
+    std::unordered_set<u64> seen;
+    for (const PipelineUsage& record : usage) {
+        seen.insert(record.hash);
+    }
+    for (const PipelineUsage& record : previous_usage) {
+        if (usage.size() >= MAX_USAGE_RECORDS) {
+            break;
+        }
+        if (seen.insert(record.hash).second) {
+            usage.push_back(record);
+        }
+    }
+    auto temp_filename{pipeline_usage_filename};
+    temp_filename += ".tmp";
+    try {
+        std::ofstream file(temp_filename, std::ios::binary | std::ios::trunc);
+        file.exceptions(std::ofstream::failbit);
+        file.write(USAGE_MAGIC_NUMBER.data(), USAGE_MAGIC_NUMBER.size())
+            .write(reinterpret_cast<const char*>(usage.data()),
+                   usage.size() * sizeof(PipelineUsage));
+    } catch (const std::ios_base::failure& e) {
+        LOG_ERROR(Common_Filesystem, "{}", e.what());
+        Common::FS::RemoveFile(temp_filename);
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_filename, pipeline_usage_filename, ec);
+    if (ec) {
+        LOG_ERROR(Common_Filesystem, "Failed to replace pipeline usage file {}: {}",
+                  Common::FS::PathToUTF8String(pipeline_usage_filename), ec.message());
+    }
+}
+
 } // namespace Vulkan
@@ -7,10 +7,16 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <filesystem>
 #include <iosfwd>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -31,6 +37,7 @@
 #include "video_core/renderer_vulkan/vk_graphics_pipeline.h"
 #include "video_core/renderer_vulkan/vk_texture_cache.h"
 #include "video_core/shader_cache.h"
+#include "video_core/shader_environment.h"
 #include "video_core/vulkan_common/vulkan_wrapper.h"
 
 namespace Core {
@@ -104,6 +111,63 @@ struct ShaderPools {
     Shader::ObjectPool<Shader::Maxwell::Flow::Block> flow_block;
 };
 
+/**
+ * Translated shaders shared by every pipeline cache of the process created on the same device and
+ * driver. A title running twice, or relaunched while another instance is alive, reuses the SPIR-V
+ * and shader info of pipelines the other instances already built instead of recompiling their
+ * Maxwell shaders. Host pipeline objects are not shared, each GPU instance owns its own VkDevice.
+ * The cache is released when its last user is destroyed.
+ */
+class SharedPipelineCache {
+public:
+    struct Graphics {
+        std::array<std::vector<u32>, Maxwell::MaxShaderStage> code;
+        std::array<std::optional<Shader::Info>, Maxwell::MaxShaderStage> infos;
+    };
+
+    struct Compute {
+        std::vector<u32> code;
+        Shader::Info info;
+    };
+
+    /// Returns the cache shared by the users of a device, creating it for the first one
+    [[nodiscard]] static std::shared_ptr<SharedPipelineCache> Acquire(u64 device_fingerprint);
+
+    [[nodiscard]] std::shared_ptr<const Graphics> Find(const GraphicsPipelineCacheKey& key) const;
+    [[nodiscard]] std::shared_ptr<const Compute> Find(const ComputePipelineCacheKey& key) const;
+
+    void Insert(const GraphicsPipelineCacheKey& key, std::shared_ptr<const Graphics> entry);
+    void Insert(const ComputePipelineCacheKey& key, std::shared_ptr<const Compute> entry);
+
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<GraphicsPipelineCacheKey, std::shared_ptr<const Graphics>> graphics;
+    std::unordered_map<ComputePipelineCacheKey, std::shared_ptr<const Compute>> compute;
+};
+
+/// First use of a pipeline during a session, recorded to prewarm pipelines in the order a title
+/// needs them on its next launch
+struct PipelineUsage {
+    u64 hash;
+    u32 first_use_ms;
+    u32 is_compute;
+};
+static_assert(std::has_unique_object_representations_v<PipelineUsage>);
+
+enum class PrewarmState {
+    Queued,
+    Building,
+    Built,
+};
+
+/// Pipeline loaded from disk that has not been bound yet, either waiting for a worker or built
+template <typename Pipeline>
+struct PrewarmEntry {
+    PrewarmState state{PrewarmState::Queued};
+    std::vector<VideoCommon::FileEnvironment> envs;
+    std::unique_ptr<Pipeline> pipeline;
+};
+
 class PipelineCache : public VideoCommon::ShaderCache {
 public:
     explicit PipelineCache(RasterizerVulkan& rasterizer, Tegra::Engines::Maxwell3D& maxwell3d,
@@ -143,6 +207,36 @@ private:
                                                            PipelineStatistics* statistics,
                                                            bool build_in_parallel);
 
+    /// Translates the Maxwell shaders of a pipeline to SPIR-V
+    std::shared_ptr<const SharedPipelineCache::Graphics> TranslateGraphicsPipeline(
+        ShaderPools& pools, const GraphicsPipelineCacheKey& key,
+        std::span<Shader::Environment* const> envs);
+
+    std::shared_ptr<const SharedPipelineCache::Compute> TranslateComputePipeline(
+        ShaderPools& pools, const ComputePipelineCacheKey& key, Shader::Environment& env);
+
+    /// Creates the driver pipeline cache, seeded from disk when the stored blob matches the device
+    void LoadVulkanPipelineCache();
+
+    /// Writes the driver pipeline cache to disk, at most once per interval unless forced
+    void SaveVulkanPipelineCache(bool force);
+
+    /// Queues a pipeline loaded from disk to be built by the workers
+    void QueuePrewarm(const GraphicsPipelineCacheKey& key);
+    void QueuePrewarm(const ComputePipelineCacheKey& key);
+
+    /// Counts a finished prewarm job, saving the driver cache once all of them are done
+    void FinishPrewarmJob();
+
+    /// Records the first time a pipeline is bound in this session
+    void RecordPipelineUsage(u64 hash, bool is_compute);
+
+    /// Reads the first use order recorded in the previous sessions
+    void LoadPipelineUsage();
+
+    /// Writes this session's first use order, followed by the pipelines only used before
+    void SavePipelineUsage();
+
     const Device& device;
     VKScheduler& scheduler;
     DescriptorPool& descriptor_pool;
@@ -164,8 +258,30 @@ private:
     Shader::Profile profile;
     Shader::HostTranslateInfo host_info;
 
+    std::shared_ptr<SharedPipelineCache> shared_cache;
+
     std::filesystem::path pipeline_cache_filename;
 
+    std::filesystem::path vulkan_pipeline_cache_filename;
+    vk::PipelineCache vulkan_pipeline_cache;
+    std::chrono::steady_clock::time_point last_vulkan_cache_save{};
+
+    std::mutex prewarm_mutex;
+    std::condition_variable prewarm_condvar;
+    std::unordered_map<GraphicsPipelineCacheKey, PrewarmEntry<GraphicsPipeline>> prewarm_graphics;
+    std::unordered_map<ComputePipelineCacheKey, PrewarmEntry<ComputePipeline>> prewarm_compute;
+    std::unique_ptr<PipelineStatistics> prewarm_statistics;
+    std::atomic<size_t> prewarm_built{};
+    size_t prewarm_total{};
+    std::atomic_bool prewarm_cancelled{};
+
+    std::filesystem::path pipeline_usage_filename;
+    std::mutex usage_mutex;
+    std::vector<PipelineUsage> previous_usage;
+    std::vector<PipelineUsage> session_usage;
+    std::chrono::steady_clock::time_point session_start{};
+    std::chrono::steady_clock::time_point last_usage_save{};
+
     Common::ThreadWorker workers;
     Common::ThreadWorker serialization_thread;
 };
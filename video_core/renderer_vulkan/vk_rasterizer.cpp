@@ -510,6 +510,14 @@ void RasterizerVulkan::LoadDiskResources(u64 title_id, std::stop_token stop_load
     pipeline_cache.LoadDiskResources(title_id, stop_loading, callback);
 }
 
+VideoCore::MemoryUsage RasterizerVulkan::GetMemoryUsage() {
+    VideoCore::MemoryUsage usage{RasterizerAccelerated::GetMemoryUsage()};
+    std::scoped_lock lock{texture_cache.mutex, buffer_cache.mutex};
+    usage.buffer_page_table = buffer_cache.PageTableMemoryUsage();
+    usage.texture_page_tables = texture_cache.PageTableMemoryUsage();
+    return usage;
+}
+
 void RasterizerVulkan::FlushWork() {
     static constexpr u32 DRAWS_TO_DISPATCH = 4096;
 
@@ -101,6 +101,7 @@ public:
                            u32 pixel_stride) override;
     void LoadDiskResources(u64 title_id, std::stop_token stop_loading,
                            const VideoCore::DiskResourceLoadCallback& callback) override;
+    VideoCore::MemoryUsage GetMemoryUsage() override;
 
 private:
     static constexpr size_t MAX_TEXTURES = 192;
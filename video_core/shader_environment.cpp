@@ -5,18 +5,32 @@
 // Adapted by Kent Hall for mizu on Horizon Linux.
 
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <istream>
 #include <memory>
 #include <optional>
+#include <sstream>
+#include <streambuf>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "common/assert.h"
 #include "common/cityhash.h"
 #include "common/common_types.h"
 #include "common/div_ceil.h"
 #include "common/fs/fs.h"
+#include "common/literals.h"
 #include "common/logging/log.h"
+#include "common/zstd_compression.h"
 #include "shader_recompiler/environment.h"
 #include "video_core/engines/kepler_compute.h"
 #include "video_core/memory_manager.h"
@@ -25,12 +39,208 @@
 
 namespace VideoCommon {
 
-constexpr std::array<char, 8> MAGIC_NUMBER{'y', 'u', 'z', 'u', 'c', 'a', 'c', 'h'};
+using namespace Common::Literals;
+
+constexpr std::array<char, 8> MAGIC_NUMBER{'m', 'i', 'z', 'u', 'c', 'a', 'c', 'h'};
+constexpr std::array<char, 8> OLD_MAGIC_NUMBER{'y', 'u', 'z', 'u', 'c', 'a', 'c', 'h'};
+constexpr u32 FORMAT_VERSION = 1;
+constexpr u32 ENTRY_MAGIC = 0x5952544E; // "NTRY"
+constexpr size_t MAX_ENTRY_SIZE = 64_MiB;
+constexpr u32 MAX_ENVIRONMENTS = 5;
 
 constexpr size_t INST_SIZE = sizeof(u64);
 
 using Maxwell = Tegra::Engines::Maxwell3D::Regs;
 
+namespace {
+struct CacheFileHeader {
+    std::array<char, 8> magic;
+    u32 format_version;
+    u32 reserved;
+};
+static_assert(sizeof(CacheFileHeader) == 16);
+
+/// Every entry is self delimiting: the header is followed by the raw pipeline key and the
+/// compressed environments. The entry headers double as the index of the file.
+struct CacheEntryHeader {
+    u32 magic;
+    u32 cache_version;
+    u32 key_size;
+    u32 compressed_size;
+    u32 uncompressed_size;
+    u32 reserved;
+    u64 timestamp;
+    u64 checksum;
+};
+static_assert(sizeof(CacheEntryHeader) == 40);
+
+struct CacheEntry {
+    CacheEntryHeader header;
+    std::span<const u8> key;
+    std::span<const u8> payload;
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return sizeof(CacheEntryHeader) + key.size() + payload.size();
+    }
+};
+
+struct CacheScan {
+    std::vector<CacheEntry> entries;
+    size_t valid_size{};
+    size_t num_corrupted{};
+};
+
+/// Read-only memory mapping of a whole pipeline cache file
+class MappedCacheFile {
+public:
+    explicit MappedCacheFile(const std::filesystem::path& filename) {
+        const int fd{::open(filename.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (fd == -1) {
+            return;
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* const addr{::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)};
+            if (addr != MAP_FAILED) {
+                data = std::span(static_cast<const u8*>(addr), static_cast<size_t>(st.st_size));
+                ::madvise(addr, data.size(), MADV_WILLNEED);
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedCacheFile() {
+        if (!data.empty()) {
+            ::munmap(const_cast<u8*>(data.data()), data.size());
+        }
+    }
+
+    MappedCacheFile(const MappedCacheFile&) = delete;
+    MappedCacheFile& operator=(const MappedCacheFile&) = delete;
+
+    [[nodiscard]] std::span<const u8> Data() const noexcept {
+        return data;
+    }
+
+private:
+    std::span<const u8> data;
+};
+
+/// Input stream buffer reading directly from memory, without copying it
+class SpanStreamBuf final : public std::streambuf {
+public:
+    explicit SpanStreamBuf(std::span<const u8> data) {
+        char* const begin{const_cast<char*>(reinterpret_cast<const char*>(data.data()))};
+        setg(begin, begin, begin + data.size());
+    }
+};
+
+u64 CurrentTimestamp() {
+    const auto now{std::chrono::system_clock::now().time_since_epoch()};
+    return static_cast<u64>(std::chrono::duration_cast<std::chrono::seconds>(now).count());
+}
+
+u64 EntryChecksum(std::span<const u8> key_and_payload) {
+    return Common::CityHash64(reinterpret_cast<const char*>(key_and_payload.data()),
+                              key_and_payload.size());
+}
+
+/// Appends the valid entries of a mapped cache file to the scan, in file order.
+/// Returns false when the file header is invalid.
+bool ScanCacheFile(std::span<const u8> file, CacheScan& scan) {
+    CacheFileHeader file_header;
+    if (file.size() < sizeof(file_header)) {
+        return false;
+    }
+    std::memcpy(&file_header, file.data(), sizeof(file_header));
+    if (file_header.magic != MAGIC_NUMBER || file_header.format_version != FORMAT_VERSION) {
+        return false;
+    }
+    size_t offset{sizeof(file_header)};
+    while (file.size() - offset >= sizeof(CacheEntryHeader)) {
+        CacheEntryHeader header;
+        std::memcpy(&header, file.data() + offset, sizeof(header));
+        const size_t body_size{static_cast<size_t>(header.key_size) + header.compressed_size};
+        if (header.magic != ENTRY_MAGIC || header.uncompressed_size > MAX_ENTRY_SIZE ||
+            body_size > MAX_ENTRY_SIZE ||
+            body_size > file.size() - offset - sizeof(CacheEntryHeader)) {
+            // Truncated or garbage tail, nothing past this point can be trusted
+            break;
+        }
+        const auto body{file.subspan(offset + sizeof(CacheEntryHeader), body_size)};
+        offset += sizeof(CacheEntryHeader) + body_size;
+        if (EntryChecksum(body) != header.checksum) {
+            ++scan.num_corrupted;
+            continue;
+        }
+        scan.entries.push_back({
+            .header = header,
+            .key = body.first(header.key_size),
+            .payload = body.subspan(header.key_size),
+        });
+    }
+    if (offset != file.size()) {
+        ++scan.num_corrupted;
+    }
+    scan.valid_size = offset;
+    return true;
+}
+
+/// Filters the entries matching a cache version, removes duplicated keys keeping their most
+/// recent copy, and sorts them from most to least recently written.
+std::vector<CacheEntry> SelectEntries(std::span<const CacheEntry> scanned, u32 cache_version) {
+    std::vector<CacheEntry> entries;
+    entries.reserve(scanned.size());
+    std::unordered_map<std::string_view, size_t> key_to_index;
+    // Later entries win ties, they were appended after the ones before them
+    for (const CacheEntry& entry : scanned) {
+        if (entry.header.cache_version != cache_version) {
+            continue;
+        }
+        const std::string_view key(reinterpret_cast<const char*>(entry.key.data()),
+                                   entry.key.size());
+        const auto [it, is_new]{key_to_index.try_emplace(key, entries.size())};
+        if (is_new) {
+            entries.push_back(entry);
+        } else if (entry.header.timestamp >= entries[it->second].header.timestamp) {
+            entries[it->second] = entry;
+        }
+    }
+    std::ranges::stable_sort(entries, std::ranges::greater{},
+                             [](const CacheEntry& entry) { return entry.header.timestamp; });
+    return entries;
+}
+
+/// Writes a compacted cache file, oldest entries first so appending keeps the file chronological.
+/// The file is replaced atomically.
+bool WriteCacheFile(std::span<const CacheEntry> entries, const std::filesystem::path& filename) {
+    auto temp_filename{filename};
+    temp_filename += ".tmp";
+    try {
+        std::ofstream file(temp_filename, std::ios::binary | std::ios::trunc);
+        file.exceptions(std::ofstream::failbit);
+        const CacheFileHeader file_header{MAGIC_NUMBER, FORMAT_VERSION, 0};
+        file.write(reinterpret_cast<const char*>(&file_header), sizeof(file_header));
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+            file.write(reinterpret_cast<const char*>(&it->header), sizeof(it->header))
+                .write(reinterpret_cast<const char*>(it->key.data()), it->key.size())
+                .write(reinterpret_cast<const char*>(it->payload.data()), it->payload.size());
+        }
+    } catch (const std::ios_base::failure& e) {
+        LOG_ERROR(Common_Filesystem, "{}", e.what());
+        Common::FS::RemoveFile(temp_filename);
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_filename, filename, ec);
+    if (ec) {
+        Common::FS::RemoveFile(temp_filename);
+        return false;
+    }
+    return true;
+}
+} // Anonymous namespace
+
 static u64 MakeCbufKey(u32 index, u32 offset) {
     return (static_cast<u64>(index) << 32) | offset;
 }
@@ -130,7 +340,7 @@ u64 GenericEnvironment::CalculateHash() const {
     return Common::CityHash64(data.get(), size);
 }
 
-void GenericEnvironment::Serialize(std::ofstream& file) const {
+void GenericEnvironment::Serialize(std::ostream& file) const {
     const u64 code_size{static_cast<u64>(CachedSize())};
     const u64 num_texture_types{static_cast<u64>(texture_types.size())};
     const u64 num_cbuf_values{static_cast<u64>(cbuf_values.size())};
@@ -293,7 +503,7 @@ Shader::TextureType ComputeEnvironment::ReadTextureType(u32 handle) {
     return ReadTextureTypeImpl(regs.tic.Address(), regs.tic.limit, qmd.linked_tsc != 0, handle);
 }
 
-void FileEnvironment::Deserialize(std::ifstream& file) {
+void FileEnvironment::Deserialize(std::istream& file) {
     u64 code_size{};
     u64 num_texture_types{};
     u64 num_cbuf_values{};
@@ -374,6 +584,39 @@ std::array<u32, 3> FileEnvironment::WorkgroupSize() const {
 
 void SerializePipeline(std::span<const char> key, std::span<const GenericEnvironment* const> envs,
                        const std::filesystem::path& filename, u32 cache_version) try {
+    if (!std::ranges::all_of(envs, &GenericEnvironment::CanBeSerialized)) {
+        return;
+    }
+    std::ostringstream payload_stream(std::ios::binary);
+    payload_stream.exceptions(std::ios::failbit);
+    const u32 num_envs{static_cast<u32>(envs.size())};
+    payload_stream.write(reinterpret_cast<const char*>(&num_envs), sizeof(num_envs));
+    for (const GenericEnvironment* const env : envs) {
+        env->Serialize(payload_stream);
+    }
+    const std::string payload{std::move(payload_stream).str()};
+    const std::vector<u8> compressed{Common::Compression::CompressDataZSTDDefault(
+        reinterpret_cast<const u8*>(payload.data()), payload.size())};
+    if (compressed.empty()) {
+        LOG_ERROR(Common_Filesystem, "Failed to compress pipeline cache entry");
+        return;
+    }
+    std::vector<u8> entry(sizeof(CacheEntryHeader) + key.size_bytes() + compressed.size());
+    std::memcpy(entry.data() + sizeof(CacheEntryHeader), key.data(), key.size_bytes());
+    std::memcpy(entry.data() + sizeof(CacheEntryHeader) + key.size_bytes(), compressed.data(),
+                compressed.size());
+    const CacheEntryHeader header{
+        .magic = ENTRY_MAGIC,
+        .cache_version = cache_version,
+        .key_size = static_cast<u32>(key.size_bytes()),
+        .compressed_size = static_cast<u32>(compressed.size()),
+        .uncompressed_size = static_cast<u32>(payload.size()),
+        .reserved = 0,
+        .timestamp = CurrentTimestamp(),
+        .checksum = EntryChecksum(std::span(entry).subspan(sizeof(CacheEntryHeader))),
+    };
+    std::memcpy(entry.data(), &header, sizeof(header));
+
     std::ofstream file(filename, std::ios::binary | std::ios::ate | std::ios::app);
     file.exceptions(std::ifstream::failbit);
     if (!file.is_open()) {
@@ -382,19 +625,11 @@ void SerializePipeline(std::span<const char> key, std::span<const GenericEnviron
         return;
     }
     if (file.tellp() == 0) {
-        // Write header
-        file.write(MAGIC_NUMBER.data(), MAGIC_NUMBER.size())
-            .write(reinterpret_cast<const char*>(&cache_version), sizeof(cache_version));
-    }
-    if (!std::ranges::all_of(envs, &GenericEnvironment::CanBeSerialized)) {
-        return;
-    }
-    const u32 num_envs{static_cast<u32>(envs.size())};
-    file.write(reinterpret_cast<const char*>(&num_envs), sizeof(num_envs));
-    for (const GenericEnvironment* const env : envs) {
-        env->Serialize(file);
+        const CacheFileHeader file_header{MAGIC_NUMBER, FORMAT_VERSION, 0};
+        file.write(reinterpret_cast<const char*>(&file_header), sizeof(file_header));
     }
-    file.write(key.data(), key.size_bytes());
+    // Write the whole entry at once, an interrupted write only leaves a truncated tail behind
+    file.write(reinterpret_cast<const char*>(entry.data()), entry.size());
 
 } catch (const std::ios_base::failure& e) {
     LOG_ERROR(Common_Filesystem, "{}", e.what());
@@ -406,28 +641,22 @@ void SerializePipeline(std::span<const char> key, std::span<const GenericEnviron
 
 void LoadPipelines(
     std::stop_token stop_loading, const std::filesystem::path& filename, u32 expected_cache_version,
-    Common::UniqueFunction<void, std::ifstream&, FileEnvironment> load_compute,
-    Common::UniqueFunction<void, std::ifstream&, std::vector<FileEnvironment>> load_graphics) try {
-    std::ifstream file(filename, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
+    Common::UniqueFunction<void, std::istream&, FileEnvironment> load_compute,
+    Common::UniqueFunction<void, std::istream&, std::vector<FileEnvironment>> load_graphics) {
+    const MappedCacheFile mapped(filename);
+    if (mapped.Data().empty()) {
         return;
     }
-    file.exceptions(std::ifstream::failbit);
-    const auto end{file.tellg()};
-    file.seekg(0, std::ios::beg);
-
-    std::array<char, 8> magic_number;
-    u32 cache_version;
-    file.read(magic_number.data(), magic_number.size())
-        .read(reinterpret_cast<char*>(&cache_version), sizeof(cache_version));
-    if (magic_number != MAGIC_NUMBER || cache_version != expected_cache_version) {
-        file.close();
+    CacheScan scan;
+    if (!ScanCacheFile(mapped.Data(), scan)) {
+        const bool is_old_format{mapped.Data().size() >= OLD_MAGIC_NUMBER.size() &&
+                                 std::memcmp(mapped.Data().data(), OLD_MAGIC_NUMBER.data(),
+                                             OLD_MAGIC_NUMBER.size()) == 0};
         if (Common::FS::RemoveFile(filename)) {
-            if (magic_number != MAGIC_NUMBER) {
-                LOG_ERROR(Common_Filesystem, "Invalid pipeline cache file");
-            }
-            if (cache_version != expected_cache_version) {
+            if (is_old_format) {
                 LOG_INFO(Common_Filesystem, "Deleting old pipeline cache");
+            } else {
+                LOG_ERROR(Common_Filesystem, "Invalid pipeline cache file");
             }
         } else {
             LOG_ERROR(Common_Filesystem,
@@ -436,29 +665,100 @@ void LoadPipelines(
         }
         return;
     }
-    while (file.tellg() != end) {
+    const std::vector<CacheEntry> entries{SelectEntries(scan.entries, expected_cache_version)};
+
+    size_t num_failed{};
+    for (const CacheEntry& entry : entries) {
         if (stop_loading.stop_requested()) {
             return;
         }
-        u32 num_envs{};
-        file.read(reinterpret_cast<char*>(&num_envs), sizeof(num_envs));
-        std::vector<FileEnvironment> envs(num_envs);
-        for (FileEnvironment& env : envs) {
-            env.Deserialize(file);
+        try {
+            const std::vector<u8> payload{Common::Compression::DecompressDataZSTD(entry.payload)};
+            if (payload.size() != entry.header.uncompressed_size) {
+                ++num_failed;
+                continue;
+            }
+            SpanStreamBuf payload_buf(payload);
+            std::istream payload_stream(&payload_buf);
+            payload_stream.exceptions(std::ios::failbit);
+
+            u32 num_envs{};
+            payload_stream.read(reinterpret_cast<char*>(&num_envs), sizeof(num_envs));
+            if (num_envs == 0 || num_envs > MAX_ENVIRONMENTS) {
+                ++num_failed;
+                continue;
+            }
+            std::vector<FileEnvironment> envs(num_envs);
+            for (FileEnvironment& env : envs) {
+                env.Deserialize(payload_stream);
+            }
+            SpanStreamBuf key_buf(entry.key);
+            std::istream key_stream(&key_buf);
+            key_stream.exceptions(std::ios::failbit);
+            if (envs.front().ShaderStage() == Shader::Stage::Compute) {
+                load_compute(key_stream, std::move(envs.front()));
+            } else {
+                load_graphics(key_stream, std::move(envs));
+            }
+        } catch (const std::ios_base::failure& e) {
+            LOG_ERROR(Common_Filesystem, "Skipping pipeline cache entry: {}", e.what());
+            ++num_failed;
         }
-        if (envs.front().ShaderStage() == Shader::Stage::Compute) {
-            load_compute(file, std::move(envs.front()));
-        } else {
-            load_graphics(file, std::move(envs));
+    }
+    if (scan.num_corrupted > 0 || num_failed > 0) {
+        LOG_WARNING(Common_Filesystem, "Skipped {} corrupted pipeline cache entries",
+                    scan.num_corrupted + num_failed);
+    }
+
+    // Rewrite the file when its tail is unreadable, so new entries are not appended after garbage,
+    // or when most of it is taken by stale entries
+    size_t live_size{sizeof(CacheFileHeader)};
+    for (const CacheEntry& entry : entries) {
+        live_size += entry.Size();
+    }
+    const bool has_bad_tail{scan.valid_size != mapped.Data().size()};
+    if (has_bad_tail || live_size < scan.valid_size / 2) {
+        LOG_INFO(Common_Filesystem, "Compacting pipeline cache from {} to {} bytes",
+                 mapped.Data().size(), live_size);
+        if (!WriteCacheFile(entries, filename)) {
+            LOG_ERROR(Common_Filesystem, "Failed to compact pipeline cache file {}",
+                      Common::FS::PathToUTF8String(filename));
         }
     }
+}
 
-} catch (const std::ios_base::failure& e) {
-    LOG_ERROR(Common_Filesystem, "{}", e.what());
-    if (!Common::FS::RemoveFile(filename)) {
-        LOG_ERROR(Common_Filesystem, "Failed to delete pipeline cache file {}",
-                  Common::FS::PathToUTF8String(filename));
+std::optional<size_t> MergePipelineCaches(std::span<const std::filesystem::path> inputs,
+                                          const std::filesystem::path& output) {
+    std::vector<std::unique_ptr<MappedCacheFile>> mapped_files;
+    CacheScan scan;
+    for (const std::filesystem::path& input : inputs) {
+        auto& mapped{*mapped_files.emplace_back(std::make_unique<MappedCacheFile>(input))};
+        if (mapped.Data().empty() || !ScanCacheFile(mapped.Data(), scan)) {
+            LOG_ERROR(Common_Filesystem, "Invalid pipeline cache file {}",
+                      Common::FS::PathToUTF8String(input));
+            return std::nullopt;
+        }
+    }
+    if (scan.entries.empty()) {
+        LOG_ERROR(Common_Filesystem, "No pipelines to merge");
+        return std::nullopt;
+    }
+    const u32 cache_version{
+        std::ranges::max_element(scan.entries, {}, [](const CacheEntry& entry) {
+            return entry.header.cache_version;
+        })->header.cache_version};
+    const std::vector<CacheEntry> entries{SelectEntries(scan.entries, cache_version)};
+    if (!WriteCacheFile(entries, output)) {
+        LOG_ERROR(Common_Filesystem, "Failed to write pipeline cache file {}",
+                  Common::FS::PathToUTF8String(output));
+        return std::nullopt;
     }
+    LOG_INFO(Common_Filesystem,
+             "Merged {} pipelines with cache version {}, dropped {} duplicated, stale or corrupted "
+             "entries",
+             entries.size(), cache_version,
+             scan.entries.size() - entries.size() + scan.num_corrupted);
+    return entries.size();
 }
 
 } // namespace VideoCommon
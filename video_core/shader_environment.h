@@ -59,7 +59,7 @@ public:
 
     [[nodiscard]] u64 CalculateHash() const;
 
-    void Serialize(std::ofstream& file) const;
+    void Serialize(std::ostream& file) const;
 
 protected:
     std::optional<u64> TryFindSize();
@@ -135,7 +135,7 @@ public:
     FileEnvironment& operator=(const FileEnvironment&) = delete;
     FileEnvironment(const FileEnvironment&) = delete;
 
-    void Deserialize(std::ifstream& file);
+    void Deserialize(std::istream& file);
 
     [[nodiscard]] u64 ReadInstruction(u32 address) override;
 
@@ -175,9 +175,25 @@ void SerializePipeline(const Key& key, const Envs& envs, const std::filesystem::
                       std::span(envs.data(), envs.size()), filename, cache_version);
 }
 
+/**
+ * Loads the pipelines stored in a pipeline cache file, most recently written pipelines first.
+ * Entries are memory mapped and decompressed one at a time; the stream passed to the callbacks
+ * contains the pipeline key. Corrupted, duplicated and outdated entries are skipped, and the file
+ * is compacted when they make up a large part of it.
+ */
 void LoadPipelines(
     std::stop_token stop_loading, const std::filesystem::path& filename, u32 expected_cache_version,
-    Common::UniqueFunction<void, std::ifstream&, FileEnvironment> load_compute,
-    Common::UniqueFunction<void, std::ifstream&, std::vector<FileEnvironment>> load_graphics);
+    Common::UniqueFunction<void, std::istream&, FileEnvironment> load_compute,
+    Common::UniqueFunction<void, std::istream&, std::vector<FileEnvironment>> load_graphics);
+
+/**
+ * Merges several pipeline cache files into a single compacted file.
+ * Only entries of the newest cache version found in the inputs are kept; duplicated pipelines
+ * keep their most recent copy.
+ *
+ * @returns the number of pipelines written, or std::nullopt on failure.
+ */
+std::optional<size_t> MergePipelineCaches(std::span<const std::filesystem::path> inputs,
+                                          const std::filesystem::path& output);
 
 } // namespace VideoCommon
@@ -501,6 +501,21 @@ bool TextureCache<P>::IsRegionGpuModified(VAddr addr, size_t size) {
     return is_modified;
 }
 
+template <class P>
+size_t TextureCache<P>::PageTableMemoryUsage() const noexcept {
+    const auto usage = [](const auto& table) {
+        using Node = typename std::decay_t<decltype(table)>::value_type;
+        // Buckets, plus one heap node per page holding the pair and the next pointer
+        size_t bytes = table.bucket_count() * sizeof(void*) +
+                       table.size() * (sizeof(Node) + sizeof(void*));
+        for (const auto& [page, ids] : table) {
+            bytes += ids.capacity() * sizeof(typename Node::second_type::value_type);
+        }
+        return bytes;
+    };
+    return usage(page_table) + usage(gpu_page_table) + usage(sparse_page_table);
+}
+
 template <class P>
 void TextureCache<P>::RefreshContents(Image& image, ImageId image_id) {
     if (False(image.flags & ImageFlagBits::CpuModified)) {
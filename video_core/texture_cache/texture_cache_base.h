@@ -162,6 +162,9 @@ public:
     /// Return true when a CPU region is modified from the GPU
     [[nodiscard]] bool IsRegionGpuModified(VAddr addr, size_t size);
 
+    /// Return an estimate of the host memory used by the page tables tracking images
+    [[nodiscard]] size_t PageTableMemoryUsage() const noexcept;
+
     std::mutex mutex;
 
 private:
@@ -18,14 +18,27 @@
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <latch>
+#include <list>
+#include <mutex>
 #include <span>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/container/static_vector.hpp>
+#include <boost/functional/hash.hpp>
 
+#include "common/cityhash.h"
 #include "common/common_types.h"
+#include "common/div_ceil.h"
+#include "common/literals.h"
+#include "common/microprofile.h"
+#include "common/thread_worker.h"
 #include "video_core/textures/astc.h"
 
+MICROPROFILE_DEFINE(GPU_ASTCDecompress, "GPU", "ASTC Decompress", MP_RGB(128, 192, 128));
+
 class InputBitStream {
 public:
     constexpr explicit InputBitStream(std::span<const u8> data, size_t start_offset = 0)
@@ -50,20 +63,29 @@ public:
     }
 
     constexpr u32 ReadBits(std::size_t nBits) {
+        // Consume whole byte fragments at a time instead of single bits, the integer sequence
+        // decoder spends most of its time here
         u32 ret = 0;
-        for (std::size_t i = 0; i < nBits; ++i) {
-            ret |= (ReadBit() & 1) << i;
+        std::size_t ret_bits = 0;
+        while (ret_bits < nBits && bits_read < total_bits * 8) {
+            const std::size_t chunk =
+                std::min({nBits - ret_bits, 8 - next_bit, total_bits * 8 - bits_read});
+            const u32 value = (static_cast<u32>(*cur_byte) >> next_bit) & ((1U << chunk) - 1);
+            ret |= value << ret_bits;
+            ret_bits += chunk;
+            next_bit += chunk;
+            bits_read += chunk;
+            if (next_bit >= 8) {
+                next_bit -= 8;
+                ++cur_byte;
+            }
         }
         return ret;
     }
 
     template <std::size_t nBits>
     constexpr u32 ReadBits() {
-        u32 ret = 0;
-        for (std::size_t i = 0; i < nBits; ++i) {
-            ret |= (ReadBit() & 1) << i;
-        }
-        return ret;
+        return ReadBits(nBits);
     }
 
 private:
@@ -222,6 +244,8 @@ static constexpr std::array<IntegerEncodedValue, 256> MakeEncodedValues() {
 static constexpr std::array<IntegerEncodedValue, 256> ASTC_ENCODINGS_VALUES = MakeEncodedValues();
 
 namespace Tegra::Texture::ASTC {
+using namespace Common::Literals;
+
 using IntegerEncodedVector = boost::container::static_vector<
     IntegerEncodedValue, 256,
     boost::container::static_vector_options<
@@ -1624,66 +1648,215 @@ static void DecompressBlock(std::span<const u8, 16> inBuf, const u32 blockWidth,
     u32 weights[2][144];
     UnquantizeTexelWeights(weights, texelWeightValues, weightParams, blockWidth, blockHeight);
 
+    // Expand the endpoints to 16 bits once per partition instead of once per texel
+    std::array<std::array<u32, 4>, 4> endpoint0;
+    std::array<std::array<u32, 4>, 4> endpoint1;
+    for (u32 i = 0; i < nPartitions; i++) {
+        for (u32 c = 0; c < 4; c++) {
+            endpoint0[i][c] = ReplicateByteTo16(static_cast<u32>(endpoints[i][0].Component(c)));
+            endpoint1[i][c] = ReplicateByteTo16(static_cast<u32>(endpoints[i][1].Component(c)));
+        }
+    }
+
+    std::array<u32, 4> planes{};
+    if (weightParams.m_bDualPlane) {
+        planes[(planeIdx + 1) & 3] = 1;
+    }
+
     // Now that we have endpoints and weights, we can interpolate and generate
     // the proper decoding...
-    for (u32 j = 0; j < blockHeight; j++)
+    const bool smallBlock = (blockHeight * blockWidth) < 32;
+    for (u32 j = 0; j < blockHeight; j++) {
         for (u32 i = 0; i < blockWidth; i++) {
-            u32 partition = Select2DPartition(partitionIndex, i, j, nPartitions,
-                                              (blockHeight * blockWidth) < 32);
+            const u32 partition =
+                Select2DPartition(partitionIndex, i, j, nPartitions, smallBlock);
             assert(partition < nPartitions);
 
-            Pixel p;
+            const u32 texel = j * blockWidth + i;
+            std::array<u32, 4> components;
             for (u32 c = 0; c < 4; c++) {
-                u32 C0 = endpoints[partition][0].Component(c);
-                C0 = ReplicateByteTo16(C0);
-                u32 C1 = endpoints[partition][1].Component(c);
-                C1 = ReplicateByteTo16(C1);
-
-                u32 plane = 0;
-                if (weightParams.m_bDualPlane && (((planeIdx + 1) & 3) == c)) {
-                    plane = 1;
-                }
-
-                u32 weight = weights[plane][j * blockWidth + i];
-                u32 C = (C0 * (64 - weight) + C1 * weight + 32) / 64;
-                if (C == 65535) {
-                    p.Component(c) = 255;
-                } else {
-                    double Cf = static_cast<double>(C);
-                    p.Component(c) = static_cast<u16>(255.0 * (Cf / 65536.0) + 0.5);
-                }
+                const u32 C0 = endpoint0[partition][c];
+                const u32 C1 = endpoint1[partition][c];
+                const u32 weight = weights[planes[c]][texel];
+                const u32 C = (C0 * (64 - weight) + C1 * weight + 32) / 64;
+                // Integer form of round(255 * C / 65536), with 65535 mapping to 255
+                components[c] = C == 65535 ? 255 : (C * 255 + 32768) >> 16;
             }
 
-            outBuf[j * blockWidth + i] = p.Pack();
+            // Components are stored as ARGB, pack them as R8G8B8A8
+            outBuf[texel] = components[1] | (components[2] << 8) | (components[3] << 16) |
+                            (components[0] << 24);
         }
+    }
 }
 
+namespace {
+
+/// Images with fewer blocks than this are decoded on the calling thread
+constexpr size_t PARALLEL_MIN_BLOCKS = 1024;
+
+/// Upper bound on the decoded texels kept for re-uploads of unchanged ASTC data
+constexpr size_t DECODED_CACHE_MAX_BYTES = 64_MiB;
+
+struct DecodedKey {
+    u64 hash;
+    u32 width;
+    u32 height;
+    u32 depth;
+    u32 block_width;
+    u32 block_height;
+
+    bool operator==(const DecodedKey&) const = default;
+};
+
+struct DecodedKeyHash {
+    size_t operator()(const DecodedKey& key) const noexcept {
+        size_t seed = static_cast<size_t>(key.hash);
+        boost::hash_combine(seed, key.width);
+        boost::hash_combine(seed, key.height);
+        boost::hash_combine(seed, key.depth);
+        boost::hash_combine(seed, key.block_width);
+        boost::hash_combine(seed, key.block_height);
+        return seed;
+    }
+};
+
+/// Least recently used cache of decoded images, shared by every GPU instance in the process
+class DecodedCache {
+public:
+    bool Lookup(const DecodedKey& key, std::span<u8> output) {
+        std::scoped_lock lock{mutex};
+        const auto it = map.find(key);
+        if (it == map.end()) {
+            return false;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        const std::vector<u8>& decoded = it->second->second;
+        std::memcpy(output.data(), decoded.data(), decoded.size());
+        return true;
+    }
+
+    void Insert(const DecodedKey& key, std::span<const u8> decoded) {
+        if (decoded.size() > DECODED_CACHE_MAX_BYTES / 4) {
+            // Don't let one huge image flush everything else
+            return;
+        }
+        std::scoped_lock lock{mutex};
+        if (map.contains(key)) {
+            return;
+        }
+        entries.emplace_front(key, std::vector<u8>(decoded.begin(), decoded.end()));
+        map.emplace(key, entries.begin());
+        total_bytes += decoded.size();
+        while (total_bytes > DECODED_CACHE_MAX_BYTES) {
+            auto& [old_key, old_decoded] = entries.back();
+            total_bytes -= old_decoded.size();
+            map.erase(old_key);
+            entries.pop_back();
+        }
+    }
+
+private:
+    using Entry = std::pair<DecodedKey, std::vector<u8>>;
+
+    std::mutex mutex;
+    std::list<Entry> entries;
+    std::unordered_map<DecodedKey, std::list<Entry>::iterator, DecodedKeyHash> map;
+    size_t total_bytes = 0;
+};
+
+DecodedCache& GetDecodedCache() {
+    static DecodedCache cache;
+    return cache;
+}
+
+Common::ThreadWorker& GetWorkers() {
+    static Common::ThreadWorker workers(std::max(std::thread::hardware_concurrency() / 2, 1U),
+                                        "mizu:ASTCDecoder");
+    return workers;
+}
+
+void DecompressRows(std::span<const u8> data, u32 width, u32 height, u32 block_width,
+                    u32 block_height, u32 z, u32 row_begin, u32 row_end, std::span<u8> output) {
+    const u32 rows = Common::DivCeil(height, block_height);
+    const u32 cols = Common::DivCeil(width, block_width);
+    const size_t depth_offset = static_cast<size_t>(z) * height * width * 4;
+    for (u32 y_index = row_begin; y_index < row_end; ++y_index) {
+        const u32 y = y_index * block_height;
+        for (u32 x_index = 0; x_index < cols; ++x_index) {
+            const size_t block_index =
+                (static_cast<size_t>(z) * rows + y_index) * cols + x_index;
+            const u32 x = x_index * block_width;
+
+            const std::span<const u8, 16> blockPtr{data.subspan(block_index * 16, 16)};
+
+            // Blocks can be at most 12x12
+            std::array<u32, 12 * 12> uncompData;
+            DecompressBlock(blockPtr, block_width, block_height, uncompData);
+
+            const u32 decompWidth = std::min(block_width, width - x);
+            const u32 decompHeight = std::min(block_height, height - y);
+
+            const std::span<u8> outRow = output.subspan(depth_offset + (y * width + x) * 4);
+            for (u32 jj = 0; jj < decompHeight; jj++) {
+                std::memcpy(outRow.data() + jj * width * 4, uncompData.data() + jj * block_width,
+                            decompWidth * 4);
+            }
+        }
+    }
+}
+
+} // Anonymous namespace
+
 void Decompress(std::span<const uint8_t> data, uint32_t width, uint32_t height, uint32_t depth,
                 uint32_t block_width, uint32_t block_height, std::span<uint8_t> output) {
-    u32 block_index = 0;
-    std::size_t depth_offset = 0;
-    for (u32 z = 0; z < depth; z++) {
-        for (u32 y = 0; y < height; y += block_height) {
-            for (u32 x = 0; x < width; x += block_width) {
-                const std::span<const u8, 16> blockPtr{data.subspan(block_index * 16, 16)};
-
-                // Blocks can be at most 12x12
-                std::array<u32, 12 * 12> uncompData;
-                DecompressBlock(blockPtr, block_width, block_height, uncompData);
-
-                u32 decompWidth = std::min(block_width, width - x);
-                u32 decompHeight = std::min(block_height, height - y);
-
-                const std::span<u8> outRow = output.subspan(depth_offset + (y * width + x) * 4);
-                for (u32 jj = 0; jj < decompHeight; jj++) {
-                    std::memcpy(outRow.data() + jj * width * 4,
-                                uncompData.data() + jj * block_width, decompWidth * 4);
-                }
-                ++block_index;
+    MICROPROFILE_SCOPE(GPU_ASTCDecompress);
+
+    const u32 rows = Common::DivCeil(height, block_height);
+    const u32 cols = Common::DivCeil(width, block_width);
+    const size_t num_blocks = static_cast<size_t>(rows) * cols * depth;
+    const std::span<const u8> input = data.first(num_blocks * 16);
+    const std::span<u8> decoded = output.first(static_cast<size_t>(width) * height * depth * 4);
+
+    const DecodedKey key{
+        .hash = Common::CityHash64(reinterpret_cast<const char*>(input.data()), input.size()),
+        .width = width,
+        .height = height,
+        .depth = depth,
+        .block_width = block_width,
+        .block_height = block_height,
+    };
+    DecodedCache& cache = GetDecodedCache();
+    if (cache.Lookup(key, decoded)) {
+        return;
+    }
+
+    if (num_blocks < PARALLEL_MIN_BLOCKS) {
+        for (u32 z = 0; z < depth; z++) {
+            DecompressRows(input, width, height, block_width, block_height, z, 0, rows, decoded);
+        }
+    } else {
+        // Split every layer in bands of block rows, aiming for a few bands per worker so uneven
+        // blocks (void extent vs. dual plane) still balance out
+        Common::ThreadWorker& workers = GetWorkers();
+        const u32 num_threads = std::max(std::thread::hardware_concurrency() / 2, 1U);
+        const u32 rows_per_task = std::max(rows / (num_threads * 4), 1U);
+        const u32 tasks_per_layer = Common::DivCeil(rows, rows_per_task);
+        std::latch done{static_cast<std::ptrdiff_t>(tasks_per_layer) * depth};
+        for (u32 z = 0; z < depth; z++) {
+            for (u32 row = 0; row < rows; row += rows_per_task) {
+                const u32 row_end = std::min(row + rows_per_task, rows);
+                workers.QueueWork([=, &done] {
+                    DecompressRows(input, width, height, block_width, block_height, z, row,
+                                   row_end, decoded);
+                    done.count_down();
+                });
             }
         }
-        depth_offset += height * width * 4;
+        done.wait();
     }
+
+    cache.Insert(key, decoded);
 }
 
 } // namespace Tegra::Texture::ASTC
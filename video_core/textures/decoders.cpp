@@ -4,6 +4,7 @@
 //
 // Adapted by Kent Hall for mizu on Horizon Linux.
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <cstring>
@@ -20,6 +21,37 @@
 
 namespace Tegra::Texture {
 namespace {
+/// Longest run of bytes within a GOB line that stays contiguous after swizzling
+constexpr u32 SWIZZLE_RUN_SIZE = 16;
+
+/// Pixels never straddle a contiguous run when their size divides it, so whole runs can be copied
+template <u32 BYTES_PER_PIXEL>
+constexpr bool CAN_COPY_RUNS = SWIZZLE_RUN_SIZE % BYTES_PER_PIXEL == 0;
+
+/**
+ * Copies the byte columns [x_begin, x_end) of a single line between linear and swizzled memory,
+ * one contiguous 16-byte run at a time (a single vector load/store on SSE and NEON hosts).
+ * 'gob_offset' returns the swizzled offset of the GOB holding a given byte column.
+ */
+template <bool TO_SWIZZLED, typename GobOffset>
+void CopyLineRuns(u8* dst, const u8* src, std::size_t linear_offset, u32 x_begin, u32 x_end,
+                  const std::array<u32, GOB_SIZE_X>& table, GobOffset&& gob_offset) {
+    for (u32 x = x_begin; x < x_end;) {
+        const u32 run_end = std::min((x | (SWIZZLE_RUN_SIZE - 1)) + 1, x_end);
+        const std::size_t swizzled_offset = gob_offset(x) + table[x % GOB_SIZE_X];
+        const std::size_t unswizzled_offset = linear_offset + (x - x_begin);
+
+        u8* const run_dst = dst + (TO_SWIZZLED ? swizzled_offset : unswizzled_offset);
+        const u8* const run_src = src + (TO_SWIZZLED ? unswizzled_offset : swizzled_offset);
+        if (run_end - x == SWIZZLE_RUN_SIZE) {
+            std::memcpy(run_dst, run_src, SWIZZLE_RUN_SIZE);
+        } else {
+            std::memcpy(run_dst, run_src, run_end - x);
+        }
+        x = run_end;
+    }
+}
+
 template <bool TO_LINEAR, u32 BYTES_PER_PIXEL>
 void SwizzleImpl(std::span<u8> output, std::span<const u8> input, u32 width, u32 height, u32 depth,
                  u32 block_height, u32 block_depth, u32 stride_alignment) {
@@ -55,6 +87,17 @@ void SwizzleImpl(std::span<u8> output, std::span<const u8> input, u32 width, u32
             const u32 offset_y = (block_y >> block_height) * block_size +
                                  ((block_y & block_height_mask) << GOB_SIZE_SHIFT);
 
+            if constexpr (CAN_COPY_RUNS<BYTES_PER_PIXEL>) {
+                const u32 x_begin = origin_x * BYTES_PER_PIXEL;
+                const std::size_t unswizzled_offset = slice * pitch * height + line * pitch;
+                CopyLineRuns<TO_LINEAR>(output.data(), input.data(), unswizzled_offset, x_begin,
+                                        x_begin + pitch, table, [&](u32 x) {
+                                            return offset_z + offset_y +
+                                                   ((x >> GOB_SIZE_X_SHIFT) << x_shift);
+                                        });
+                continue;
+            }
+
             for (u32 column = 0; column < width; ++column) {
                 const u32 x = (column + origin_x) * BYTES_PER_PIXEL;
                 const u32 offset_x = (x >> GOB_SIZE_X_SHIFT) << x_shift;
@@ -109,6 +152,15 @@ void SwizzleSubrect(u32 subrect_width, u32 subrect_height, u32 source_pitch, u32
             (dst_y / (GOB_SIZE_Y * block_height)) * GOB_SIZE * block_height * image_width_in_gobs +
             ((dst_y % (GOB_SIZE_Y * block_height)) / GOB_SIZE_Y) * GOB_SIZE;
         const auto& table = SWIZZLE_TABLE[dst_y % GOB_SIZE_Y];
+        if constexpr (CAN_COPY_RUNS<BYTES_PER_PIXEL>) {
+            const u32 x_begin = offset_x * BYTES_PER_PIXEL;
+            CopyLineRuns<true>(swizzled_data, unswizzled_data, line * source_pitch, x_begin,
+                               x_begin + subrect_width * BYTES_PER_PIXEL, table, [&](u32 x) {
+                                   return gob_address_y +
+                                          (x / GOB_SIZE_X) * GOB_SIZE * block_height;
+                               });
+            continue;
+        }
         for (u32 x = 0; x < subrect_width; ++x) {
             const u32 dst_x = x + offset_x;
             const u32 gob_address =
@@ -140,6 +192,14 @@ void UnswizzleSubrect(u32 line_length_in, u32 line_count, u32 pitch, u32 width,
         const u32 block_y = src_y >> GOB_SIZE_Y_SHIFT;
         const u32 src_offset_y = (block_y >> block_height) * block_size +
                                  ((block_y & block_height_mask) << GOB_SIZE_SHIFT);
+        if constexpr (CAN_COPY_RUNS<BYTES_PER_PIXEL>) {
+            const u32 x_begin = origin_x * BYTES_PER_PIXEL;
+            CopyLineRuns<false>(output, input, line * pitch, x_begin,
+                                x_begin + line_length_in * BYTES_PER_PIXEL, table, [&](u32 x) {
+                                    return src_offset_y + ((x >> GOB_SIZE_X_SHIFT) << x_shift);
+                                });
+            continue;
+        }
         for (u32 column = 0; column < line_length_in; ++column) {
             const u32 src_x = (column + origin_x) * BYTES_PER_PIXEL;
             const u32 src_offset_x = (src_x >> GOB_SIZE_X_SHIFT) << x_shift;
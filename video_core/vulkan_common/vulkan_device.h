@@ -96,6 +96,21 @@ public:
         return properties.driverVersion;
     }
 
+    /// Returns the PCI vendor ID of the device.
+    u32 GetVendorID() const {
+        return properties.vendorID;
+    }
+
+    /// Returns the PCI device ID of the device.
+    u32 GetDeviceID() const {
+        return properties.deviceID;
+    }
+
+    /// Returns the UUID identifying which pipeline caches the driver accepts.
+    std::span<const u8, VK_UUID_SIZE> GetPipelineCacheUUID() const {
+        return properties.pipelineCacheUUID;
+    }
+
     /// Returns the device name.
     std::string_view GetModelName() const {
         return properties.deviceName;